@@ -26,6 +26,9 @@
 #include "access/remotetup.h"
 #include "executor/nodeRemotescan.h"
 #include "utils/builtins.h"
+#include "utils/date.h"
+#include "utils/datetime.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memdebug.h"
 #include "utils/algos.h"
@@ -33,7 +36,30 @@
 #include "catalog/pg_type.h"
 #include "sharding/sharding_conn.h"
 #include "utils/memutils.h"
+#include "utils/timestamp.h"
 
+#include <float.h>
+#include <math.h>
+
+
+/*
+ * Values of columns whose output function is one of below are written
+ * directly into the insert stmt buffer by write_attr_value(), which produces
+ * the same text as the output function. Values of other columns go through
+ * their output functions.
+ */
+typedef enum RemotetupWriter
+{
+	RTW_OUTPUT_FUNC,
+	RTW_INT2,
+	RTW_INT4,
+	RTW_INT8,
+	RTW_FLOAT4,
+	RTW_FLOAT8,
+	RTW_DATE,
+	RTW_TIMESTAMP,
+	RTW_TIMESTAMPTZ
+} RemotetupWriter;
 
 /* ----------------
  *		Private state for a remotetup destination object
@@ -49,6 +75,7 @@ typedef struct RemotetupAttrInfo
 	bool		typisvarlena;	/* is it varlena (ie possibly toastable)? */
 	int16		format;			/* format code for this column */
 	FmgrInfo	finfo;			/* Precomputed call info for output fn */
+	RemotetupWriter writer;		/* how values of this column are written */
 } RemotetupAttrInfo;
 
 typedef struct RemotetupCacheState
@@ -64,13 +91,27 @@ typedef struct RemotetupCacheState
 
 	int affected_rows;	/* the accumulative number of affected rows */
 	List *inflight_handles; /* inflight insert stmts */
+
+	/*
+	 * Output functions are called in this context, it's reset after each
+	 * tuple is cached.
+	 */
+	MemoryContext scratch;
+	/* date/time values are produced in UTC+0 timezone. */
+	pg_tz *gmt_tz;
 } RemotetupCacheState;
 
 
 static size_t append_value_str(RemotetupCacheState *s, char *valstr, Oid typid);
+static size_t write_attr_value(RemotetupCacheState *s, RemotetupAttrInfo *ai, Datum attr);
 static size_t bracket_tuple(bool start, RemotetupCacheState *s);
 static int remote_insert_blocks = 1;
 int max_remote_insert_blocks = 1024;
+/*
+ * Max NO. of insert stmts queued or running in one shard's connection, a
+ * session producing more waits for the shard to catch up.
+ */
+int max_remote_insert_inflight = 4;
 static inline void grow_remote_insert_blocks()
 {
 	remote_insert_blocks *= 2;
@@ -94,6 +135,10 @@ struct RemotetupCacheState *CreateRemotetupCacheState(Relation rel)
 	self->pasi = GetAsyncStmtInfo(rel->rd_rel->relshardid);
 	self->action = ONCONFLICT_NONE;
 	initStringInfo(&self->action_str);
+	self->scratch = AllocSetContextCreate(CurrentMemoryContext,
+										  "cache remotetup context",
+										  ALLOCSET_DEFAULT_SIZES);
+	self->gmt_tz = pg_tzset("GMT");
 	return self;
 }
 
@@ -110,6 +155,31 @@ void set_remote_onconflict_action(RemotetupCacheState *cachestate,
 	if (action == ONCONFLICT_UPDATE)
 		appendBinaryStringInfo(&cachestate->action_str, action_clause->data, action_clause->len);
 }
+static RemotetupWriter get_attr_writer(Oid typoutput)
+{
+	switch (typoutput)
+	{
+	case F_INT2OUT:
+		return RTW_INT2;
+	case F_INT4OUT:
+		return RTW_INT4;
+	case F_INT8OUT:
+		return RTW_INT8;
+	case F_FLOAT4OUT:
+		return RTW_FLOAT4;
+	case F_FLOAT8OUT:
+		return RTW_FLOAT8;
+	case F_MY_DATE_OUT:
+		return RTW_DATE;
+	case F_MY_TIMESTAMP_OUT:
+		return RTW_TIMESTAMP;
+	case F_MY_TIMESTAMPTZ_OUT:
+		return RTW_TIMESTAMPTZ;
+	default:
+		return RTW_OUTPUT_FUNC;
+	}
+}
+
 /*
  * Get the lookup info that remotetup() needs
  */
@@ -151,6 +221,7 @@ remotetup_prepare_info(RemotetupCacheState*myState,
 		thisState->typoutput =
 		    my_output_funcoid(attr->atttypid, &thisState->typisvarlena);
 		fmgr_info(thisState->typoutput, &thisState->finfo);
+		thisState->writer = get_attr_writer(thisState->typoutput);
 		appendStringInfo(&myState->buf, "%s, ", attr->attname.data);
 	}
 
@@ -200,10 +271,7 @@ bool cache_remotetup(TupleTableSlot *slot, ResultRelInfo *resultRelInfo)
 		remotetup_prepare_info(myState, typeinfo, natts);
 	}
 
-	MemoryContext mem = AllocSetContextCreate(CurrentMemoryContext,
-						  "cache remotetup context",
-						  ALLOCSET_DEFAULT_SIZES);
-	MemoryContext mem_saved =  MemoryContextSwitchTo(mem);
+	MemoryContext mem_saved = MemoryContextSwitchTo(myState->scratch);
 
 	/* Make sure the tuple is fully deconstructed */
 	slot_getallattrs(slot);
@@ -237,6 +305,13 @@ bool cache_remotetup(TupleTableSlot *slot, ResultRelInfo *resultRelInfo)
 			VALGRIND_CHECK_MEM_IS_DEFINED(DatumGetPointer(attr),
 										  VARSIZE_ANY(attr));
 
+		if (thisState->writer != RTW_OUTPUT_FUNC &&
+			(attrlen = write_attr_value(myState, thisState, attr)) > 0)
+		{
+			tuplen += attrlen;
+			continue;
+		}
+
 		/* Text output */
 		char	   *outputstr = NULL;
 		Oid atttypid = typeinfo->attrs[i].atttypid;
@@ -250,7 +325,7 @@ bool cache_remotetup(TupleTableSlot *slot, ResultRelInfo *resultRelInfo)
 		if (!origtz && is_date_time_type(atttypid))
 		{
 			origtz = session_timezone;
-			session_timezone = pg_tzset("GMT");
+			session_timezone = myState->gmt_tz;
 		}
 
 		outputstr = OutputFunctionCall(&thisState->finfo, attr);
@@ -275,7 +350,7 @@ bool cache_remotetup(TupleTableSlot *slot, ResultRelInfo *resultRelInfo)
 	tuplen += brlen;
 
 	MemoryContextSwitchTo(mem_saved);
-	MemoryContextDelete(mem);
+	MemoryContextReset(myState->scratch);
 
 	return true;
 }
@@ -348,6 +423,12 @@ bool end_remote_insert_stmt(struct RemotetupCacheState *s, bool end_of_stmt)
 
 	s->inflight_handles = lappend(s->inflight_handles, handle);
 
+	/*
+	  Keep the shard executing queued insert stmts while we produce more rows,
+	  and bound the NO. of such stmts held in memory.
+	*/
+	progress_stmts(s->pasi, max_remote_insert_inflight);
+
 	// the buffer is given to async, can't be used anymore in memory buffer.
 	if (!end_of_stmt)
 		initStringInfo2(stmt, BLCKSZ * remote_insert_blocks, TopTransactionContext);
@@ -371,3 +452,92 @@ static size_t append_value_str(RemotetupCacheState *s, char *valstr, Oid typid)
 {
 	return appendStringInfo(&s->buf, "%s, ", valstr ? valstr : "NULL");
 }
+
+/*
+ * Write a column value of one of the RemotetupWriter types followed by ", "
+ * into the stmt buffer, producing the same text as the column's output
+ * function with extra_float_digits = 3 and in UTC+0 timezone.
+ * @retval number of bytes written, 0 if nothing is written and the value has
+ * to be output by its output function, e.g. infinite and NaN values.
+ * */
+static size_t write_attr_value(RemotetupCacheState *s, RemotetupAttrInfo *ai, Datum attr)
+{
+	int oldlen = s->buf.len;
+	char buf[MAXDATELEN + 1];
+	struct pg_tm tt, *tm = &tt;
+	fsec_t fsec;
+	int tz;
+	const char *cast = NULL;	/* type to cast the quoted value to */
+
+	switch (ai->writer)
+	{
+	case RTW_INT2:
+		pg_itoa(DatumGetInt16(attr), buf);
+		break;
+	case RTW_INT4:
+		pg_ltoa(DatumGetInt32(attr), buf);
+		break;
+	case RTW_INT8:
+		pg_lltoa(DatumGetInt64(attr), buf);
+		break;
+	case RTW_FLOAT4:
+	{
+		float4 num = DatumGetFloat4(attr);
+		if (isnan(num) || is_infinite(num))
+			return 0;
+		snprintf(buf, sizeof(buf), "%.*g", FLT_DIG + 3, num);
+		break;
+	}
+	case RTW_FLOAT8:
+	{
+		float8 num = DatumGetFloat8(attr);
+		if (isnan(num) || is_infinite(num))
+			return 0;
+		snprintf(buf, sizeof(buf), "%.*g", DBL_DIG + 3, num);
+		break;
+	}
+	case RTW_DATE:
+	{
+		DateADT date = DatumGetDateADT(attr);
+		if (DATE_NOT_FINITE(date))
+			return 0;
+		j2date(date + POSTGRES_EPOCH_JDATE,
+			   &(tm->tm_year), &(tm->tm_mon), &(tm->tm_mday));
+		EncodeDateOnly(tm, USE_ISO_DATES, buf);
+		cast = "DATE";
+		break;
+	}
+	case RTW_TIMESTAMP:
+	case RTW_TIMESTAMPTZ:
+	{
+		Timestamp ts = DatumGetTimestamp(attr);
+		int ret;
+		if (TIMESTAMP_NOT_FINITE(ts))
+			return 0;
+		if (ai->writer == RTW_TIMESTAMP)
+			ret = timestamp2tm(ts, NULL, tm, &fsec, NULL, NULL);
+		else
+			ret = timestamp2tm(ts, &tz, tm, &fsec, NULL, s->gmt_tz);
+		if (ret != 0)
+			return 0; // the output function reports the error.
+		EncodeDateTime(tm, fsec, false, 0, NULL, USE_ISO_DATES, buf);
+		cast = "DATETIME(6)";
+		break;
+	}
+	default:
+		return 0;
+	}
+
+	if (cast)
+	{
+		appendStringInfoString(&s->buf, "CAST('");
+		appendStringInfoString(&s->buf, buf);
+		appendStringInfoString(&s->buf, "' as ");
+		appendStringInfoString(&s->buf, cast);
+		appendStringInfoChar(&s->buf, ')');
+	}
+	else
+		appendStringInfoString(&s->buf, buf);
+	appendBinaryStringInfo(&s->buf, ", ", 2);
+	return s->buf.len - oldlen;
+}
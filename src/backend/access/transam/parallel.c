@@ -29,6 +29,7 @@
 #include "miscadmin.h"
 #include "optimizer/planmain.h"
 #include "pgstat.h"
+#include "sharding/sharding_conn.h"
 #include "storage/ipc.h"
 #include "storage/sinval.h"
 #include "storage/spin.h"
@@ -1350,6 +1351,12 @@ ParallelWorkerMain(Datum main_arg)
 	RestoreGUCState(gucspace);
 	CommitTransactionCommand();
 
+	/*
+	 * Remote scans in the worker send their statements through connections
+	 * of its own to the storage shards.
+	 */
+	InitShardingSession();
+
 	/* Crank up a transaction state appropriate to a parallel worker. */
 	tstatespace = shm_toc_lookup(toc, PARALLEL_KEY_TRANSACTION_STATE, false);
 	StartParallelWorkerTransaction(tstatespace);
@@ -35,8 +35,10 @@
 #include "catalog/pg_shard.h"
 #include "catalog/pg_shard_node.h"
 #include "executor/spi.h"
+#include "funcapi.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "port/atomics.h"
 #include "postmaster/xidsender.h"
 #include "sharding/cluster_meta.h"
 #include "sharding/sharding.h"
@@ -53,11 +55,13 @@
 #include "utils/fmgroids.h"
 #include "utils/guc.h"
 #include "utils/hsearch.h"
+#include "utils/inval.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/relcache.h"
 #include "utils/snapmgr.h"
 #include "utils/timeout.h"
+#include "utils/timestamp.h"
 #include "utils/syscache.h"
 
 #include <sys/types.h>
@@ -69,6 +73,527 @@ Shard_id_t First_shard_id = 1;
 Shard_node_id_t Invalid_shard_node_id = 0;
 Shard_node_id_t First_shard_node_id = 1;
 
+/*
+ * Shard topology map in shared memory, owned by the topo service which
+ * reloads it from pg_shard and pg_shard_node, see ReloadShardTopoMap().
+ * Backends route stmts by it instead of looking up the catalogs each, and
+ * 'generation' is bumped whenever its content changes, so that a primary
+ * switch found by the topo service reaches all sessions at once.
+ *
+ * A backend whose pg_shard/pg_shard_node syscache entries are invalidated
+ * asks for a reload by bumping 'reload_reqs', and keeps using the catalogs
+ * until the map is reloaded after its request, see shard_topo_map_usable().
+ */
+#define SHARD_TOPO_STR_LEN 64
+
+typedef struct ShardTopoNode
+{
+	Oid id;
+	Oid shard_id;
+	Oid svr_node_id;
+	int32 port;
+	int16 ro_weight;
+	int16 latency;
+	bool complete;		/* false if hostaddr or passwd is too long to keep */
+	NameData user_name;
+	char hostaddr[SHARD_TOPO_STR_LEN];
+	char passwd[SHARD_TOPO_STR_LEN];
+} ShardTopoNode;
+
+typedef struct ShardTopoShard
+{
+	Oid id;
+	Oid master_node_id;
+	bool master_missing;	/* master_node_id is not one of its nodes */
+	int first_node;		/* index of its first node in ShardTopoMap.nodes */
+	int num_nodes;
+} ShardTopoShard;
+
+/*
+ * Primary switches of storage shards published by the topo service, with
+ * the latency from the switch being detected to the new primary being in
+ * the map, see shard_primary_switch_stats().
+ */
+typedef struct PrimarySwitchStats
+{
+	uint64 nswitches;
+	uint64 total_latency_us;
+	uint64 max_latency_us;
+	uint64 last_latency_us;
+	Oid last_shard_id;
+	TimestampTz last_switch_time;
+} PrimarySwitchStats;
+
+typedef struct ShardTopoMap
+{
+	pg_atomic_uint64 generation;	/* 0 if not loaded */
+	pg_atomic_uint64 reload_reqs;
+	pg_atomic_uint64 loaded_req;	/* the map is loaded after this request */
+	uint64 last_generation;
+	int num_shards;
+	int num_nodes;
+	ShardTopoShard shards[MAX_SHARDS];	/* ordered by id */
+	ShardTopoNode nodes[MAX_SHARDS * MAX_NODES_PER_SHARD]; /* by shard_id, id */
+	PrimarySwitchStats switch_stats;	/* protected by ShardTopoMapLock */
+} ShardTopoMap;
+
+static ShardTopoMap *shard_topo_map = NULL;
+
+/* This backend's copy of shard_topo_map->shards */
+static ShardTopoShard local_topo_shards[MAX_SHARDS];
+static int local_topo_num_shards = 0;
+static uint64 local_topo_generation = 0;
+/* The reload request to wait for, and whether a new one is to be made */
+static uint64 local_topo_req = 0;
+static bool local_topo_stale = true;
+static bool topo_callbacks_registered = false;
+
+Size ShardTopoMapShmemSize()
+{
+	return sizeof(ShardTopoMap);
+}
+
+void ShardTopoMapShmemInit(void)
+{
+	bool found;
+
+	shard_topo_map = (ShardTopoMap *)
+		ShmemInitStruct("Storage shard topology map", ShardTopoMapShmemSize(), &found);
+
+	if (!found)
+	{
+		MemSet(shard_topo_map, 0, ShardTopoMapShmemSize());
+		pg_atomic_init_u64(&shard_topo_map->generation, 0);
+		pg_atomic_init_u64(&shard_topo_map->reload_reqs, 0);
+		pg_atomic_init_u64(&shard_topo_map->loaded_req, 0);
+	}
+}
+
+static void
+shard_topo_inval_callback(Datum arg, int cacheid, uint32 hashvalue)
+{
+	local_topo_stale = true;
+}
+
+static int
+topo_shard_cmp(const void *a, const void *b)
+{
+	Oid ida = ((const ShardTopoShard *)a)->id;
+	Oid idb = ((const ShardTopoShard *)b)->id;
+
+	return ida < idb ? -1 : (ida > idb ? 1 : 0);
+}
+
+static int
+topo_node_cmp(const void *a, const void *b)
+{
+	const ShardTopoNode *na = (const ShardTopoNode *)a;
+	const ShardTopoNode *nb = (const ShardTopoNode *)b;
+
+	if (na->shard_id != nb->shard_id)
+		return na->shard_id < nb->shard_id ? -1 : 1;
+	return na->id < nb->id ? -1 : (na->id > nb->id ? 1 : 0);
+}
+
+/*
+ * Whether this backend can look up the shard topology map, its copy of the
+ * shards is brought up to date if so. Only costs an atomic read unless the
+ * map or the catalogs changed.
+ */
+static bool
+shard_topo_map_usable()
+{
+	uint64 gen;
+
+	/* The topo service fills the map from the catalogs */
+	if (!shard_topo_map || !IsUnderPostmaster || !IsNormalProcessingMode() ||
+	    MyProcPid == get_topo_service_pid())
+		return false;
+
+	/* Changes done before registration are not necessarily in the map */
+	if (!topo_callbacks_registered)
+	{
+		CacheRegisterSyscacheCallback(SHARD, shard_topo_inval_callback, (Datum)0);
+		CacheRegisterSyscacheCallback(SHARDNODE, shard_topo_inval_callback, (Datum)0);
+		topo_callbacks_registered = true;
+		local_topo_stale = true;
+	}
+
+	if (local_topo_stale)
+	{
+		/*
+		  Our own uncommitted changes can't be seen by the topo service,
+		  ask for the reload after the txn ends.
+		*/
+		if (IsTransactionState() &&
+		    TransactionIdIsValid(GetTopTransactionIdIfAny()))
+			return false;
+
+		local_topo_stale = false;
+		local_topo_req = pg_atomic_add_fetch_u64(&shard_topo_map->reload_reqs, 1);
+
+		int pid = get_topo_service_pid();
+		if (pid != 0 &&
+		    pg_atomic_read_u64(&shard_topo_map->loaded_req) + 1 == local_topo_req)
+			kill(pid, SIGUSR2);
+	}
+
+	if (pg_atomic_read_u64(&shard_topo_map->loaded_req) < local_topo_req)
+		return false;
+	pg_read_barrier();
+	if ((gen = pg_atomic_read_u64(&shard_topo_map->generation)) == 0)
+		return false;
+
+	if (gen != local_topo_generation)
+	{
+		LWLockAcquire(ShardTopoMapLock, LW_SHARED);
+		local_topo_num_shards = shard_topo_map->num_shards;
+		memcpy(local_topo_shards, shard_topo_map->shards,
+		       sizeof(ShardTopoShard) * local_topo_num_shards);
+		local_topo_generation = pg_atomic_read_u64(&shard_topo_map->generation);
+		LWLockRelease(ShardTopoMapLock);
+	}
+
+	return local_topo_generation != 0;
+}
+
+static ShardTopoShard *
+find_topo_shard(Oid shardid)
+{
+	ShardTopoShard key;
+
+	key.id = shardid;
+	return (ShardTopoShard *)bsearch(&key, local_topo_shards, local_topo_num_shards,
+					 sizeof(ShardTopoShard), topo_shard_cmp);
+}
+
+/*
+ * Look up node 'nodeid' of shard 'shardid' in the topology map.
+ * @retval true if found and 'out' is filled; false if caller need to look up
+ * the catalogs.
+ */
+static bool
+find_topo_node(Oid shardid, Oid nodeid, Shard_node_t *out)
+{
+	ShardTopoShard *shard;
+	bool found = false;
+
+	if (!shard_topo_map_usable() || !(shard = find_topo_shard(shardid)))
+		return false;
+
+	LWLockAcquire(ShardTopoMapLock, LW_SHARED);
+	/* The node ranges of our copy are only valid for the same generation */
+	if (pg_atomic_read_u64(&shard_topo_map->generation) == local_topo_generation)
+	{
+		for (int i = shard->first_node; i < shard->first_node + shard->num_nodes; i++)
+		{
+			ShardTopoNode *node = &shard_topo_map->nodes[i];
+
+			if (node->id != nodeid)
+				continue;
+			if (out && node->complete)
+			{
+				out->id = nodeid;
+				out->shard_id = node->shard_id;
+				out->port = node->port;
+				out->ro_weight = node->ro_weight;
+				out->svr_node_id = node->svr_node_id;
+				out->user_name = node->user_name;
+				out->hostaddr = pstrdup(node->hostaddr);
+				out->passwd = pstrdup(node->passwd);
+			}
+			found = (!out || node->complete);
+			break;
+		}
+	}
+	LWLockRelease(ShardTopoMapLock);
+
+	return found;
+}
+
+/*
+ * Copy text 'd' to the zeroed 'buf' if it fits.
+ */
+static bool
+copy_topo_str(Datum d, char *buf)
+{
+	text *t = DatumGetTextPP(d);
+	int len = VARSIZE_ANY_EXHDR(t);
+
+	if (len >= SHARD_TOPO_STR_LEN)
+		return false;
+	memcpy(buf, VARDATA_ANY(t), len);
+	return true;
+}
+
+/*
+ * Storage shards whose primary the topo service found or was told to be
+ * stale, and since when. Once the new primary of a shard is updated into
+ * pg_shard, the next ReloadShardTopoMap() publishes it to backends and
+ * records the switch, see record_primary_switches().
+ */
+typedef struct PendingPrimarySwitch
+{
+	Oid shardid;
+	bool updated;		/* new primary written to pg_shard */
+	TimestampTz detected;
+	TimestampTz requested;	/* last check requested by the watch, or 0 */
+} PendingPrimarySwitch;
+
+static PendingPrimarySwitch pending_switches[MAX_SHARDS];
+static int num_pending_switches = 0;
+
+static PendingPrimarySwitch *
+find_primary_suspect(Oid shardid)
+{
+	for (int i = 0; i < num_pending_switches; i++)
+	{
+		if (pending_switches[i].shardid == shardid)
+			return &pending_switches[i];
+	}
+	return NULL;
+}
+
+static PendingPrimarySwitch *
+note_primary_suspect(Oid shardid, TimestampTz now)
+{
+	PendingPrimarySwitch *ps = find_primary_suspect(shardid);
+
+	if (ps != NULL || num_pending_switches == MAX_SHARDS)
+		return ps;
+	ps = &pending_switches[num_pending_switches++];
+	ps->shardid = shardid;
+	ps->updated = false;
+	ps->detected = now;
+	ps->requested = 0;
+	return ps;
+}
+
+static void
+forget_primary_suspect(PendingPrimarySwitch *ps)
+{
+	Assert(ps >= pending_switches && ps < pending_switches + num_pending_switches);
+	*ps = pending_switches[--num_pending_switches];
+}
+
+/* Whether a new primary was written to pg_shard but isn't in the map yet */
+static bool
+primary_switch_unpublished(void)
+{
+	for (int i = 0; i < num_pending_switches; i++)
+	{
+		if (pending_switches[i].updated)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Record the switches of updated primaries, which are in the map now.
+ * Called with ShardTopoMapLock held exclusively.
+ */
+static void
+record_primary_switches(void)
+{
+	PrimarySwitchStats *stats = &shard_topo_map->switch_stats;
+	TimestampTz now = GetCurrentTimestamp();
+
+	for (int i = 0; i < num_pending_switches;)
+	{
+		PendingPrimarySwitch *ps = &pending_switches[i];
+		uint64 latency_us;
+
+		if (!ps->updated)
+		{
+			i++;
+			continue;
+		}
+
+		latency_us = (now > ps->detected) ? now - ps->detected : 0;
+		stats->nswitches++;
+		stats->total_latency_us += latency_us;
+		stats->max_latency_us = Max(stats->max_latency_us, latency_us);
+		stats->last_latency_us = latency_us;
+		stats->last_shard_id = ps->shardid;
+		stats->last_switch_time = now;
+
+		elog(LOG, "Rerouted stmts of shard %u to its new primary node %.3f ms after the switch was detected.",
+		     ps->shardid, latency_us / 1000.0);
+		forget_primary_suspect(ps);
+	}
+}
+
+/*
+ * Reload the shard topology map from pg_shard and pg_shard_node, bumping its
+ * generation if anything changed. Called by the topo service in a txn.
+ */
+void ReloadShardTopoMap()
+{
+	ShardTopoMap *map;
+	Relation rel;
+	SysScanDesc scan;
+	HeapTuple tup;
+	bool valid = true;
+	bool changed;
+
+	Assert(IsTransactionState());
+
+	/*
+	  Requests made before now are satisfied by catalogs read after now,
+	  which are read with a new catalog snapshot.
+	*/
+	uint64 req = pg_atomic_read_u64(&shard_topo_map->reload_reqs);
+	InvalidateCatalogSnapshot();
+
+	map = (ShardTopoMap *)palloc0(sizeof(ShardTopoMap));
+
+	rel = heap_open(ShardRelationId, AccessShareLock);
+	scan = systable_beginscan(rel, InvalidOid, false, NULL, 0, NULL);
+	while (valid && (tup = systable_getnext(scan)) != NULL)
+	{
+		Form_pg_shard shard = (Form_pg_shard)GETSTRUCT(tup);
+
+		if (map->num_shards == MAX_SHARDS)
+		{
+			valid = false;
+			break;
+		}
+		map->shards[map->num_shards].id = shard->id;
+		map->shards[map->num_shards].master_node_id = shard->master_node_id;
+		map->num_shards++;
+	}
+	systable_endscan(scan);
+	heap_close(rel, AccessShareLock);
+
+	rel = heap_open(ShardNodeRelationId, AccessShareLock);
+	scan = systable_beginscan(rel, InvalidOid, false, NULL, 0, NULL);
+	while (valid && (tup = systable_getnext(scan)) != NULL)
+	{
+		Form_pg_shard_node snode = (Form_pg_shard_node)GETSTRUCT(tup);
+		ShardTopoNode *node;
+		bool isnull1, isnull2;
+		Datum hostaddr, passwd;
+
+		if (map->num_nodes == lengthof(map->nodes))
+		{
+			valid = false;
+			break;
+		}
+		node = &map->nodes[map->num_nodes++];
+		node->id = snode->id;
+		node->shard_id = snode->shard_id;
+		node->svr_node_id = snode->svr_node_id;
+		node->port = snode->port;
+		node->ro_weight = snode->ro_weight;
+		node->latency = snode->latency;
+		node->user_name = snode->user_name;
+
+		hostaddr = heap_getattr(tup, Anum_pg_shard_node_hostaddr, RelationGetDescr(rel), &isnull1);
+		passwd = heap_getattr(tup, Anum_pg_shard_node_passwd, RelationGetDescr(rel), &isnull2);
+		node->complete = !isnull1 && !isnull2 &&
+			copy_topo_str(hostaddr, node->hostaddr) &&
+			copy_topo_str(passwd, node->passwd);
+	}
+	systable_endscan(scan);
+	heap_close(rel, AccessShareLock);
+
+	if (valid)
+	{
+		qsort(map->shards, map->num_shards, sizeof(ShardTopoShard), topo_shard_cmp);
+		qsort(map->nodes, map->num_nodes, sizeof(ShardTopoNode), topo_node_cmp);
+
+		for (int i = 0, j = 0; i < map->num_shards; i++)
+		{
+			ShardTopoShard *shard = &map->shards[i];
+
+			while (j < map->num_nodes && map->nodes[j].shard_id < shard->id)
+				j++;
+			shard->first_node = j;
+			shard->master_missing = (shard->master_node_id != InvalidOid);
+			while (j < map->num_nodes && map->nodes[j].shard_id == shard->id)
+			{
+				if (map->nodes[j].id == shard->master_node_id)
+					shard->master_missing = false;
+				j++;
+			}
+			shard->num_nodes = j - shard->first_node;
+		}
+	}
+	else
+		elog(WARNING, "Too many storage shards or shard nodes to be kept in the shard topology map, looking them up in catalogs instead.");
+
+	LWLockAcquire(ShardTopoMapLock, LW_EXCLUSIVE);
+	if (!valid)
+		changed = (pg_atomic_read_u64(&shard_topo_map->generation) != 0);
+	else
+		changed = (pg_atomic_read_u64(&shard_topo_map->generation) == 0 ||
+			   shard_topo_map->num_shards != map->num_shards ||
+			   shard_topo_map->num_nodes != map->num_nodes ||
+			   memcmp(shard_topo_map->shards, map->shards,
+				  sizeof(ShardTopoShard) * map->num_shards) != 0 ||
+			   memcmp(shard_topo_map->nodes, map->nodes,
+				  sizeof(ShardTopoNode) * map->num_nodes) != 0);
+	if (changed)
+	{
+		uint64 gen = 0;
+
+		if (valid)
+		{
+			shard_topo_map->num_shards = map->num_shards;
+			shard_topo_map->num_nodes = map->num_nodes;
+			memcpy(shard_topo_map->shards, map->shards,
+			       sizeof(ShardTopoShard) * map->num_shards);
+			memcpy(shard_topo_map->nodes, map->nodes,
+			       sizeof(ShardTopoNode) * map->num_nodes);
+			gen = ++shard_topo_map->last_generation;
+		}
+		pg_atomic_write_u64(&shard_topo_map->generation, gen);
+	}
+	/* Backends check loaded_req before generation without the lock */
+	pg_write_barrier();
+	if (pg_atomic_read_u64(&shard_topo_map->loaded_req) < req)
+		pg_atomic_write_u64(&shard_topo_map->loaded_req, req);
+	record_primary_switches();
+	LWLockRelease(ShardTopoMapLock);
+
+	if (changed)
+		elog(LOG, "Reloaded shard topology map of %d shards and %d nodes, generation " UINT64_FORMAT ".",
+		     map->num_shards, map->num_nodes, pg_atomic_read_u64(&shard_topo_map->generation));
+	pfree(map);
+}
+
+/*
+ * Show the primary switches of storage shards made by the topo service.
+ */
+Datum
+shard_primary_switch_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	PrimarySwitchStats stats;
+	Datum		values[6];
+	bool		nulls[6];
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	LWLockAcquire(ShardTopoMapLock, LW_SHARED);
+	stats = shard_topo_map->switch_stats;
+	LWLockRelease(ShardTopoMapLock);
+
+	MemSet(nulls, 0, sizeof(nulls));
+	values[0] = Int64GetDatum(stats.nswitches);
+	values[1] = Float8GetDatum(stats.nswitches ?
+							   stats.total_latency_us / 1000.0 / stats.nswitches : 0);
+	values[2] = Float8GetDatum(stats.max_latency_us / 1000.0);
+	values[3] = Float8GetDatum(stats.last_latency_us / 1000.0);
+	values[4] = ObjectIdGetDatum(stats.last_shard_id);
+	values[5] = TimestampTzGetDatum(stats.last_switch_time);
+	if (stats.nswitches == 0)
+		nulls[4] = nulls[5] = true;
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
+
 bool ShardExists(const Oid shardid)
 {
 	bool found;
@@ -92,6 +617,9 @@ bool FindCachedShardNode(Oid shardid, Oid nodeid, Shard_node_t *out)
 	bool isnull1, isnull2;
 	Datum hostaddr, passwd;
 
+	if (find_topo_node(shardid, nodeid, out))
+		return true;
+
 	/*StartTransactionCommand will change the MemoryContext */
 	MemoryContext memctx = CurrentMemoryContext;
 	if (!IsTransactionState())
@@ -147,6 +675,13 @@ List* GetAllShardIds()
 	SysScanDesc scan;
 	List *list = NIL;
 
+	if (shard_topo_map_usable())
+	{
+		for (int i = 0; i < local_topo_num_shards; i++)
+			list = lappend_oid(list, local_topo_shards[i].id);
+		return list;
+	}
+
 	pg_shard_rel = heap_open(ShardRelationId, RowShareLock);
 	scan = systable_beginscan(pg_shard_rel, InvalidOid, false, NULL, 0, NULL);
 	while ((tup = systable_getnext(scan)) != NULL)
@@ -255,6 +790,10 @@ find_node_tuple(CatCList *nodes, const char *ip, uint16_t port)
 }
 
 
+/*
+  Send a query of the replication status of a node, which is not wrapped in
+  an XA txn by work_on_stmt(), see SQLCOM_SHOW_SLAVE_STAT there.
+*/
 static StmtSafeHandle
 send_stmt_no_exception(Oid shardid, Oid nodeid, const char *stmt, size_t len)
 {
@@ -264,7 +803,7 @@ send_stmt_no_exception(Oid shardid, Oid nodeid, const char *stmt, size_t len)
 	PG_TRY();
 	{
 		asi = GetAsyncStmtInfoNode(shardid, nodeid, false);
-		handle = send_stmt_async(asi, (char *)stmt, len, CMD_SELECT, false, SQLCOM_SELECT, false);
+		handle = send_stmt_async(asi, (char *)stmt, len, CMD_SELECT, false, SQLCOM_SHOW_SLAVE_STAT, false);
 	}
 	PG_CATCH();
 	{
@@ -510,15 +1049,17 @@ end:
 /*
   Ask shard 'shardid' nodes which node is master, and if a quorum of them
   affirm the same new master node, it's updated in pg_shard, i.e.
-  set the new master node id to pg_shard.master_node_id.
+  set the new master node id to pg_shard.master_node_id. '*changed' is set
+  to whether it's updated to a different node.
   @retval true on error, false on sucess.
 */
-static bool UpdateCurrentMasterNodeId(Oid shardid)
+static bool UpdateCurrentMasterNodeId(Oid shardid, bool *changed)
 {
 	bool ret = true;
 	Oid master_nodeid = InvalidOid;
 	char strmsg[64];
 
+	*changed = false;
 	SetCurrentStatementStartTimestamp();
 	bool end_txn = false;
 
@@ -604,6 +1145,7 @@ static bool UpdateCurrentMasterNodeId(Oid shardid)
 		heap_modify_tuple(tup0, RelationGetDescr(pg_shard_rel),
 	                      values, nulls, replaces);
 	CatalogTupleUpdate(pg_shard_rel, &newtuple->t_self, newtuple);
+	*changed = true;
 	ret = false;
 end:
 	systable_endscan(scan);
@@ -691,49 +1233,187 @@ bool RequestShardingTopoCheck(Oid shardid)
 	return done;
 }
 
+int check_primary_interval_secs = 3;
+int primary_watch_interval_ms = 200;
+
 /*
-  Request to find latest master node of shard 'shardid' and update its pg_shard
-  row's master_node_id field.
-  @retval true if request placed; false if request not placed.
+  Whether the node 'handle' is sent to is still the primary of its shard,
+  according to the result of the watch stmt.
 */
-static int RequestShardingTopoChecks(Oid *poids, int n)
+static bool
+watch_result_is_primary(StmtSafeHandle handle, Storage_HA_Mode ha_mode)
 {
-	int ndones = 0;
-	Storage_HA_Mode ha_mode = storage_ha_mode();
+	AsyncStmtInfo *asi = RAW_HANDLE(handle)->asi;
+	bool ret = false;
 
-	if (ha_mode == HA_NO_REP) return 0;
-	LWLockAcquire(ShardingTopoCheckLock, LW_EXCLUSIVE);
-	for (int j = 0; j < n; j++)
-	{
-		const Oid shardid = poids[j];
-		for (int i = 0; i < ShardingTopoChkReqs->endidx; i++)
-			if (shardid == ShardingTopoChkReqs->shardids[i])
-				goto done;
-		// not found, append it
-		if (ShardingTopoChkReqs->endidx >= MAX_SHARDS)
-			goto end;
-		ShardingTopoChkReqs->shardids[ShardingTopoChkReqs->endidx++] = shardid;
-done:
-		ndones++;
+	PG_TRY();
+	{
+		MYSQL_ROW row = get_stmt_next_row(handle);
+
+		/* Same as check_mysql_instance_status() does for the metadata shard */
+		if (row == NULL || row[0] == NULL || row[1] == NULL)
+			ret = (ha_mode == HA_RBR);
+		else
+			ret = (strcmp(row[0], asi->conn->host) == 0 &&
+			       strtol(row[1], NULL, 10) == asi->conn->port);
 	}
-end:
-	LWLockRelease(ShardingTopoCheckLock);
-	/*
-	this function is for now only used to put failed requests back to queue,
-	and in this case we should not retry immediately otherwise we'd probably
-	fail again, forming a endless loop.
-	if (ndones)
-		kill(g_remote_meta_sync->main_applier_pid, SIGUSR2);
-	*/
-	return ndones;
+	PG_CATCH();
+	{
+		cancel_stmt_async(handle);
+		HOLD_INTERRUPTS();
+		downgrade_error();
+		errfinish(0);
+		FlushErrorState();
+		RESUME_INTERRUPTS();
+	}
+	PG_END_TRY();
+
+	return ret;
 }
 
-int check_primary_interval_secs = 3;
+/*
+  Ask the primary node of each storage shard and of the metadata shard whether
+  it's still the primary, through the connections the topo service keeps to
+  them, and request a topology check for the shards whose primary has
+  changed or can't be reached, which is done right after this by
+  ProcessShardingTopoReqs().
+
+  MySQL doesn't notify clients of MGR/RBR role changes, so this is done every
+  primary_watch_interval_ms, and the stmts are sent to all shards before
+  waiting for any of them, so a round takes about one round trip. The stmts
+  aren't XA txns, see send_stmt_no_exception().
+
+  A suspect primary is logged and checked once, then rechecked every
+  check_primary_interval_secs until it answers as the primary again or the
+  new one is published, rather than every round.
+*/
+void WatchShardPrimaries()
+{
+	static Oid shardids[MAX_SHARDS];
+	static Oid nodeids[MAX_SHARDS];
+	static StmtSafeHandle handles[MAX_SHARDS];
+	static TimestampTz meta_requested = 0;
+	const char *stmt = NULL;
+	int nshards = 0;
+	TimestampTz now;
+	const int recheck_ms = check_primary_interval_secs * 1000;
+	Storage_HA_Mode ha_mode = storage_ha_mode();
+	Storage_HA_Mode meta_ha_mode = metaserver_ha_mode();
+
+	if (primary_watch_interval_ms == 0)
+		return;
+
+	if (ha_mode == HA_MGR)
+		stmt = "select MEMBER_HOST, MEMBER_PORT from performance_schema.replication_group_members where channel_name='group_replication_applier' and MEMBER_STATE='ONLINE' and MEMBER_ROLE='PRIMARY'";
+	else if (ha_mode == HA_RBR)
+		stmt = "select HOST, PORT from performance_schema.replication_connection_configuration where channel_name='kunlun_repl'";
+
+	/* Primaries being used by backends, which are those in the map */
+	if (stmt && pg_atomic_read_u64(&shard_topo_map->generation) != 0)
+	{
+		LWLockAcquire(ShardTopoMapLock, LW_SHARED);
+		for (int i = 0; i < shard_topo_map->num_shards; i++)
+		{
+			ShardTopoShard *shard = &shard_topo_map->shards[i];
+
+			if (shard->master_node_id == InvalidOid || shard->master_missing)
+				continue;
+			shardids[nshards] = shard->id;
+			nodeids[nshards] = shard->master_node_id;
+			nshards++;
+		}
+		LWLockRelease(ShardTopoMapLock);
+	}
+
+	for (int i = 0; i < nshards; i++)
+		handles[i] = send_stmt_no_exception(shardids[i], nodeids[i], stmt, strlen(stmt));
+
+	/* Check the metadata shard while storage shards are working */
+	if (meta_ha_mode != HA_NO_REP)
+	{
+		bool is_primary = false;
+
+		PG_TRY();
+		{
+			MYSQL_CONN *conn = get_metadata_cluster_conn(true);
+
+			is_primary = check_mysql_instance_status(conn, meta_ha_mode == HA_MGR ?
+								 CHECK_MGR_MASTER : CHECK_RBR_MASTER, true);
+			/* Reconnect to the new primary next time */
+			if (!is_primary)
+				close_metadata_cluster_conn(conn);
+		}
+		PG_CATCH();
+		{
+			HOLD_INTERRUPTS();
+			downgrade_error();
+			errfinish(0);
+			FlushErrorState();
+			RESUME_INTERRUPTS();
+		}
+		PG_END_TRY();
+
+		now = GetCurrentTimestamp();
+		if (is_primary)
+			meta_requested = 0;
+		else if (meta_requested == 0 ||
+			 TimestampDifferenceExceeds(meta_requested, now, recheck_ms))
+		{
+			if (meta_requested == 0)
+				elog(LOG, "Primary node of metadata shard changed or unavailable, checking its new primary.");
+			meta_requested = now;
+			RequestShardingTopoCheck(METADATA_SHARDID);
+		}
+	}
+
+	for (int i = 0; i < nshards; i++)
+	{
+		bool is_primary = false;
+		PendingPrimarySwitch *ps;
+
+		if (stmt_handle_valid(handles[i]))
+		{
+			is_primary = watch_result_is_primary(handles[i], ha_mode);
+			release_stmt_handle(handles[i]);
+		}
+
+		now = GetCurrentTimestamp();
+		ps = find_primary_suspect(shardids[i]);
+		if (is_primary)
+		{
+			/* A false alarm, or the primary came back */
+			if (ps && ps->requested != 0 && !ps->updated)
+				forget_primary_suspect(ps);
+			continue;
+		}
+
+		if (ps == NULL)
+		{
+			elog(LOG, "Primary node %u of shard %u changed or unavailable, checking its new primary.",
+			     nodeids[i], shardids[i]);
+			ps = note_primary_suspect(shardids[i], now);
+		}
+		else if (ps->requested != 0 &&
+			 !TimestampDifferenceExceeds(ps->requested, now, recheck_ms))
+			continue;
 
+		if (ps)
+			ps->requested = now;
+		RequestShardingTopoCheck(shardids[i]);
+	}
+}
+
+/*
+  Process the topology check requests. Failed checks are retried after
+  check_primary_interval_secs, instead of in the next round of the topo
+  service, which may be only primary_watch_interval_ms later.
+*/
 void ProcessShardingTopoReqs()
 {
-	static Oid reqs[MAX_SHARDS], fail_reqs[MAX_SHARDS];
-	int nreqs = 0, nfail_reqs = 0;
+	static Oid reqs[MAX_SHARDS + 1], fail_reqs[MAX_SHARDS + 1];
+	static int nfail_reqs = 0;
+	static TimestampTz retry_time = 0;
+	int nreqs = 0, nfailed = 0;
 
 	LWLockAcquire(ShardingTopoCheckLock, LW_EXCLUSIVE);
 	if (ShardingTopoChkReqs->endidx > 0)
@@ -744,6 +1424,21 @@ void ProcessShardingTopoReqs()
 	}
 	LWLockRelease(ShardingTopoCheckLock);
 
+	TimestampTz now = GetCurrentTimestamp();
+	if (nfail_reqs > 0 && now >= retry_time)
+	{
+		for (int j = 0; j < nfail_reqs; j++)
+		{
+			int i = 0;
+
+			while (i < nreqs && reqs[i] != fail_reqs[j])
+				i++;
+			if (i == nreqs && nreqs < lengthof(reqs))
+				reqs[nreqs++] = fail_reqs[j];
+		}
+		nfail_reqs = 0;
+	}
+
 	static time_t last_master_update_ts = 0;
 	bool selfinit = false;
 	Storage_HA_Mode ha_mode = storage_ha_mode();
@@ -762,8 +1457,9 @@ void ProcessShardingTopoReqs()
 		selfinit = true;
 	}
 
+	/* The periodic checks are only logged when some of them fail */
 	if (nreqs > 0)
-		elog(LOG, "Start processing %d %s sharding topology checks.",
+		elog(selfinit ? DEBUG1 : LOG, "Start processing %d %s sharding topology checks.",
 			 nreqs, selfinit ? "actively initiated" : "");
 
 	for (int i = 0; i < nreqs; i++)
@@ -772,23 +1468,51 @@ void ProcessShardingTopoReqs()
 		if (reqs[i] == METADATA_SHARDID)
 			ret = UpdateCurrentMetaShardMasterNodeId();
 		else
-			ret = UpdateCurrentMasterNodeId(reqs[i]);
+		{
+			/* The switch of a requested shard is deemed detected now */
+			PendingPrimarySwitch *ps = note_primary_suspect(reqs[i], now);
+			bool changed = false;
+
+			ret = UpdateCurrentMasterNodeId(reqs[i], &changed);
+			/*
+			  A suspect of the watch is kept until its primary answers
+			  again, see WatchShardPrimaries().
+			*/
+			if (ps && !ret)
+			{
+				if (changed)
+					ps->updated = true;
+				else if (!ps->updated &&
+					 (ps->requested == 0 || primary_watch_interval_ms == 0))
+					forget_primary_suspect(ps);
+			}
+		}
 		if (ret)
-			fail_reqs[nfail_reqs++] = reqs[i];
+		{
+			int j = 0;
+
+			while (j < nfail_reqs && fail_reqs[j] != reqs[i])
+				j++;
+			if (j == nfail_reqs)
+				fail_reqs[nfail_reqs++] = reqs[i];
+			nfailed++;
+		}
 	}
 
-	if (nfail_reqs > 0)
+	if (nfailed > 0)
 	{
-		int nadded = RequestShardingTopoChecks(fail_reqs, nfail_reqs);
-		Assert(nadded == nfail_reqs);
-		elog(LOG, "Re-added %d of %d failed topology checks to request queue.", nadded, nfail_reqs);
+		retry_time = TimestampTzPlusMilliseconds(GetCurrentTimestamp(),
+							 check_primary_interval_secs * 1000);
+		elog(LOG, "Will retry %d failed topology checks in %d seconds.",
+			 nfailed, check_primary_interval_secs);
 	}
 
 	if (nreqs > 0)
 	{
 		last_master_update_ts = time(NULL);
-		elog(LOG, "Completed processing %d sharding topology checks, failed %d checks and will retry later.",
-			 nreqs - nfail_reqs, nfail_reqs);
+		elog(selfinit && nfailed == 0 ? DEBUG1 : LOG,
+			 "Completed processing %d sharding topology checks, failed %d checks and will retry later.",
+			 nreqs - nfailed, nfailed);
 	}
 }
 
@@ -1118,6 +1842,13 @@ Oid GetShardMasterNodeId(Oid shardid)
 	Oid nodeid = InvalidOid;
 	HeapTuple tuple;
 	bool free_txn = false;
+	ShardTopoShard *shard;
+
+	/* A missing master node is reported below */
+	if (shard_topo_map_usable() && (shard = find_topo_shard(shardid)) &&
+	    !shard->master_missing)
+		return shard->master_node_id;
+
 	/* Make sure in transaction */
 	if (!IsTransactionState())
 	{
@@ -1158,6 +1889,84 @@ Oid GetShardMasterNodeId(Oid shardid)
 	return nodeid;
 }
 
+typedef struct ReplicaCand
+{
+	Oid nodeid;
+	int16 ro_weight;
+	uint32 tiebreak;
+} ReplicaCand;
+
+static int replica_cand_cmp(const void *a, const void *b)
+{
+	const ReplicaCand *ra = (const ReplicaCand *)a;
+	const ReplicaCand *rb = (const ReplicaCand *)b;
+
+	if (ra->ro_weight != rb->ro_weight)
+		return ra->ro_weight > rb->ro_weight ? -1 : 1;
+	if (ra->tiebreak != rb->tiebreak)
+		return ra->tiebreak < rb->tiebreak ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Return ids of the replica(non master) nodes of shard 'shardid' which read
+ * only stmts can be dispatched to, i.e. those whose ro_weight > 0 and whose
+ * binlog sync latency is no more than max_latency(unless it's < 0). Nodes
+ * with bigger ro_weight come first, the order of nodes with equal ro_weight
+ * differs among backends so that their reads are spread.
+ * */
+List *GetShardReplicaNodeIds(Oid shardid, int max_latency)
+{
+	List *ids = NIL;
+	CatCList *nodes;
+	ReplicaCand *cands;
+	int ncands = 0;
+	bool free_txn = false;
+	/*StartTransactionCommand will change the MemoryContext */
+	MemoryContext memctx = CurrentMemoryContext;
+
+	if (storage_ha_mode() == HA_NO_REP)
+		return NIL;
+
+	if (!IsTransactionState())
+	{
+		free_txn = true;
+		StartTransactionCommand();
+	}
+
+	Oid master_nodeid = GetShardMasterNodeId(shardid);
+	nodes = SearchSysCacheList1(SHARDNODES, ObjectIdGetDatum(shardid));
+	cands = palloc(sizeof(ReplicaCand) * (nodes->n_members + 1));
+
+	for (int i = 0; i < nodes->n_members; i++)
+	{
+		Form_pg_shard_node node =
+			(Form_pg_shard_node)GETSTRUCT(&nodes->members[i]->tuple);
+
+		if (node->id == master_nodeid || node->ro_weight <= 0 ||
+			(max_latency >= 0 && node->latency > max_latency))
+			continue;
+
+		cands[ncands].nodeid = node->id;
+		cands[ncands].ro_weight = node->ro_weight;
+		cands[ncands].tiebreak = (node->id * 2654435761U) ^ (uint32)MyProcPid;
+		ncands++;
+	}
+	ReleaseSysCacheList(nodes);
+
+	qsort(cands, ncands, sizeof(ReplicaCand), replica_cand_cmp);
+	MemoryContext oldctx = MemoryContextSwitchTo(memctx);
+	for (int i = 0; i < ncands; i++)
+		ids = lappend_oid(ids, cands[i].nodeid);
+	MemoryContextSwitchTo(oldctx);
+	pfree(cands);
+
+	if (free_txn)
+		CommitTransactionCommand();
+
+	return ids;
+}
+
 
 static bool got_sigterm = false;
 static bool got_sighup = true;
@@ -1204,9 +2013,18 @@ int get_topo_service_pid()
 /**
  * The main loop of the topology service, responsible for updating the
  * cluster topology, and handling requests to kill shard connection
+ *
+ * Shard primaries are watched every primary_watch_interval_ms, the other
+ * tasks are done when the service is signaled or a new primary is to be
+ * published, or else every TOPO_SERVICE_INTERVAL_MS.
  */
+#define TOPO_SERVICE_INTERVAL_MS 5000
+
 void TopoServiceMain(void)
 {
+	TimestampTz last_full_round = 0;
+	bool signaled = true;
+
 	pqsignal(SIGHUP, topo_service_sighup);
 	pqsignal(SIGTERM, topo_service_sigterm);
 	pqsignal(SIGUSR2, topo_service_siguser2);
@@ -1239,7 +2057,17 @@ void TopoServiceMain(void)
 		}
 
 		int step = 0;
-		while (step < 2)
+		volatile int nsteps = 1;
+
+		if (signaled || primary_switch_unpublished() ||
+		    TimestampDifferenceExceeds(last_full_round, GetCurrentTimestamp(),
+					       TOPO_SERVICE_INTERVAL_MS))
+		{
+			nsteps = 3;
+			last_full_round = GetCurrentTimestamp();
+		}
+
+		while (step < nsteps)
 		{
 			PG_TRY();
 			{
@@ -1249,13 +2077,21 @@ void TopoServiceMain(void)
 					case 0:
 						// task 1: handle topology update requests.
 						enable_remote_timeout();
+						WatchShardPrimaries();
 						ProcessShardingTopoReqs();
 						disable_remote_timeout();
+						/* Publish the new primaries found right away */
+						if (primary_switch_unpublished())
+							nsteps = 3;
 						break;
 					case 1:
 						// task 2: kill connections/queries
 						reapShardConnKillReqs();
 						break;
+					case 2:
+						// task 3: publish the topology, including the updates of task 1.
+						ReloadShardTopoMap();
+						break;
 					default:
 						break;
 				}
@@ -1275,8 +2111,9 @@ void TopoServiceMain(void)
 
 			step ++;
 		}
-		
-		wait_latch(5000);
+
+		signaled = !wait_latch(primary_watch_interval_ms > 0 ?
+				       primary_watch_interval_ms : TOPO_SERVICE_INTERVAL_MS);
 	}
 
 	proc_exit(0);
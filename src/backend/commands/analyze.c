@@ -37,16 +37,19 @@
 #include "foreign/fdwapi.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
+#include "nodes/remote_input.h"
 #include "parser/parse_oper.h"
 #include "parser/parse_relation.h"
 #include "pgstat.h"
 #include "postmaster/autovacuum.h"
+#include "sharding/sharding_conn.h"
 #include "statistics/extended_stats_internal.h"
 #include "statistics/statistics.h"
 #include "storage/bufmgr.h"
 #include "storage/lmgr.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
+#include "tcop/tcopprot.h"
 #include "utils/acl.h"
 #include "utils/attoptcache.h"
 #include "utils/builtins.h"
@@ -94,6 +97,14 @@ static VacAttrStats *examine_attribute(Relation onerel, int attnum,
 static int acquire_sample_rows(Relation onerel, int elevel,
 					HeapTuple *rows, int targrows,
 					double *totalrows, double *totaldeadrows);
+static int acquire_remote_sample_rows(Relation onerel, int elevel,
+					HeapTuple *rows, int targrows,
+					double *totalrows, double *totaldeadrows);
+static StmtSafeHandle send_remote_sample_query(Relation onerel, int sampletarget);
+static int fetch_remote_sample_rows(Relation onerel, int elevel,
+					StmtSafeHandle handle, int sampletarget,
+					HeapTuple *rows, int targrows,
+					double *totalrows, double *totaldeadrows);
 static int	compare_rows(const void *a, const void *b);
 static int acquire_inherited_sample_rows(Relation onerel, int elevel,
 							  HeapTuple *rows, int targrows,
@@ -153,15 +164,6 @@ analyze_rel(Oid relid, RangeVar *relation, int options,
 		rel_lock = false;
 	}
 
-	/*
-	  dzw: skip vacuuming for remote relations.
-	*/
-	if (onerel && IsRemoteRelation(onerel))
-	{
-		relation_close(onerel, ShareUpdateExclusiveLock);
-		return;
-	}
-
 	/*
 	 * If we failed to open or lock the relation, emit a log message before
 	 * exiting.
@@ -254,7 +256,17 @@ analyze_rel(Oid relid, RangeVar *relation, int options,
 	/*
 	 * Check that it's of an analyzable relkind, and set up appropriately.
 	 */
-	if (onerel->rd_rel->relkind == RELKIND_RELATION ||
+	if (onerel->rd_rel->relkind == RELKIND_RELATION &&
+		IsRemoteRelation(onerel))
+	{
+		/*
+		  Remote table, rows are sampled on its storage shard. The NO. of
+		  pages is maintained by cluster_mgr.
+		*/
+		acquirefunc = acquire_remote_sample_rows;
+		relpages = onerel->rd_rel->relpages;
+	}
+	else if (onerel->rd_rel->relkind == RELKIND_RELATION ||
 		onerel->rd_rel->relkind == RELKIND_MATVIEW)
 	{
 		/* Regular table, so we'll use the regular row acquisition function */
@@ -649,9 +661,10 @@ do_analyze_rel(Relation onerel, int options, VacuumParams *params,
 	 */
 	if (!inh)
 	{
-		BlockNumber relallvisible;
+		BlockNumber relallvisible = 0;
 
-		visibilitymap_count(onerel, &relallvisible, NULL);
+		if (!IsRemoteRelation(onerel))
+			visibilitymap_count(onerel, &relallvisible, NULL);
 
 		vac_update_relstats(onerel,
 							relpages,
@@ -677,6 +690,8 @@ do_analyze_rel(Relation onerel, int options, VacuumParams *params,
 
 			totalindexrows = ceil(thisdata->tupleFract * totalrows);
 			vac_update_relstats(Irel[ind],
+								IsRemoteRelation(Irel[ind]) ?
+								Irel[ind]->rd_rel->relpages :
 								RelationGetNumberOfBlocks(Irel[ind]),
 								totalindexrows,
 								0,
@@ -1311,6 +1326,195 @@ acquire_sample_rows(Relation onerel, int elevel,
 	return numrows;
 }
 
+/*
+ * Remote tables are sampled with a WHERE rand() < fraction filter on their
+ * storage shard, the fraction is picked so as to return this many times the
+ * NO. of rows wanted, to make up for an inaccurate table_rows estimate.
+ */
+#define REMOTE_SAMPLE_OVERSAMPLING 1.5
+
+/*
+ * acquire_remote_sample_rows -- acquire a random sample of rows from a
+ * remote table
+ *
+ * Same API as acquire_sample_rows. The rows are sampled by the storage shard
+ * of the table, see send_remote_sample_query().
+ */
+static int
+acquire_remote_sample_rows(Relation onerel, int elevel,
+						   HeapTuple *rows, int targrows,
+						   double *totalrows, double *totaldeadrows)
+{
+	StmtSafeHandle handle;
+
+	handle = send_remote_sample_query(onerel, targrows);
+	enable_remote_timeout();
+
+	return fetch_remote_sample_rows(onerel, elevel, handle, targrows,
+									rows, targrows,
+									totalrows, totaldeadrows);
+}
+
+/*
+ * Send a query which samples about 'sampletarget' rows of remote table
+ * 'onerel' to its storage shard, and return the handle of the query.
+ *
+ * The rows are picked by the storage node itself, using the table_rows
+ * estimate of information_schema.tables, so only the sampled rows are
+ * transferred. The 1st column of the result is that estimate and the rest
+ * are the table's columns in attribute order, with NULLs for dropped ones.
+ */
+static StmtSafeHandle
+send_remote_sample_query(Relation onerel, int sampletarget)
+{
+	TupleDesc	tupdesc = RelationGetDescr(onerel);
+	const char *relname = RelationGetRelationName(onerel);
+	char	   *schema_name;
+	StringInfoData sql;
+	AsyncStmtInfo *asi;
+	int			i;
+
+	/* make_qualified_name() returns a static buffer */
+	schema_name = pstrdup(make_qualified_name(RelationGetNamespace(onerel),
+											  NULL, NULL));
+	initStringInfo(&sql);
+	appendStringInfoString(&sql, "select s.n");
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+
+		if (att->attisdropped)
+			appendStringInfoString(&sql, ", NULL");
+		else
+			appendStringInfo(&sql, ", t.%s", NameStr(att->attname));
+	}
+	appendStringInfo(&sql, " from %s.%s t, (select greatest(ifnull(table_rows, 0), 1) n"
+					 " from information_schema.tables where table_schema='%s'"
+					 " and table_name='%s') s where rand() < %d / s.n",
+					 schema_name, relname, schema_name, relname,
+					 (int) ceil(sampletarget * REMOTE_SAMPLE_OVERSAMPLING));
+
+	asi = GetAsyncStmtInfo(onerel->rd_rel->relshardid);
+	return send_stmt_async(asi, sql.data, sql.len, CMD_SELECT, false,
+						   SQLCOM_SELECT, false);
+}
+
+/*
+ * Read the result of a query sent by send_remote_sample_query(onerel,
+ * sampletarget), keeping a random sample of up to targrows of its rows in
+ * rows[]. Otherwise same as acquire_sample_rows, except that the rows are
+ * not in physical order, since storage nodes don't expose row positions.
+ */
+static int
+fetch_remote_sample_rows(Relation onerel, int elevel,
+						 StmtSafeHandle handle, int sampletarget,
+						 HeapTuple *rows, int targrows,
+						 double *totalrows, double *totaldeadrows)
+{
+	TupleDesc	tupdesc = RelationGetDescr(onerel);
+	int			natts = tupdesc->natts;
+	TypeInputInfo *tii;
+	Datum	   *values;
+	bool	   *nulls;
+	int			numrows = 0;	/* # rows now in reservoir */
+	double		samplerows = 0; /* total # rows fetched */
+	double		rowstoskip = -1;	/* -1 means not set yet */
+	double		storagerows = 0;	/* table_rows estimate of storage node */
+	double		fraction;
+	ReservoirStateData rstate;
+	MYSQL_ROW	row;
+	int			i;
+
+	Assert(targrows > 0);
+
+	tii = (TypeInputInfo *) palloc0(natts * sizeof(TypeInputInfo));
+	for (i = 0; i < natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+
+		if (!att->attisdropped)
+			myInputInfo(att->atttypid, att->atttypmod, tii + i);
+	}
+	values = (Datum *) palloc(natts * sizeof(Datum));
+	nulls = (bool *) palloc(natts * sizeof(bool));
+
+	reservoir_init_selection_state(&rstate, targrows);
+
+	while ((row = get_stmt_next_row(handle)) != NULL)
+	{
+		int			pos = -1;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (samplerows == 0 && row[0] != NULL)
+			storagerows = strtod(row[0], NULL);
+
+		/* Same reservoir sampling as acquire_sample_rows() */
+		if (numrows < targrows)
+			pos = numrows++;
+		else
+		{
+			if (rowstoskip < 0)
+				rowstoskip = reservoir_get_next_S(&rstate, samplerows, targrows);
+
+			if (rowstoskip <= 0)
+			{
+				pos = (int) (targrows * sampler_random_fract(rstate.randstate));
+				Assert(pos >= 0 && pos < targrows);
+				heap_freetuple(rows[pos]);
+			}
+
+			rowstoskip -= 1;
+		}
+
+		samplerows += 1;
+
+		if (pos < 0)
+			continue;
+
+		{
+			size_t	   *lengths = get_stmt_row_lengths(handle);
+			enum enum_field_types *types = get_stmt_field_types(handle);
+
+			for (i = 0; i < natts; i++)
+			{
+				if (TupleDescAttr(tupdesc, i)->attisdropped || row[i + 1] == NULL)
+				{
+					values[i] = (Datum) 0;
+					nulls[i] = true;
+				}
+				else
+					values[i] = myInputFuncCall(tii + i, row[i + 1],
+												lengths[i + 1], types[i + 1],
+												&nulls[i]);
+			}
+			rows[pos] = heap_form_tuple(tupdesc, values, nulls);
+		}
+	}
+	release_stmt_handle(handle);
+
+	/*
+	 * Extrapolate the total NO. of rows from the sampling fraction the storage
+	 * node used. Dead rows are purged by the storage node itself.
+	 */
+	fraction = storagerows > 0 ?
+		ceil(sampletarget * REMOTE_SAMPLE_OVERSAMPLING) / storagerows : 1;
+	if (fraction >= 1)
+		*totalrows = samplerows;
+	else
+		*totalrows = floor(samplerows / fraction + 0.5);
+	*totaldeadrows = 0;
+
+	ereport(elevel,
+			(errmsg("\"%s\": fetched %.0f rows from storage shard %u, "
+					"%d rows in sample, %.0f estimated total rows",
+					RelationGetRelationName(onerel),
+					samplerows, onerel->rd_rel->relshardid,
+					numrows, *totalrows)));
+
+	return numrows;
+}
+
 /*
  * qsort comparator for sorting rows[] array
  */
@@ -1354,6 +1558,8 @@ acquire_inherited_sample_rows(Relation onerel, int elevel,
 	AcquireSampleRowsFunc *acquirefuncs;
 	double	   *relblocks;
 	double		totalblocks;
+	StmtSafeHandle *handles;
+	bool		sent_remote = false;
 	int			numrows,
 				nrels,
 				i;
@@ -1417,7 +1623,17 @@ acquire_inherited_sample_rows(Relation onerel, int elevel,
 		}
 
 		/* Check table type (MATVIEW can't happen, but might as well allow) */
-		if (childrel->rd_rel->relkind == RELKIND_RELATION ||
+		if (childrel->rd_rel->relkind == RELKIND_RELATION &&
+			IsRemoteRelation(childrel))
+		{
+			/*
+			  Remote table, sampled on its storage shard. Make sure it gets
+			  its share of rows even if cluster_mgr hasn't counted its pages.
+			*/
+			acquirefunc = acquire_remote_sample_rows;
+			relpages = Max(childrel->rd_rel->relpages, 1);
+		}
+		else if (childrel->rd_rel->relkind == RELKIND_RELATION ||
 			childrel->rd_rel->relkind == RELKIND_MATVIEW)
 		{
 			/* Regular table, so use the regular row acquisition function */
@@ -1484,6 +1700,29 @@ acquire_inherited_sample_rows(Relation onerel, int elevel,
 		return 0;
 	}
 
+	/*
+	 * Send the sampling queries of all remote children before reading any
+	 * result, so that their storage shards sample them concurrently.
+	 */
+	handles = (StmtSafeHandle *) palloc(nrels * sizeof(StmtSafeHandle));
+	for (i = 0; i < nrels; i++)
+	{
+		int			childtargrows;
+
+		handles[i] = INVALID_STMT_HANLE;
+		if (acquirefuncs[i] != acquire_remote_sample_rows)
+			continue;
+
+		childtargrows = (int) rint(targrows * relblocks[i] / totalblocks);
+		if (childtargrows > 0)
+		{
+			handles[i] = send_remote_sample_query(rels[i], childtargrows);
+			sent_remote = true;
+		}
+	}
+	if (sent_remote)
+		enable_remote_timeout();
+
 	/*
 	 * Now sample rows from each relation, proportionally to its fraction of
 	 * the total block count.  (This might be less than desirable if the child
@@ -1502,8 +1741,10 @@ acquire_inherited_sample_rows(Relation onerel, int elevel,
 		if (childblocks > 0)
 		{
 			int			childtargrows;
+			int			sampletarget;
 
-			childtargrows = (int) rint(targrows * childblocks / totalblocks);
+			childtargrows = sampletarget =
+				(int) rint(targrows * childblocks / totalblocks);
 			/* Make sure we don't overrun due to roundoff error */
 			childtargrows = Min(childtargrows, targrows - numrows);
 			if (childtargrows > 0)
@@ -1513,9 +1754,15 @@ acquire_inherited_sample_rows(Relation onerel, int elevel,
 							tdrows;
 
 				/* Fetch a random sample of the child's rows */
-				childrows = (*acquirefunc) (childrel, elevel,
-											rows + numrows, childtargrows,
-											&trows, &tdrows);
+				if (stmt_handle_valid(handles[i]))
+					childrows = fetch_remote_sample_rows(childrel, elevel,
+														 handles[i], sampletarget,
+														 rows + numrows, childtargrows,
+														 &trows, &tdrows);
+				else
+					childrows = (*acquirefunc) (childrel, elevel,
+												rows + numrows, childtargrows,
+												&trows, &tdrows);
 
 				/* We may need to convert from child's rowtype to parent's */
 				if (childrows > 0 &&
@@ -1548,6 +1795,11 @@ acquire_inherited_sample_rows(Relation onerel, int elevel,
 				*totalrows += trows;
 				*totaldeadrows += tdrows;
 			}
+			else if (stmt_handle_valid(handles[i]))
+			{
+				cancel_stmt_async(handles[i]);
+				release_stmt_handle(handles[i]);
+			}
 		}
 
 		/*
@@ -27,6 +27,7 @@
 #include "catalog/catalog.h"
 #include "catalog/dependency.h"
 #include "catalog/pg_authid.h"
+#include "catalog/pg_inherits.h"
 #include "catalog/pg_type.h"
 #include "commands/copy.h"
 #include "commands/defrem.h"
@@ -41,12 +42,15 @@
 #include "optimizer/clauses.h"
 #include "optimizer/planner.h"
 #include "nodes/makefuncs.h"
+#include "nodes/remote_input.h"
 #include "parser/parse_relation.h"
 #include "port/pg_bswap.h"
 #include "rewrite/rewriteHandler.h"
+#include "sharding/sharding_conn.h"
 #include "storage/fd.h"
 #include "tcop/tcopprot.h"
 #include "utils/builtins.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/portal.h"
@@ -291,6 +295,9 @@ if (1) \
 
 static const char BinarySignature[11] = "PGCOPY\n\377\r\n\0";
 
+/* Whether COPY TO of a remote table streams rows from shards, see CopyRemoteTo() */
+bool		enable_remote_copy_to_stream = true;
+
 
 /* non-export function prototypes */
 static CopyState BeginCopy(ParseState *pstate, bool is_from, Relation rel,
@@ -304,6 +311,7 @@ static CopyState BeginCopyTo(ParseState *pstate, Relation rel, RawStmt *query,
 static void EndCopyTo(CopyState cstate);
 static uint64 DoCopyTo(CopyState cstate);
 static uint64 CopyTo(CopyState cstate);
+static uint64 CopyRemoteTo(CopyState cstate);
 static void CopyOneRowTo(CopyState cstate, Oid tupleOid,
 			 Datum *values, bool *nulls);
 static void CopyFromInsertBatch(CopyState cstate, EState *estate,
@@ -875,8 +883,19 @@ DoCopy(ParseState *pstate, const CopyStmt *stmt,
 		 * normal non-filtering relation handling.
 		 */
 		bool rls_enabled = false;
+		bool remote_query = (!is_from &&
+			(IsRemoteRelation(rel) || IsRemoteRelationParent(rel)));
+
+		/*
+		 * COPY TO of a remote table streams rows from its shards directly,
+		 * see CopyRemoteTo(), unless row security policies are to be
+		 * applied by the query.
+		 */
+		if (remote_query && enable_remote_copy_to_stream &&
+			check_enable_rls(rte->relid, InvalidOid, false) != RLS_ENABLED)
+			remote_query = false;
 
-		if ((!is_from && (IsRemoteRelation(rel) || IsRemoteRelationParent(rel))) ||
+		if (remote_query ||
 			(rls_enabled = (check_enable_rls(rte->relid, InvalidOid, false) ==
 			RLS_ENABLED)))
 		{
@@ -1787,7 +1806,8 @@ BeginCopyTo(ParseState *pstate,
 	bool		pipe = (filename == NULL);
 	MemoryContext oldcontext;
 
-	if (rel != NULL && rel->rd_rel->relkind != RELKIND_RELATION)
+	if (rel != NULL && rel->rd_rel->relkind != RELKIND_RELATION &&
+		!IsRemoteRelationParent(rel))
 	{
 		if (rel->rd_rel->relkind == RELKIND_VIEW)
 			ereport(ERROR,
@@ -2064,7 +2084,12 @@ CopyTo(CopyState cstate)
 		}
 	}
 
-	if (cstate->rel)
+	if (cstate->rel &&
+		(IsRemoteRelation(cstate->rel) || IsRemoteRelationParent(cstate->rel)))
+	{
+		processed = CopyRemoteTo(cstate);
+	}
+	else if (cstate->rel)
 	{
 		Datum	   *values;
 		bool	   *nulls;
@@ -2114,6 +2139,197 @@ CopyTo(CopyState cstate)
 	return processed;
 }
 
+/*
+ * Copy a remote table, or all leaf partitions of a partitioned remote table,
+ * TO file. A SELECT of the copied columns is sent to each leaf table's shard
+ * and rows are written out as they arrive from whichever shard, so rows of
+ * different leaf tables interleave in the output.
+ *
+ * In text and CSV formats, values of columns whose text form is the same in
+ * mysql and pg(integers and strings) are written out as received, values of
+ * other columns are converted to Datums and output by the columns' output
+ * functions, as a RemoteScan would do.
+ */
+static uint64
+CopyRemoteTo(CopyState cstate)
+{
+	TupleDesc	tupDesc = RelationGetDescr(cstate->rel);
+	int			num_phys_attrs = tupDesc->natts;
+	int			ncols = list_length(cstate->attnumlist);
+	TypeInputInfo *tii;
+	bool	   *direct;
+	Datum	   *values;
+	bool	   *nulls;
+	List	   *leaves;
+	StmtSafeHandle *handles;
+	int			nhandles = 0;
+	uint64		processed = 0;
+	ListCell   *lc;
+	MemoryContext rowcontext;
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(cstate->copycontext);
+
+	/*
+	 * Converted values are kept in this context rather than
+	 * cstate->rowcontext, which CopyOneRowTo() resets.
+	 */
+	rowcontext = AllocSetContextCreate(cstate->copycontext,
+									   "COPY TO remote row",
+									   ALLOCSET_DEFAULT_SIZES);
+	tii = (TypeInputInfo *) palloc0(num_phys_attrs * sizeof(TypeInputInfo));
+	direct = (bool *) palloc0(num_phys_attrs * sizeof(bool));
+	values = (Datum *) palloc0(num_phys_attrs * sizeof(Datum));
+	nulls = (bool *) palloc(num_phys_attrs * sizeof(bool));
+	memset(nulls, true, num_phys_attrs * sizeof(bool));
+
+	foreach(lc, cstate->attnumlist)
+	{
+		int			attnum = lfirst_int(lc);
+		Form_pg_attribute attr = TupleDescAttr(tupDesc, attnum - 1);
+
+		myInputInfo(attr->atttypid, attr->atttypmod, tii + attnum - 1);
+		tii[attnum - 1].mctx = cstate->copycontext;
+
+		switch (cstate->out_functions[attnum - 1].fn_oid)
+		{
+			case F_INT2OUT:
+			case F_INT4OUT:
+			case F_INT8OUT:
+			case F_TEXTOUT:
+			case F_VARCHAROUT:
+				direct[attnum - 1] = !cstate->binary;
+				break;
+			default:
+				break;
+		}
+	}
+
+	if (IsRemoteRelationParent(cstate->rel))
+		leaves = find_all_inheritors(RelationGetRelid(cstate->rel),
+									 AccessShareLock, NULL);
+	else
+		leaves = list_make1_oid(RelationGetRelid(cstate->rel));
+
+	handles = (StmtSafeHandle *) palloc(list_length(leaves) * sizeof(StmtSafeHandle));
+
+	foreach(lc, leaves)
+	{
+		Relation	leaf;
+		StringInfoData sql;
+		ListCell   *lc2;
+
+		if (get_rel_relkind(lfirst_oid(lc)) != RELKIND_RELATION)
+			continue;
+
+		leaf = heap_open(lfirst_oid(lc), NoLock);
+		initStringInfo2(&sql, 256, TopTransactionContext);
+		appendStringInfoString(&sql, "select ");
+		foreach(lc2, cstate->attnumlist)
+		{
+			Form_pg_attribute attr = TupleDescAttr(tupDesc, lfirst_int(lc2) - 1);
+
+			if (lc2 != list_head(cstate->attnumlist))
+				appendStringInfoString(&sql, ", ");
+			appendStringInfoString(&sql, NameStr(attr->attname));
+		}
+		appendStringInfo(&sql, " from %s",
+						 make_qualified_name(leaf->rd_rel->relnamespace,
+											 RelationGetRelationName(leaf), NULL));
+
+		handles[nhandles++] =
+			send_stmt_async(GetAsyncStmtInfoForRead(leaf->rd_rel->relshardid),
+							donateStringInfo(&sql), lengthStringInfo(&sql),
+							CMD_SELECT, true, SQLCOM_SELECT, false);
+		heap_close(leaf, NoLock);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	while (nhandles > 0)
+	{
+		StmtSafeHandle handle = wait_for_readable_stmt(handles, nhandles);
+		MYSQL_ROW	row;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if ((row = try_get_stmt_next_row(handle)))
+		{
+			size_t	   *lengths = get_stmt_row_lengths(handle);
+			enum enum_field_types *types = get_stmt_field_types(handle);
+			bool		need_delim = false;
+			int			i = 0;
+
+			MemoryContextReset(rowcontext);
+			oldcontext = MemoryContextSwitchTo(rowcontext);
+
+			foreach(lc, cstate->attnumlist)
+			{
+				int			attnum = lfirst_int(lc);
+				bool		isnull = (row[i] == NULL);
+				char	   *string = row[i];
+
+				if (!isnull && !direct[attnum - 1])
+					values[attnum - 1] = myInputFuncCall(tii + attnum - 1,
+														 row[i], lengths[i],
+														 types[i], &isnull);
+				nulls[attnum - 1] = isnull;
+				i++;
+
+				/* binary format goes through the send functions */
+				if (cstate->binary)
+					continue;
+
+				if (need_delim)
+					CopySendChar(cstate, cstate->delim[0]);
+				need_delim = true;
+
+				if (isnull)
+				{
+					CopySendString(cstate, cstate->null_print_client);
+					continue;
+				}
+
+				if (!direct[attnum - 1])
+					string = OutputFunctionCall(&cstate->out_functions[attnum - 1],
+												values[attnum - 1]);
+				if (cstate->csv_mode)
+					CopyAttributeOutCSV(cstate, string,
+										cstate->force_quote_flags[attnum - 1],
+										ncols == 1);
+				else
+					CopyAttributeOutText(cstate, string);
+			}
+
+			MemoryContextSwitchTo(oldcontext);
+
+			if (cstate->binary)
+				CopyOneRowTo(cstate, InvalidOid, values, nulls);
+			else
+				CopySendEndOfRow(cstate);
+			processed++;
+			continue;
+		}
+
+		if (is_stmt_eof(handle))
+		{
+			release_stmt_handle(handle);
+			for (int i = 0; i < nhandles; i++)
+			{
+				if (RAW_HANDLE(handles[i]) == RAW_HANDLE(handle))
+				{
+					handles[i] = handles[--nhandles];
+					break;
+				}
+			}
+		}
+	}
+
+	MemoryContextDelete(rowcontext);
+
+	return processed;
+}
+
 /*
  * Emit one row during CopyTo().
  */
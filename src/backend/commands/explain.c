@@ -943,10 +943,16 @@ ExplainPreScanNode(PlanState *planstate, Bitmapset **rels_used)
 		case T_CteScan:
 		case T_NamedTuplestoreScan:
 		case T_WorkTableScan:
-		case T_RemoteScan:
 			*rels_used = bms_add_member(*rels_used,
 										((Scan *) plan)->scanrelid);
 			break;
+		case T_RemoteScan:
+			*rels_used = bms_add_member(*rels_used,
+										((RemoteScan *) plan)->scanrelid);
+			if (((RemoteScan *) plan)->joinrelid != 0)
+				*rels_used = bms_add_member(*rels_used,
+											((RemoteScan *) plan)->joinrelid);
+			break;
 		case T_ForeignScan:
 			*rels_used = bms_add_members(*rels_used,
 										 ((ForeignScan *) plan)->fs_relids);
@@ -3896,5 +3902,44 @@ show_remotescan_details(ExplainState *es, PlanState *ps)
 		ExplainPropertyInteger("Shard", NULL, rss->ss.ss_currentRelation->rd_rel->relshardid, es);
 		ExplainPropertyText("Remote SQL", rss->remote_sql.data, es);
 	}
+
+	/* NO. of batched key lookup queries sent, see ExecRemoteScanBatchFetch() */
+	if (es->analyze && rss->nbatches > 0)
+	{
+		if (es->format == EXPLAIN_FORMAT_TEXT)
+		{
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			appendStringInfo(es->str, "Remote Batches: " INT64_FORMAT "\n",
+							 rss->nbatches);
+		}
+		else
+			ExplainPropertyInteger("Remote Batches", NULL, rss->nbatches, es);
+	}
+
+	/* Final mode of an adaptive scan, see remote_scan_adapt() */
+	if (es->analyze && rss->adaptive)
+	{
+		const char *mode = rss->param_driven ? "param driven" : "fetch all";
+
+		if (es->format == EXPLAIN_FORMAT_TEXT)
+		{
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			if (rss->switched_at > 0)
+				appendStringInfo(es->str, "Remote Fetch: %s (switched after " INT64_FORMAT " rescans)",
+								 mode, rss->switched_at);
+			else
+				appendStringInfo(es->str, "Remote Fetch: %s", mode);
+			appendStringInfo(es->str, "  Remote Queries: " INT64_FORMAT "\n",
+							 rss->nqueries);
+		}
+		else
+		{
+			ExplainPropertyText("Remote Fetch", mode, es);
+			if (rss->switched_at > 0)
+				ExplainPropertyInteger("Remote Fetch Switched After", "rescans",
+									   rss->switched_at, es);
+			ExplainPropertyInteger("Remote Queries", NULL, rss->nqueries, es);
+		}
+	}
 }
 
@@ -1382,14 +1382,15 @@ vacuum_rel(Oid relid, RangeVar *relation, int options, VacuumParams *params)
 	}
 
 	/*
-	  dzw: Skip vacumming for remote relations.
+	  dzw: Skip vacumming for remote relations, but return true so that
+	  VACUUM ANALYZE still analyzes them.
 	*/
 	if (onerel && IsRemoteRelation(onerel))
 	{
 		relation_close(onerel, lmode);
 		PopActiveSnapshot();
 		CommitTransactionCommand();
-		return false;
+		return true;
 	}
 
 	/*
@@ -23,6 +23,7 @@
 
 #include "postgres.h"
 
+#include "access/xact.h"
 #include "executor/execParallel.h"
 #include "executor/executor.h"
 #include "executor/nodeAppend.h"
@@ -50,6 +51,7 @@
 #include "utils/memutils.h"
 #include "utils/snapmgr.h"
 #include "pgstat.h"
+#include "sharding/sharding_conn.h"
 
 /*
  * Magic numbers for parallel executor communication.  We use constants
@@ -1173,6 +1175,36 @@ ExecParallelCleanup(ParallelExecutorInfo *pei)
 	pfree(pei);
 }
 
+static bool
+ExecParallelHasRemoteScan(PlanState *planstate, void *context)
+{
+	if (planstate == NULL)
+		return false;
+	if (IsA(planstate, RemoteScanState))
+		return true;
+	return planstate_tree_walker(planstate, ExecParallelHasRemoteScan, context);
+}
+
+/*
+ * Whether workers may be launched to run 'planstate', the child of a Gather
+ * or Gather Merge node.
+ *
+ * Workers read remote tables through their own connections to the storage
+ * shards as autocommit stmts, out of the leader's XA txns, so they can't see
+ * what the leader's txn wrote, nor read by its snapshot. The planner only
+ * makes parallel remote scans out of txn blocks, but the plan may be run
+ * later in one, e.g. a prepared stmt or a cached plpgsql plan, or after the
+ * txn has written shards. Then the leader runs the plan alone.
+ */
+bool
+ExecParallelRemoteScanAllowed(PlanState *planstate)
+{
+	if (!IsTransactionBlock() && !MySQLWriteExecuted())
+		return true;
+
+	return !ExecParallelHasRemoteScan(planstate, NULL);
+}
+
 /*
  * Create a DestReceiver to write tuples we produce to the shm_mq designated
  * for that purpose.
@@ -116,6 +116,7 @@
 #include "executor/nodeWorktablescan.h"
 #include "nodes/nodeFuncs.h"
 #include "miscadmin.h"
+#include "utils/tuplestore.h"
 
 
 static TupleTableSlot *ExecProcNodeFirst(PlanState *node);
@@ -862,6 +863,48 @@ ExecSetTupleBound(int64 tuples_needed, PlanState *child_node)
 		for (i = 0; i < maState->ms_nplans; i++)
 			ExecSetTupleBound(tuples_needed, maState->mergeplans[i]);
 	}
+	else if (IsA(child_node, AppendState))
+	{
+		/*
+		 * An Append returns the rows of its children one after another, so
+		 * none of them needs to return more rows than the Append either.
+		 */
+		AppendState *aState = (AppendState *) child_node;
+		int			i;
+
+		for (i = 0; i < aState->as_nplans; i++)
+			ExecSetTupleBound(tuples_needed, aState->appendplans[i]);
+	}
+	else if (IsA(child_node, RemoteScanState))
+	{
+		/*
+		 * A RemoteScan sends the bound to the storage node as a LIMIT
+		 * clause, unless it has local quals that may discard rows.
+		 */
+		(void) ExecRemoteScanSetBound((RemoteScanState *) child_node,
+									  tuples_needed);
+	}
+	else if (IsA(child_node, MaterialState) &&
+			 ((Material *) child_node->plan)->remote_fetch_all &&
+			 IsA(outerPlanState(child_node), RemoteScanState))
+	{
+		/*
+		 * A Material node which fetches all rows of a RemoteScan at once,
+		 * because other remote scans share its storage node connection,
+		 * doesn't discard rows either. If the bound changes, the rows it
+		 * stored must be fetched again with the new bound.
+		 */
+		MaterialState *matState = (MaterialState *) child_node;
+
+		if (ExecRemoteScanSetBound((RemoteScanState *) outerPlanState(child_node),
+								   tuples_needed) &&
+			matState->tuplestorestate)
+		{
+			tuplestore_end(matState->tuplestorestate);
+			matState->tuplestorestate = NULL;
+			matState->eof_underlying = false;
+		}
+	}
 	else if (IsA(child_node, ResultState))
 	{
 		/*
@@ -53,6 +53,12 @@
  *			  nil	nil		 Scan	 Scan	  Scan	   Scan
  *							  |		  |		   |		|
  *							person employee student student-emp
+ *
+ *		If all subplans are remote scans, e.g. of the partitions of a
+ *		remote table, the append node sends the queries of all of them
+ *		to their storage nodes up front, and then returns rows of
+ *		whichever subplan's result is readable first, so that the
+ *		storage nodes execute the queries concurrently.
  */
 
 #include "postgres.h"
@@ -60,8 +66,12 @@
 #include "executor/execdebug.h"
 #include "executor/execPartition.h"
 #include "executor/nodeAppend.h"
+#include "executor/nodeRemotescan.h"
 #include "miscadmin.h"
 
+/* Scan remote subplans of append nodes concurrently */
+bool		enable_remote_async_append = true;
+
 /* Shared state for parallel-aware Append. */
 struct ParallelAppendState
 {
@@ -85,6 +95,8 @@ static bool choose_next_subplan_locally(AppendState *node);
 static bool choose_next_subplan_for_leader(AppendState *node);
 static bool choose_next_subplan_for_worker(AppendState *node);
 static void mark_invalid_subplans_as_finished(AppendState *node);
+static bool start_async_subplans(AppendState *node);
+static TupleTableSlot *exec_append_async(AppendState *node);
 
 /* ----------------------------------------------------------------
  *		ExecInitAppend
@@ -246,6 +258,24 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 	/* For parallel query, this will be overridden later. */
 	appendstate->choose_next_subplan = choose_next_subplan_locally;
 
+	/*
+	 * Scan the subplans concurrently if they are all remote scans, which
+	 * are forward only.
+	 */
+	appendstate->as_async = enable_remote_async_append && nplans > 1 &&
+		!(eflags & (EXEC_FLAG_EXPLAIN_ONLY | EXEC_FLAG_BACKWARD));
+	for (i = 0; i < nplans && appendstate->as_async; i++)
+	{
+		if (!IsA(appendplanstates[i], RemoteScanState))
+			appendstate->as_async = false;
+	}
+	if (appendstate->as_async)
+	{
+		appendstate->as_asyncplans = (int *) palloc(nplans * sizeof(int));
+		appendstate->as_asynchandles = (StmtSafeHandle *)
+			palloc(nplans * sizeof(StmtSafeHandle));
+	}
+
 	return appendstate;
 }
 
@@ -260,6 +290,10 @@ ExecAppend(PlanState *pstate)
 {
 	AppendState *node = castNode(AppendState, pstate);
 
+	if (node->as_async && node->as_whichplan != NO_MATCHING_SUBPLANS &&
+		(node->as_async_started || start_async_subplans(node)))
+		return exec_append_async(node);
+
 	if (node->as_whichplan < 0)
 	{
 		/*
@@ -382,6 +416,96 @@ ExecReScanAppend(AppendState *node)
 
 	/* Let choose_next_subplan_* function handle setting the first subplan */
 	node->as_whichplan = INVALID_SUBPLAN_INDEX;
+	node->as_async_started = false;
+}
+
+/* ----------------------------------------------------------------
+ *		start_async_subplans
+ *
+ *		Send the remote queries of all valid subplans. Returns false,
+ *		and gives up scanning the subplans concurrently, if some subplan
+ *		can't be driven this way, or this is a parallel-aware append.
+ * ----------------------------------------------------------------
+ */
+static bool
+start_async_subplans(AppendState *node)
+{
+	int			i;
+
+	if (node->choose_next_subplan != choose_next_subplan_locally)
+	{
+		node->as_async = false;
+		return false;
+	}
+
+	if (node->as_valid_subplans == NULL)
+		node->as_valid_subplans =
+			ExecFindMatchingSubPlans(node->as_prune_state);
+
+	node->as_nasync = 0;
+	i = -1;
+	while ((i = bms_next_member(node->as_valid_subplans, i)) >= 0)
+	{
+		RemoteScanState *subnode = (RemoteScanState *) node->appendplans[i];
+
+		if (!ExecRemoteScanStart(subnode))
+		{
+			/* Subplans already started are simply read in order. */
+			node->as_async = false;
+			return false;
+		}
+		node->as_asyncplans[node->as_nasync] = i;
+		node->as_asynchandles[node->as_nasync] = subnode->handle;
+		node->as_nasync++;
+	}
+
+	node->as_async_started = true;
+	return true;
+}
+
+/* ----------------------------------------------------------------
+ *		exec_append_async
+ *
+ *		Return the next row of whichever remaining subplan has its
+ *		result readable first, started by start_async_subplans().
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+exec_append_async(AppendState *node)
+{
+	while (node->as_nasync > 0)
+	{
+		StmtSafeHandle handle;
+		TupleTableSlot *result;
+		int			i;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/*
+		 * An invalid handle is returned if the remaining results are all
+		 * read up, then any remaining subplan just returns no more rows.
+		 */
+		handle = wait_for_readable_stmt(node->as_asynchandles,
+										node->as_nasync);
+		for (i = 0; i < node->as_nasync; i++)
+		{
+			if (RAW_HANDLE(node->as_asynchandles[i]) == RAW_HANDLE(handle))
+				break;
+		}
+		if (i == node->as_nasync)
+			i = 0;
+
+		result = ExecProcNode(node->appendplans[node->as_asyncplans[i]]);
+		if (!TupIsNull(result))
+			return result;
+
+		/* The subplan is exhausted, stop waiting for it */
+		node->as_nasync--;
+		node->as_asyncplans[i] = node->as_asyncplans[node->as_nasync];
+		node->as_asynchandles[i] = node->as_asynchandles[node->as_nasync];
+	}
+
+	return ExecClearTuple(node->ps.ps_ResultTupleSlot);
 }
 
 /* ----------------------------------------------------------------
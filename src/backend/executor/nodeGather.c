@@ -142,7 +142,8 @@ ExecGather(PlanState *pstate)
 		 * Sometimes we might have to run without parallelism; but if parallel
 		 * mode is active then we can try to fire up some workers.
 		 */
-		if (gather->num_workers > 0 && estate->es_use_parallel_mode)
+		if (gather->num_workers > 0 && estate->es_use_parallel_mode &&
+			ExecParallelRemoteScanAllowed(node->ps.lefttree))
 		{
 			ParallelContext *pcxt;
 
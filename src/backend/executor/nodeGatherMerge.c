@@ -187,7 +187,8 @@ ExecGatherMerge(PlanState *pstate)
 		 * Sometimes we might have to run without parallelism; but if parallel
 		 * mode is active then we can try to fire up some workers.
 		 */
-		if (gm->num_workers > 0 && estate->es_use_parallel_mode)
+		if (gm->num_workers > 0 && estate->es_use_parallel_mode &&
+			ExecParallelRemoteScanAllowed(node->ps.lefttree))
 		{
 			ParallelContext *pcxt;
 
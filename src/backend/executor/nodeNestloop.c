@@ -22,9 +22,76 @@
 #include "postgres.h"
 
 #include "executor/execdebug.h"
+#include "access/remote_dml.h"
 #include "executor/nodeNestloop.h"
+#include "executor/nodeRemotescan.h"
 #include "miscadmin.h"
 #include "utils/memutils.h"
+#include "utils/tuplestore.h"
+
+
+/*
+ * Get next outer tuple when the inner node is a RemoteScan doing batched key
+ * lookups. Outer tuples are read and buffered remote_scan_batch_size at a
+ * time, the inner node fetches the matches of all their keys in one remote
+ * query, then the buffered tuples are returned in their original order and
+ * each rescan of the inner node returns the matches of the current one.
+ */
+static TupleTableSlot *
+ExecNestLoopBatchedOuter(NestLoopState *node)
+{
+	NestLoop   *nl = (NestLoop *) node->js.ps.plan;
+	PlanState  *outerPlan = outerPlanState(node);
+	RemoteScanState *inner = (RemoteScanState *) innerPlanState(node);
+	ExprContext *econtext = node->js.ps.ps_ExprContext;
+	TupleTableSlot *slot = node->nl_OuterBatchSlot;
+	int			nbuffered = 0;
+	ListCell   *lc;
+
+	if (tuplestore_gettupleslot(node->nl_OuterBatch, true, false, slot))
+		return slot;
+
+	tuplestore_clear(node->nl_OuterBatch);
+	if (node->nl_OuterDone)
+		return NULL;
+
+	ExecRemoteScanBatchBegin(inner);
+	while (nbuffered < remote_scan_batch_size)
+	{
+		TupleTableSlot *outerTupleSlot = ExecProcNode(outerPlan);
+
+		if (TupIsNull(outerTupleSlot))
+		{
+			node->nl_OuterDone = true;
+			break;
+		}
+
+		tuplestore_puttupleslot(node->nl_OuterBatch, outerTupleSlot);
+		nbuffered++;
+
+		/* Set the params as for the join below, to collect the keys. */
+		foreach(lc, nl->nestParams)
+		{
+			NestLoopParam *nlp = (NestLoopParam *) lfirst(lc);
+			ParamExecData *prm;
+
+			prm = &(econtext->ecxt_param_exec_vals[nlp->paramno]);
+			prm->value = slot_getattr(outerTupleSlot,
+									  nlp->paramval->varattno,
+									  &(prm->isnull));
+		}
+		ExecRemoteScanBatchAddKey(inner);
+	}
+
+	if (nbuffered == 0)
+		return NULL;
+
+	ExecRemoteScanBatchFetch(inner);
+
+	if (tuplestore_gettupleslot(node->nl_OuterBatch, true, false, slot))
+		return slot;
+	return NULL;
+}
 
 
 /* ----------------------------------------------------------------
@@ -106,7 +173,10 @@ ExecNestLoop(PlanState *pstate)
 		if (node->nl_NeedNewOuter)
 		{
 			ENL1_printf("getting new outer tuple");
-			outerTupleSlot = ExecProcNode(outerPlan);
+			if (node->nl_BatchInner)
+				outerTupleSlot = ExecNestLoopBatchedOuter(node);
+			else
+				outerTupleSlot = ExecProcNode(outerPlan);
 
 			/*
 			 * if there are no more outer tuples, then the join is complete..
@@ -301,6 +371,21 @@ ExecInitNestLoop(NestLoop *node, EState *estate, int eflags)
 		eflags &= ~EXEC_FLAG_REWIND;
 	innerPlanState(nlstate) = ExecInitNode(innerPlan(node), estate, eflags);
 
+	/*
+	 * A param driven RemoteScan inner node may look up the keys of a batch of
+	 * outer tuples in one remote query instead of one query per outer tuple.
+	 */
+	if (IsA(innerPlanState(nlstate), RemoteScanState) &&
+		ExecRemoteScanBatchable((RemoteScanState *) innerPlanState(nlstate),
+								node->nestParams))
+	{
+		nlstate->nl_BatchInner = true;
+		nlstate->nl_OuterBatch = tuplestore_begin_heap(false, false, work_mem);
+		nlstate->nl_OuterBatchSlot =
+			ExecInitExtraTupleSlot(estate,
+								   ExecGetResultType(outerPlanState(nlstate)));
+	}
+
 	/*
 	 * Initialize result slot, type and projection.
 	 */
@@ -372,6 +457,8 @@ ExecEndNestLoop(NestLoopState *node)
 	 * clean out the tuple table
 	 */
 	ExecClearTuple(node->js.ps.ps_ResultTupleSlot);
+	if (node->nl_OuterBatch)
+		tuplestore_end(node->nl_OuterBatch);
 
 	/*
 	 * close down subplans
@@ -405,6 +492,11 @@ ExecReScanNestLoop(NestLoopState *node)
 	 * outer Vars are used as run-time keys...
 	 */
 
+	/* Drop the outer tuples buffered for batched key lookups. */
+	if (node->nl_OuterBatch)
+		tuplestore_clear(node->nl_OuterBatch);
+	node->nl_OuterDone = false;
+
 	node->nl_NeedNewOuter = true;
 	node->nl_MatchedOuter = false;
 }
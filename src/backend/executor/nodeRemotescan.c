@@ -40,15 +40,53 @@
 #include "nodes/nodeFuncs.h"
 #include "nodes/makefuncs.h"
 #include "nodes/remote_input.h"
+#include "optimizer/cost.h"
 #include "catalog/pg_enum.h"
 #include "utils/builtins.h"
 #include "catalog/pg_type.h"
 #include "catalog/heap.h"
 #include "parser/parsetree.h"
+#include "utils/hsearch.h"
+#include "utils/typcache.h"
 #include "miscadmin.h"
 
+/* Max NO. of key columns of a batched key lookup. */
+#define REMOTE_BATCH_MAX_KEYS 4
+
+/* Min NO. of rescans observed before an adaptive scan switches its mode. */
+#define REMOTE_ADAPT_MIN_SCANS 16
+
+/*
+ * Hash entry of a batched key lookup, the key is the first nbatch_keys
+ * Datums of 'keys'.
+ */
+typedef struct RemoteBatchEntry
+{
+	Datum keys[REMOTE_BATCH_MAX_KEYS];
+	List *tuples;	/* MinimalTuples matching the keys */
+} RemoteBatchEntry;
+
+int remote_scan_batch_size = 100;
+
+extern int output_const_type_value(StringInfo str, bool isnull, Oid type, Datum value);
+
+/*
+  pg_proc OIDs of count(any), sum(int4) and sum(int2), which the state of
+  avg(int4) and avg(int2) is built from, see alloc_remote_agg_scanvar().
+*/
+#define COUNT_ANY_AGG_OID 2147
+#define SUM_INT4_AGG_OID 2108
+#define SUM_INT2_AGG_OID 2109
+
 static TupleTableSlot *RemoteNext(RemoteScanState *node);
-static void generate_remote_sql(RemoteScanState *rss);
+static void send_remote_scan_stmt(RemoteScanState *node);
+static void generate_remote_sql(RemoteScanState *rss, bool batch);
+static void init_batch_keys(RemoteScanState *rss, ScanTupleGenContext *context);
+static void alloc_remote_agg_scanvar(ScanTupleGenContext *context, TargetEntry *tle);
+static bool get_batch_keys(RemoteScanState *node, Datum *keys);
+static void init_adaptive_quals(RemoteScanState *rss, ScanTupleGenContext *context);
+static void remote_scan_adapt(RemoteScanState *node);
+static int64 remote_scan_bound(RemoteScanState *node);
 
 /* ----------------------------------------------------------------
  *						Scan Support
@@ -71,6 +109,20 @@ RemoteNext(RemoteScanState *node)
 	 */
 	slot = node->ss.ss_ScanTupleSlot;
 
+	/* Return the matches of current params from the batch result. */
+	if (node->batch_active)
+	{
+		if (node->batch_cursor == NULL)
+		{
+			ExecClearTuple(slot);
+			return slot;
+		}
+
+		MinimalTuple tup = (MinimalTuple)lfirst(node->batch_cursor);
+		node->batch_cursor = lnext(node->batch_cursor);
+		return ExecStoreMinimalTuple(tup, slot, false);
+	}
+
 	/* Reach the EOF of tuples from connection */
 	if (is_stmt_eof(node->handle))
 	{
@@ -86,14 +138,25 @@ RemoteNext(RemoteScanState *node)
 	{
 		size_t *lengths;
 		enum enum_field_types *fieldtypes;
-		
+		enum enum_field_types *bindtypes;
+
+		node->nrows_read++;
 		lengths = get_stmt_row_lengths(node->handle);
 		fieldtypes = get_stmt_field_types(node->handle);
-		ExecStoreRemoteTuple(node->typeInputInfo,
-				     mysql_row, /* tuple to store */
-				     lengths,
-				     fieldtypes,
-				     slot); /* slot to store in */
+		bindtypes = get_stmt_bind_types(node->handle);
+		if (bindtypes)
+			ExecStoreRemoteBinaryTuple(node->typeInputInfo,
+						   mysql_row,
+						   lengths,
+						   fieldtypes,
+						   bindtypes,
+						   slot);
+		else
+			ExecStoreRemoteTuple(node->typeInputInfo,
+					     mysql_row, /* tuple to store */
+					     lengths,
+					     fieldtypes,
+					     slot); /* slot to store in */
 	}
 	else
 	{
@@ -142,19 +205,74 @@ ExecRemoteScan(PlanState *pstate)
 	}
 
 
-	if (!stmt_handle_valid(node->handle))
+	if (!node->batch_active && !stmt_handle_valid(node->handle))
 	{
 		/*
 		   1st row is to be returned from this remote table.
 		   */
-		size_t stmtlen = lengthStringInfo(&node->remote_sql);
-		node->handle = send_stmt_async(node->asi, MemoryContextStrdup(TopTransactionContext, node->remote_sql.data),
-					       stmtlen, CMD_SELECT, true, SQLCOM_SELECT, node->will_rewind);
+		send_remote_scan_stmt(node);
 	}
 
-	return ExecScan(&node->ss,
+	TupleTableSlot *slot = ExecScan(&node->ss,
 					(ExecScanAccessMtd) RemoteNext,
 					(ExecScanRecheckMtd) RemoteRecheck);
+	if (!TupIsNull(slot))
+		node->nrows_returned++;
+	return slot;
+}
+
+/*
+ * Send node->remote_sql to the storage node, the handle is kept in
+ * node->handle.
+ */
+static void
+send_remote_scan_stmt(RemoteScanState *node)
+{
+	size_t stmtlen = lengthStringInfo(&node->remote_sql);
+	char *stmt = MemoryContextStrdup(TopTransactionContext, node->remote_sql.data);
+
+	node->nqueries++;
+
+	/*
+	  A param driven scan sends a different stmt on each rescan, it's not
+	  worth the extra PREPARE round trip unless the stmt is a template
+	  prepared once and cached.
+	*/
+	if (node->use_prepared)
+		node->handle = send_stmt_async_prepared(node->asi, stmt, stmtlen,
+							true, node->will_rewind,
+							node->remote_params);
+	else if (mysql_binary_protocol && !node->param_driven)
+		node->handle = send_stmt_async_binary(node->asi, stmt, stmtlen,
+						      true, node->will_rewind);
+	else
+		node->handle = send_stmt_async(node->asi, stmt, stmtlen, CMD_SELECT,
+					       true, SQLCOM_SELECT, node->will_rewind);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecRemoteScanStart
+ *
+ *		Send the remote query of the scan now if it's not sent yet, so
+ *		that the storage node works on it before the 1st row is pulled.
+ *		Rows are then waited for via node->handle. Returns false if the
+ *		scan doesn't read its rows from a remote query of its own, i.e.
+ *		it fetches no data or returns the matches of a batched key lookup.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecRemoteScanStart(RemoteScanState *node)
+{
+	/* Same as ExecProcNode() would do before pulling the 1st row */
+	if (node->ss.ps.chgParam != NULL)
+		ExecReScan((PlanState *) node);
+
+	if (!node->fetches_remote_data || node->batch_active || !node->asi)
+		return false;
+
+	if (!stmt_handle_valid(node->handle))
+		send_remote_scan_stmt(node);
+	return true;
 }
 
 typedef struct FindParamChangeContext
@@ -313,11 +431,27 @@ ExecScanTypeFromTL(EState *estate, RemoteScanState *rss,
 	Relation rel, bool skipjunk)
 {
 	Plan *plan = rss->ss.ps.plan;
+	RemoteScan *rs = (RemoteScan *)plan;
 	List *targetList = plan->targetlist;
 	ListCell   *l;
 
+	/*
+	 * The targets of a remote aggregation are rewritten into other exprs, see
+	 * alloc_remote_agg_scanvar(). Do it on a copy so that the plan keeps the
+	 * partial Aggrefs the plan above refers to, e.g. in EXPLAIN.
+	 */
+	if (rs->remote_agg)
+		targetList = rss->agg_tlist = copyObject(plan->targetlist);
+
 	ScanTupleGenContext context;
 	InitScanTupleGenContext(&context, (PlanState*)rss, skipjunk);
+	context.rpec.qualify_columns = (rs->joinrelid != 0);
+	/*
+	  An adaptive scan fetches the same columns in both modes, so params
+	  are never pushed down as part of a target.
+	*/
+	if (rss->adaptive)
+		context.rpec.exec_param_quals = true;
 	/*
 	 * Alloc scantuples for the target list.
 	 * If the target item can be pushed down as a whole, a scanvar is assigned to it;
@@ -332,12 +466,18 @@ ExecScanTypeFromTL(EState *estate, RemoteScanState *rss,
 		TargetEntry *tle = lfirst_node(TargetEntry, l);
 		if ((skipjunk && tle->resjunk) || !tle->expr)
 			continue;
-		(void) alloc_scanvar_for_expr(&context, tle->expr);
+		if (rs->remote_agg)
+			alloc_remote_agg_scanvar(&context, tle);
+		else
+			(void) alloc_scanvar_for_expr(&context, tle->expr);
 	}
 
 	/*
-	 * Alloc scantuples for quals which cannot be pushed down
+	 * Alloc scantuples for quals which cannot be pushed down. Quals of an
+	 * adaptive scan are split as if param driven.
 	 */
+	if (rss->adaptive)
+		context.rpec.exec_param_quals = false;
 	StringInfoData buff;
 	initStringInfo2(&buff, 256, estate->es_query_cxt);
 	List *qual = rss->ss.ps.plan->qual;
@@ -350,11 +490,31 @@ ExecScanTypeFromTL(EState *estate, RemoteScanState *rss,
 			rss->quals_pushdown = lappend(rss->quals_pushdown, expr);
 			continue;
 		}
+		/* Rows are filtered before aggregation or join, done remotely. */
+		if (rs->remote_agg || rs->joinrelid != 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("Kunlun-db: Filter of a remote aggregation or join can't be pushed down to storage node.")));
 		alloc_scanvar_for_expr(&context, expr);
 		local_quals = lappend(local_quals, copyObject(expr));
 		resetStringInfo(&buff);
 	}
 
+	foreach (l, rs->joinquals)
+	{
+		resetStringInfo(&buff);
+		if (snprint_expr(&buff, (Expr *)lfirst(l), &context.rpec) < 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("Kunlun-db: Join condition of a remote join can't be pushed down to storage node.")));
+	}
+
+	if (rss->adaptive)
+		init_adaptive_quals(rss, &context);
+
+	if (rss->param_driven && !rss->check_exists && remote_scan_batch_size > 1)
+		init_batch_keys(rss, &context);
+
 	/*
 	 * Note down the real capacity, but also make sure typeInfo->natts is the
 	 * number valid attrs. The original design of TupleDesc facility didn't
@@ -420,6 +580,19 @@ ExecScanTypeFromTL(EState *estate, RemoteScanState *rss,
 	/* Initalize the ExprState with rewrited quals */
 	rss->ss.ps.qual = ExecInitQual(local_quals_new, (PlanState *) &rss->ss.ps);
 
+	if (rss->adaptive)
+	{
+		List *fetch_all_quals = list_copy(local_quals_new);
+
+		foreach(l, rss->param_quals)
+			fetch_all_quals = lappend(fetch_all_quals,
+				replace_expr_with_scanvar_mutator((Node *)lfirst(l), &context));
+		rss->local_qual = rss->ss.ps.qual;
+		rss->fetch_all_qual = ExecInitQual(fetch_all_quals, (PlanState *) &rss->ss.ps);
+		if (!rss->param_driven)
+			rss->ss.ps.qual = rss->fetch_all_qual;
+	}
+
 	/* Save the remaining quals for explain */
 	rss->orignal_qual = rss->ss.ps.plan->qual;
 	rss->ss.ps.plan->qual = local_quals;
@@ -438,11 +611,233 @@ ExecScanTypeFromTL(EState *estate, RemoteScanState *rss,
 	rss->unpushable_tl = unpushed_exprs_new;
 
 	initStringInfo2(&rss->remote_sql, 512, estate->es_query_cxt);
-	if (!rss->param_driven) generate_remote_sql(rss);
+	if (!rss->param_driven) generate_remote_sql(rss, false);
 
 	return rss->ss.ps.scandesc;
 }
 
+/*
+ * In a RemoteScan doing partial aggregation, every target entry is either a
+ * grouping expression or a partial Aggref, each is fetched as one column of
+ * the remote query, see snprint_agg_expr(). The {count, sum} state of
+ * avg(int2/int4) is built locally from count() and sum() of the storage
+ * node, sum() is coalesced to 0 as the state has no NULLs. 'tle' belongs to
+ * RemoteScanState.agg_tlist, never to the plan.
+ */
+static void
+alloc_remote_agg_scanvar(ScanTupleGenContext *context, TargetEntry *tle)
+{
+	List *exprs;
+	ListCell *lc;
+
+	if (IsA(tle->expr, Aggref) &&
+		strcmp(get_func_name(((Aggref *)tle->expr)->aggfnoid), "avg") == 0)
+	{
+		Aggref *aggref = (Aggref *)tle->expr;
+		Aggref *count = copyObject(aggref);
+		Aggref *sum = copyObject(aggref);
+		CoalesceExpr *coalesce = makeNode(CoalesceExpr);
+		ArrayExpr *state = makeNode(ArrayExpr);
+
+		count->aggfnoid = COUNT_ANY_AGG_OID;
+		count->aggtype = INT8OID;
+		count->aggtranstype = INT8OID;
+		sum->aggfnoid = (linitial_oid(aggref->aggargtypes) == INT2OID ?
+						 SUM_INT2_AGG_OID : SUM_INT4_AGG_OID);
+		sum->aggtype = INT8OID;
+		sum->aggtranstype = INT8OID;
+
+		coalesce->coalescetype = INT8OID;
+		coalesce->coalescecollid = InvalidOid;
+		coalesce->args = list_make2(sum,
+			makeConst(INT8OID, -1, InvalidOid, sizeof(int64),
+					  Int64GetDatum(0), false, FLOAT8PASSBYVAL));
+		coalesce->location = -1;
+
+		state->array_typeid = aggref->aggtype;
+		state->array_collid = InvalidOid;
+		state->element_typeid = INT8OID;
+		state->elements = list_make2(count, coalesce);
+		state->multidims = false;
+		state->location = -1;
+
+		tle->expr = (Expr *)state;
+		exprs = state->elements;
+	}
+	else
+		exprs = list_make1(tle->expr);
+
+	foreach (lc, exprs)
+	{
+		Expr *expr = (Expr *)lfirst(lc);
+
+		alloc_scanvar_for_expr(context, expr);
+		if (!lookup_scanvar_for_expr(context, expr))
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("Kunlun-db: Expression of a remote aggregation can't be pushed down to storage node.")));
+	}
+}
+
+/*
+ * If qual is 'col = $n' where $n is a PARAM_EXEC param of the same type as
+ * col and of a type whose '=' is a plain binary comparison on both sides,
+ * return true and the Var and the Param. Text types are excluded because
+ * MySQL would compare them by collation, which may match rows that our
+ * own hash lookup won't.
+ */
+static bool
+is_batch_key_qual(Expr *qual, Var **pvar, Param **pparam)
+{
+	if (!IsA(qual, OpExpr) || list_length(((OpExpr *)qual)->args) != 2)
+		return false;
+
+	OpExpr *op = (OpExpr *)qual;
+	Node *larg = (Node *)linitial(op->args);
+	Node *rarg = (Node *)lsecond(op->args);
+	Var *var;
+	Param *param;
+
+	if (IsA(larg, RelabelType))
+		larg = (Node *)((RelabelType *)larg)->arg;
+	if (IsA(rarg, RelabelType))
+		rarg = (Node *)((RelabelType *)rarg)->arg;
+
+	if (IsA(larg, Var) && IsA(rarg, Param))
+	{
+		var = (Var *)larg;
+		param = (Param *)rarg;
+	}
+	else if (IsA(larg, Param) && IsA(rarg, Var))
+	{
+		var = (Var *)rarg;
+		param = (Param *)larg;
+	}
+	else
+		return false;
+
+	if (param->paramkind != PARAM_EXEC || var->varattno <= 0 ||
+		var->vartype != param->paramtype)
+		return false;
+
+	switch (var->vartype)
+	{
+	case BOOLOID:
+	case INT2OID:
+	case INT4OID:
+	case INT8OID:
+	case OIDOID:
+	case DATEOID:
+	case TIMESTAMPOID:
+	case TIMESTAMPTZOID:
+		break;
+	default:
+		return false;
+	}
+
+	if (op->opno != lookup_type_cache(var->vartype, TYPECACHE_EQ_OPR)->eq_opr)
+		return false;
+
+	*pvar = var;
+	*pparam = param;
+	return true;
+}
+
+/*
+ * Find out whether the param driven scan can do batched key lookups, i.e.
+ * every pushed down qual that depends on params is a 'col = $n' key qual,
+ * and if so add the key columns to the scan tuple so that fetched rows can
+ * be matched to their keys.
+ */
+static void
+init_batch_keys(RemoteScanState *rss, ScanTupleGenContext *context)
+{
+	List *key_quals = NIL, *key_vars = NIL, *key_params = NIL;
+	ListCell *lc, *lc2;
+	FindParamsContext fpc;
+
+	fpc.has_rescan_params = false;
+	has_dependent_params((Node *)context->exprs, &fpc);
+	if (fpc.has_rescan_params)
+		return;
+
+	foreach(lc, rss->quals_pushdown)
+	{
+		Expr *qual = (Expr *)lfirst(lc);
+		Var *var;
+		Param *param;
+
+		fpc.has_rescan_params = false;
+		has_dependent_params((Node *)qual, &fpc);
+		if (!fpc.has_rescan_params)
+			continue;
+		if (!is_batch_key_qual(qual, &var, &param))
+			return;
+
+		key_quals = lappend(key_quals, qual);
+		key_vars = lappend(key_vars, var);
+		key_params = lappend(key_params, param);
+	}
+
+	int nkeys = list_length(key_quals);
+	if (nkeys == 0 || nkeys > REMOTE_BATCH_MAX_KEYS)
+		return;
+
+	rss->batch_key_quals = key_quals;
+	rss->nbatch_keys = nkeys;
+	rss->batch_key_attnos = palloc(sizeof(AttrNumber) * nkeys);
+	rss->batch_key_paramids = palloc(sizeof(int) * nkeys);
+	rss->batch_key_types = palloc(sizeof(Oid) * nkeys);
+
+	int i = 0;
+	forboth(lc, key_vars, lc2, key_params)
+	{
+		Var *var = (Var *)lfirst(lc);
+		Param *param = (Param *)lfirst(lc2);
+		Var *scanvar;
+
+		(void) alloc_scanvar_for_expr(context, (Expr *)var);
+		scanvar = lookup_scanvar_for_expr(context, (Expr *)var);
+		Assert(scanvar);
+
+		rss->batch_key_attnos[i] = scanvar->varattno;
+		rss->batch_key_paramids[i] = param->paramid;
+		rss->batch_key_types[i] = var->vartype;
+		i++;
+	}
+}
+
+/*
+ * Find the pushed down quals of an adaptive scan that depend on rescan
+ * params, and add the columns to evaluate them locally in fetch all mode to
+ * the scan tuple. The scan isn't adaptive if there are none.
+ */
+static void
+init_adaptive_quals(RemoteScanState *rss, ScanTupleGenContext *context)
+{
+	FindParamsContext fpc;
+	ListCell *lc;
+
+	foreach(lc, rss->quals_pushdown)
+	{
+		fpc.has_rescan_params = false;
+		has_dependent_params((Node *)lfirst(lc), &fpc);
+		if (fpc.has_rescan_params)
+			rss->param_quals = lappend(rss->param_quals, lfirst(lc));
+	}
+
+	if (rss->param_quals == NIL)
+	{
+		rss->adaptive = false;
+		return;
+	}
+
+	context->rpec.exec_param_quals = true;
+	foreach(lc, rss->param_quals)
+		(void) alloc_scanvar_for_expr(context, (Expr *)lfirst(lc));
+	context->rpec.exec_param_quals = !rss->param_driven;
+}
+
 static bool
 contain_param_exec(Plan *plan)
 {
@@ -463,7 +858,8 @@ contain_param_exec(Plan *plan)
 
 bool IsRemoteScanTotallyPushdown(RemoteScanState *rss, List *unused_tl)
 {
-	if (rss->param_driven || list_length(rss->ss.ps.plan->qual) > 0)
+	if (rss->param_driven || rss->adaptive ||
+		list_length(rss->ss.ps.plan->qual) > 0)
 		return false;
 	ListCell *lc1, *lc2;
 	foreach (lc1, rss->unpushable_tl)
@@ -505,6 +901,18 @@ void init_type_input_info(TypeInputInfo **tii, TupleTableSlot *slot,
 
 
 int remote_param_fetch_threshold = 1024*1024*256;
+bool remote_scan_adaptive = true;
+
+/*
+ * Whether a result of 'rsize' bytes is small enough to be fetched at once.
+ */
+static bool
+remote_fetch_all_fits(double rsize)
+{
+	return rsize <= mysql_max_packet_size && rsize <= MaxAllocSize &&
+		   rsize <= remote_param_fetch_threshold;
+}
+
 static bool decide_remote_scan_param_driven(RemoteScan *rs)
 {
 	Plan *plan = (Plan*)rs;
@@ -527,10 +935,95 @@ static bool decide_remote_scan_param_driven(RemoteScan *rs)
 			break;
 	}
 end:
-	return fpc.has_rescan_params &&
-		   (estimated_rsize > mysql_max_packet_size ||
-		    estimated_rsize > MaxAllocSize ||
-		    estimated_rsize > remote_param_fetch_threshold);
+	return fpc.has_rescan_params && !remote_fetch_all_fits(estimated_rsize);
+}
+
+/*
+ * Whether the scan can switch between param driven and fetch all modes at
+ * runtime. Rows of a remote aggregation or join, or of an EXISTS() check
+ * limited to 1 row, can't be filtered locally.
+ */
+static bool
+remote_scan_can_adapt(RemoteScan *rs)
+{
+	return remote_scan_adaptive && contain_param_exec((Plan *)rs) &&
+		   !rs->remote_agg && rs->joinrelid == 0 && !rs->check_exists;
+}
+
+/*
+ * Switch the mode of an adaptive scan once the observed costs of its
+ * current mode cross over the estimated costs of the other mode, using the
+ * same cost units as cost_remotescan().
+ *
+ * In param driven mode each rescan costs a statement and the transfer of
+ * its rows, fetch all mode costs one statement transferring the whole table
+ * and then reading all of its rows locally on each rescan. Assuming as many
+ * rescans are still to come as observed, switch to fetch all when that's
+ * cheaper including the whole table transfer, which needs the table's
+ * row count from ANALYZE.
+ *
+ * In fetch all mode the whole result has been paid for, switch to param
+ * driven when reading all rows on each rescan costs more than a statement
+ * transferring the rows that pass the local quals.
+ */
+static void
+remote_scan_adapt(RemoteScanState *node)
+{
+	Plan *plan = node->ss.ps.plan;
+	double nscans = node->nscans;
+	double row_xfer_cost = remote_tuple_cost + remote_byte_cost * plan->plan_width;
+	double row_read_cost = cpu_tuple_cost +
+		cpu_operator_cost * list_length(node->param_quals);
+	double rows_read, param_cost, fetch_all_cost;
+
+	if (node->switched_at > 0 || node->nbatches > 0 ||
+		nscans < REMOTE_ADAPT_MIN_SCANS)
+		return;
+
+	rows_read = node->nrows_read / nscans;
+	if (node->param_driven)
+	{
+		double reltuples = node->ss.ss_currentRelation->rd_rel->reltuples;
+
+		if (reltuples <= 0 ||
+			!remote_fetch_all_fits(reltuples * plan->plan_width))
+			return;
+
+		param_cost = remote_stmt_cost + rows_read * row_xfer_cost;
+		fetch_all_cost = reltuples * row_read_cost;
+		if (nscans * (param_cost - fetch_all_cost) <=
+			remote_stmt_cost + reltuples * row_xfer_cost)
+			return;
+	}
+	else
+	{
+		param_cost = remote_stmt_cost +
+			node->nrows_returned / nscans * row_xfer_cost;
+		fetch_all_cost = rows_read * row_read_cost;
+		if (fetch_all_cost <= param_cost)
+			return;
+	}
+
+	if (stmt_handle_valid(node->handle))
+	{
+		cancel_stmt_async(node->handle);
+		release_stmt_handle(node->handle);
+		node->handle = INVALID_STMT_HANLE;
+	}
+
+	node->param_driven = !node->param_driven;
+	node->ss.ps.qual = node->param_driven ? node->local_qual : node->fetch_all_qual;
+	/* A LIMIT can't be pushed down with quals evaluated locally. */
+	node->tuples_needed = remote_scan_bound(node);
+	node->switched_at = node->total_scans;
+	node->nscans = 0;
+	node->nrows_read = 0;
+	node->nrows_returned = 0;
+
+	elog(DEBUG1, "Remote scan of %s switched to %s mode after " INT64_FORMAT " rescans.",
+		 RelationGetRelationName(node->ss.ss_currentRelation),
+		 node->param_driven ? "param driven" : "fetch all",
+		 node->total_scans);
 }
 
 /* ----------------------------------------------------------------
@@ -559,8 +1052,9 @@ ExecInitRemoteScan(RemoteScan *node, EState *estate, int eflags)
 	scanstate->long_exprs_bmp = NULL;
 	scanstate->check_exists = node->check_exists;
 	scanstate->handle = INVALID_STMT_HANLE;
+	scanstate->tuples_needed = -1;
+	scanstate->tuples_bound = -1;
 
-	scanstate->param_driven = decide_remote_scan_param_driven(node);
 	/*
 	 * Miscellaneous initialization
 	 *
@@ -579,6 +1073,16 @@ ExecInitRemoteScan(RemoteScan *node, EState *estate, int eflags)
 							 node->scanrelid,
 							 eflags);
 
+	/*
+	  An adaptive scan starts param driven if the table's size is known to
+	  estimate when to switch, see remote_scan_adapt().
+	*/
+	scanstate->param_driven = decide_remote_scan_param_driven(node);
+	scanstate->adaptive = !(eflags & EXEC_FLAG_REMOTE_FETCH_NO_DATA) &&
+		remote_scan_can_adapt(node);
+	if (scanstate->adaptive && rel->rd_rel->reltuples > 0)
+		scanstate->param_driven = true;
+
 	if (eflags & EXEC_FLAG_REMOTE_FETCH_NO_DATA)
 	{
 		scanstate->fetches_remote_data = false;
@@ -605,7 +1109,15 @@ ExecInitRemoteScan(RemoteScan *node, EState *estate, int eflags)
 	/*
 	 * Init the mapping from source data to target list.
 	*/
-	ExecAssignScanProjectionInfo(&scanstate->ss);
+	if (node->remote_agg)
+		scanstate->ss.ps.ps_ProjInfo =
+			ExecBuildProjectionInfo(scanstate->agg_tlist,
+									scanstate->ss.ps.ps_ExprContext,
+									scanstate->ss.ps.ps_ResultTupleSlot,
+									&scanstate->ss.ps,
+									scanstate->ss.ss_ScanTupleSlot->tts_tupleDescriptor);
+	else
+		ExecAssignScanProjectionInfo(&scanstate->ss);
 
 	/*
 	  In EXPLAIN stmt, other nodes expect the scan type objects including
@@ -617,7 +1129,7 @@ ExecInitRemoteScan(RemoteScan *node, EState *estate, int eflags)
 	init_type_input_info(&scanstate->typeInputInfo,
 		scanstate->ss.ss_ScanTupleSlot, estate);
 
-	scanstate->asi = GetAsyncStmtInfo(rel->rd_rel->relshardid);
+	scanstate->asi = GetAsyncStmtInfoForRead(rel->rd_rel->relshardid);
 
 end:
 	/*
@@ -712,6 +1224,24 @@ ExecReScanRemoteScan(RemoteScanState *node)
 	   rewind by seeking to start of result set.
 	   */
 
+	if (node->batch_active)
+	{
+		Datum keys[REMOTE_BATCH_MAX_KEYS];
+		RemoteBatchEntry *entry = NULL;
+
+		/* The matches were fetched by ExecRemoteScanBatchFetch(). */
+		if (get_batch_keys(node, keys))
+			entry = hash_search(node->batch_hash, keys, HASH_FIND, NULL);
+		node->batch_cursor = entry ? list_head(entry->tuples) : NULL;
+		ExecScanReScan((ScanState *) node);
+		return;
+	}
+
+	node->nscans++;
+	node->total_scans++;
+	if (node->adaptive)
+		remote_scan_adapt(node);
+
 	bool reuse_previous = bms_is_empty(node->ss.ps.chgParam) || !node->param_driven;
 	if (!reuse_previous)
 	{
@@ -719,12 +1249,16 @@ ExecReScanRemoteScan(RemoteScanState *node)
 		pcc.chgParams = node->ss.ps.chgParam;
 		pcc.params_changed = false;
 		ListCell *lc;
-		foreach(lc, node->ss.ps.plan->qual)
+		/* Both pushed down quals and local quals may use the params. */
+		List *quals = list_concat(list_copy(node->quals_pushdown),
+					  list_copy(node->ss.ps.plan->qual));
+		foreach(lc, quals)
 		{
 			expression_tree_walker((Node*)lfirst(lc), dependent_params_changed, &pcc);
 			if (pcc.params_changed)
 				break;
 		}
+		list_free(quals);
 		reuse_previous = !pcc.params_changed;
 	}
 
@@ -755,15 +1289,73 @@ ExecReScanRemoteScan(RemoteScanState *node)
 		}
 
 		initStringInfo2(&node->remote_sql, 512, node->ss.ps.state->es_query_cxt);
-		generate_remote_sql(node);
+		generate_remote_sql(node, false);
 
 	}
 
 	ExecScanReScan((ScanState *) node);
 }
 
+/* ----------------------------------------------------------------
+ *		ExecRemoteScanSetBound
+ *
+ *		Set the max NO. of rows the parent node needs, see
+ *		ExecSetTupleBound(). The bound is sent to the storage node as a
+ *		LIMIT clause if no fetched row can be discarded locally, i.e. all
+ *		quals are pushed down, and the rows aren't partially aggregated
+ *		groups. Returns true if the remote query changed,
+ *		in which case any result of the previous one is discarded.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecRemoteScanSetBound(RemoteScanState *node, int64 tuples_needed)
+{
+	node->tuples_bound = tuples_needed;
+	tuples_needed = remote_scan_bound(node);
+
+	if (tuples_needed == node->tuples_needed)
+		return false;
+	node->tuples_needed = tuples_needed;
+
+	if (stmt_handle_valid(node->handle))
+	{
+		cancel_stmt_async(node->handle);
+		release_stmt_handle(node->handle);
+		node->handle = INVALID_STMT_HANLE;
+	}
+
+	/* A param driven scan generates its query on rescan. */
+	if (!node->param_driven)
+	{
+		initStringInfo2(&node->remote_sql, 512, node->ss.ps.state->es_query_cxt);
+		generate_remote_sql(node, false);
+	}
+	return true;
+}
+
+/*
+ * The LIMIT to send for the bound set by the parent, -1 if none can be sent
+ * in the current mode of the scan, see ExecRemoteScanSetBound().
+ */
+static int64
+remote_scan_bound(RemoteScanState *node)
+{
+	if (node->ss.ps.qual != NULL || node->check_exists ||
+		!node->fetches_remote_data ||
+		((RemoteScan *)node->ss.ps.plan)->remote_agg)
+		return -1;
+	return node->tuples_bound;
+}
+
 /* ----------------------------------------------------------------
  *						Parallel Scan Support
+ *
+ *		A remote table's rows are returned by one statement sent to its
+ *		storage shard, which can't be divided among parallel workers, so
+ *		remote scans are never parallel aware.  Instead whole remote scans,
+ *		e.g. the partitions under a Parallel Append, are handed to workers,
+ *		each of which sends the statements through its own connections to
+ *		the storage shards.  There's no shared state to set up.
  * ----------------------------------------------------------------
  */
 
@@ -778,20 +1370,20 @@ void
 ExecRemoteScanEstimate(RemoteScanState *node,
 					ParallelContext *pcxt)
 {
-	Assert(false);
+	/* nothing to do */
 }
 
 /* ----------------------------------------------------------------
  *		ExecRemoteScanInitializeDSM
  *
- *		Set up a parallel heap scan descriptor.
+ *		Set up shared state of the scan in the DSM.
  * ----------------------------------------------------------------
  */
 void
 ExecRemoteScanInitializeDSM(RemoteScanState *node,
 						 ParallelContext *pcxt)
 {
-	Assert(false);
+	/* nothing to do */
 }
 
 /* ----------------------------------------------------------------
@@ -804,7 +1396,7 @@ void
 ExecRemoteScanReInitializeDSM(RemoteScanState *node,
 						   ParallelContext *pcxt)
 {
-	Assert(false);
+	/* nothing to do */
 }
 
 /* ----------------------------------------------------------------
@@ -817,10 +1409,185 @@ void
 ExecRemoteScanInitializeWorker(RemoteScanState *node,
 							ParallelWorkerContext *pwcxt)
 {
-	Assert(false);
+	/* nothing to do */
+}
+
+/* ----------------------------------------------------------------
+ *						Batched Key Lookup Support
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * Get current values of the key params, return false if any of them is NULL,
+ * which can't match any row.
+ */
+static bool
+get_batch_keys(RemoteScanState *node, Datum *keys)
+{
+	ParamExecData *prms = node->ss.ps.ps_ExprContext->ecxt_param_exec_vals;
+
+	memset(keys, 0, sizeof(Datum) * REMOTE_BATCH_MAX_KEYS);
+	for (int i = 0; i < node->nbatch_keys; i++)
+	{
+		ParamExecData *prm = prms + node->batch_key_paramids[i];
+
+		if (prm->isnull)
+			return false;
+		keys[i] = prm->value;
+	}
+	return true;
+}
+
+/*
+ * Whether the param driven scan can do batched key lookups for a NestLoop
+ * parent which sets nestParams, i.e. all key params are set by the NestLoop.
+ */
+bool
+ExecRemoteScanBatchable(RemoteScanState *node, List *nestParams)
+{
+	ListCell *lc;
+
+	if (node->batch_key_quals == NIL || !node->fetches_remote_data ||
+		remote_scan_batch_size <= 1)
+		return false;
+
+	for (int i = 0; i < node->nbatch_keys; i++)
+	{
+		bool found = false;
+
+		foreach(lc, nestParams)
+		{
+			NestLoopParam *nlp = (NestLoopParam *) lfirst(lc);
+
+			if (nlp->paramno == node->batch_key_paramids[i])
+			{
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Start collecting keys of a new batch, the previous batch result is
+ * discarded.
+ */
+void
+ExecRemoteScanBatchBegin(RemoteScanState *node)
+{
+	HASHCTL ctl;
+
+	node->batch_active = false;
+	node->batch_cursor = NULL;
+	if (node->batch_cxt == NULL)
+		node->batch_cxt = AllocSetContextCreate(node->ss.ps.state->es_query_cxt,
+							"RemoteScan batch",
+							ALLOCSET_DEFAULT_SIZES);
+	else
+		MemoryContextReset(node->batch_cxt);
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = sizeof(Datum) * node->nbatch_keys;
+	ctl.entrysize = sizeof(RemoteBatchEntry);
+	ctl.hcxt = node->batch_cxt;
+	node->batch_hash = hash_create("RemoteScan batch keys",
+				       remote_scan_batch_size, &ctl,
+				       HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+}
+
+/*
+ * Add current values of the key params to the batch.
+ */
+void
+ExecRemoteScanBatchAddKey(RemoteScanState *node)
+{
+	Datum keys[REMOTE_BATCH_MAX_KEYS];
+	RemoteBatchEntry *entry;
+	bool found;
+
+	if (!get_batch_keys(node, keys))
+		return;
+	entry = hash_search(node->batch_hash, keys, HASH_ENTER, &found);
+	if (!found)
+		entry->tuples = NIL;
 }
 
-static void generate_remote_sql(RemoteScanState *rss)
+/*
+ * Fetch all rows matching the keys of the batch in one remote query, and
+ * store them by their keys. Subsequent rescans return the matches of
+ * current param values from the batch result without remote access, until
+ * next ExecRemoteScanBatchBegin() call.
+ */
+void
+ExecRemoteScanBatchFetch(RemoteScanState *node)
+{
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+
+	if (stmt_handle_valid(node->handle))
+	{
+		cancel_stmt_async(node->handle);
+		release_stmt_handle(node->handle);
+		node->handle = INVALID_STMT_HANLE;
+	}
+
+	node->nbatches++;
+	if (hash_get_num_entries(node->batch_hash) == 0)
+		goto end;
+
+	initStringInfo2(&node->remote_sql, 512, node->ss.ps.state->es_query_cxt);
+	generate_remote_sql(node, true);
+
+	size_t stmtlen = lengthStringInfo(&node->remote_sql);
+	char *stmt = MemoryContextStrdup(TopTransactionContext, node->remote_sql.data);
+	if (mysql_binary_protocol)
+		node->handle = send_stmt_async_binary(node->asi, stmt, stmtlen,
+						      true, false);
+	else
+		node->handle = send_stmt_async(node->asi, stmt, stmtlen, CMD_SELECT,
+					       true, SQLCOM_SELECT, false);
+
+	for (;;)
+	{
+		Datum keys[REMOTE_BATCH_MAX_KEYS];
+		RemoteBatchEntry *entry;
+		bool isnull = false;
+
+		CHECK_FOR_INTERRUPTS();
+		ResetExprContext(econtext);
+		if (TupIsNull(RemoteNext(node)))
+			break;
+
+		memset(keys, 0, sizeof(keys));
+		for (int i = 0; i < node->nbatch_keys && !isnull; i++)
+			keys[i] = slot_getattr(slot, node->batch_key_attnos[i], &isnull);
+		if (isnull)
+			continue;
+
+		entry = hash_search(node->batch_hash, keys, HASH_FIND, NULL);
+		if (!entry)
+			continue;
+
+		MemoryContext saved = MemoryContextSwitchTo(node->batch_cxt);
+		entry->tuples = lappend(entry->tuples, ExecCopySlotMinimalTuple(slot));
+		MemoryContextSwitchTo(saved);
+	}
+
+	release_stmt_handle(node->handle);
+	node->handle = INVALID_STMT_HANLE;
+	ExecClearTuple(slot);
+end:
+	node->batch_active = true;
+}
+
+/*
+ * Generate the remote query into rss->remote_sql. If 'batch' is set, the key
+ * quals are replaced by an IN list of all keys in rss->batch_hash.
+ */
+static void generate_remote_sql(RemoteScanState *rss, bool batch)
 {
 	StringInfo str = &rss->remote_sql;
 	PlannedStmt *pstmt = ((PlanState *)rss)->state->es_plannedstmt;
@@ -831,10 +1598,22 @@ static void generate_remote_sql(RemoteScanState *rss)
 	
 	RemotePrintExprContext rpec;
 	InitRemotePrintExprContext(&rpec, rss->ss.ps.state->es_plannedstmt->rtable);
-	rpec.exec_param_quals = rss->param_driven;
+	/* Same as InitScanTupleGenContext(), which decided the quals to push down */
+	rpec.exec_param_quals = !rss->param_driven;
 	rpec.estate = ((PlanState *)rss)->state;
 	rpec.rpec_param_exec_vals = rss->ss.ps.ps_ExprContext->ecxt_param_exec_vals;
 
+	/*
+	 * A param driven scan sends the same stmt with different param values on
+	 * each rescan, print it as a template to be prepared once and cached.
+	 */
+	rpec.print_placeholders = !batch && rss->param_driven &&
+		mysql_prepared_stmt_cache_size > 0;
+	rpec.qualify_columns = (rs->joinrelid != 0);
+	list_free_deep(rss->remote_params);
+	rss->remote_params = NIL;
+	MemoryContext saved_cxt = MemoryContextSwitchTo(rss->ss.ps.state->es_query_cxt);
+
 	/*
 	 * SELECT target index.
 	 * */
@@ -865,11 +1644,46 @@ static void generate_remote_sql(RemoteScanState *rss)
 		make_qualified_name(rel->rd_rel->relnamespace,
 			rel->rd_rel->relname.data, NULL);
 
-	appendStringInfo(str, " from %s ", table_qname);
+	if (rs->joinrelid == 0)
+		appendStringInfo(str, " from %s ", table_qname);
+	else
+	{
+		/*
+		  Tables are aliased as 't<rtindex>', which is how columns are
+		  qualified with rpec.qualify_columns.
+		*/
+		RangeTblEntry *jrte = rt_fetch(rs->joinrelid, pstmt->rtable);
+		const char *join_qname =
+			make_qualified_name(get_rel_namespace(jrte->relid),
+				get_rel_name(jrte->relid), NULL);
+
+		appendStringInfo(str, " from %s t%u %s join %s t%u",
+			table_qname, rs->scanrelid,
+			rs->jointype == JOIN_LEFT ? "left" : "inner",
+			join_qname, rs->joinrelid);
+		if (rs->jointype == JOIN_LEFT)
+		{
+			appendStringInfoString(str, " on ");
+			if (rs->joinquals == NIL)
+				appendStringInfoString(str, "true");
+			foreach(lc, rs->joinquals)
+			{
+				if (lc != list_head(rs->joinquals))
+					appendStringInfoString(str, " AND ");
+				snprint_expr(str, (Expr*)lfirst(lc), &rpec);
+			}
+		}
+		appendStringInfoChar(str, ' ');
+	}
 	
 	ntgts = 0;
 	foreach(lc, rss->quals_pushdown)
 	{
+		if (batch && list_member_ptr(rss->batch_key_quals, lfirst(lc)))
+			continue;
+		/* Evaluated locally in fetch all mode of an adaptive scan */
+		if (!rss->param_driven && list_member_ptr(rss->param_quals, lfirst(lc)))
+			continue;
 		if (ntgts > 0)
 			appendStringInfoString(str, " AND ");
 		else
@@ -878,8 +1692,97 @@ static void generate_remote_sql(RemoteScanState *rss)
 		++ ntgts;
 	}
 
+	if (batch)
+	{
+		HASH_SEQ_STATUS hseq;
+		RemoteBatchEntry *entry;
+		Var *var;
+		Param *param;
+		int nkeys = rss->nbatch_keys;
+		int nvals = 0;
+
+		appendStringInfoString(str, ntgts > 0 ? " AND " : " where ");
+		if (nkeys > 1)
+			appendStringInfoChar(str, '(');
+		foreach(lc, rss->batch_key_quals)
+		{
+			if (lc != list_head(rss->batch_key_quals))
+				appendStringInfoString(str, ", ");
+			is_batch_key_qual((Expr *)lfirst(lc), &var, &param);
+			snprint_expr(str, (Expr *)var, &rpec);
+		}
+		appendStringInfoString(str, nkeys > 1 ? ") IN (" : " IN (");
+
+		hash_seq_init(&hseq, rss->batch_hash);
+		while ((entry = (RemoteBatchEntry *)hash_seq_search(&hseq)) != NULL)
+		{
+			if (nvals++ > 0)
+				appendStringInfoString(str, ", ");
+			if (nkeys > 1)
+				appendStringInfoChar(str, '(');
+			for (int i = 0; i < nkeys; i++)
+			{
+				if (i > 0)
+					appendStringInfoString(str, ", ");
+				if (output_const_type_value(str, false, rss->batch_key_types[i],
+							    entry->keys[i]) < 0)
+					ereport(ERROR,
+							(errcode(ERRCODE_INTERNAL_ERROR),
+							 errmsg("Kunlun-db: Failed to print key value of type %u for remote query.",
+							 		rss->batch_key_types[i])));
+			}
+			if (nkeys > 1)
+				appendStringInfoChar(str, ')');
+		}
+		appendStringInfoChar(str, ')');
+	}
+
+	if (rs->groupexprs != NIL)
+	{
+		foreach(lc, rs->groupexprs)
+		{
+			appendStringInfoString(str, lc == list_head(rs->groupexprs) ?
+								   " group by " : ", ");
+			snprint_expr(str, (Expr *)lfirst(lc), &rpec);
+		}
+	}
+
+	/* Order demanded by the plan, see create_remotescan_plan(). */
+	if (rs->sortexprs != NIL)
+	{
+		int i = 0;
+
+		foreach(lc, rs->sortexprs)
+		{
+			Expr *expr = (Expr *)lfirst(lc);
+			bool desc = rs->sortdesc[i];
+			bool nulls_first = rs->nullsFirst[i];
+
+			appendStringInfoString(str, i == 0 ? " order by " : ", ");
+
+			/*
+			  MySQL sorts NULLs before all other values, i.e. NULLS FIRST in
+			  ascending order and NULLS LAST in descending order. Otherwise
+			  sort by 'col IS NULL' first, unless the column is NOT NULL.
+			*/
+			if (nulls_first == desc &&
+				!(IsA(expr, Var) &&
+				  TupleDescAttr(rel->rd_att, ((Var *)expr)->varattno - 1)->attnotnull))
+			{
+				snprint_expr(str, expr, &rpec);
+				appendStringInfoString(str, nulls_first ? " IS NULL DESC, " : " IS NULL, ");
+			}
+			snprint_expr(str, expr, &rpec);
+			if (desc)
+				appendStringInfoString(str, " DESC");
+			i++;
+		}
+	}
+
 	if (rss->check_exists)
 		appendStringInfoString(str, " limit 1");
+	else if (!batch && rss->tuples_needed >= 0)
+		appendStringInfo(str, " limit " INT64_FORMAT, rss->tuples_needed);
 
 	/* print locks */
 	foreach(lc, pstmt->rowMarks)
@@ -914,6 +1817,10 @@ static void generate_remote_sql(RemoteScanState *rss)
 			break;
 		}
 	}
+
+	rss->use_prepared = rpec.print_placeholders;
+	rss->remote_params = rpec.param_values;
+	MemoryContextSwitchTo(saved_cxt);
 }
 
 void ExecStoreRemoteTuple(TypeInputInfo *tii, MYSQL_ROW row,
@@ -945,3 +1852,38 @@ void ExecStoreRemoteTuple(TypeInputInfo *tii, MYSQL_ROW row,
 	}
 	ExecStoreVirtualTuple(slot);
 }
+
+/*
+ * Same as ExecStoreRemoteTuple() but for rows returned through the binary
+ * protocol, field i of 'row' is a value of 'bindtypes[i]'.
+ */
+void ExecStoreRemoteBinaryTuple(TypeInputInfo *tii, MYSQL_ROW row,
+			  unsigned long *lengths, enum enum_field_types *types,
+			  enum enum_field_types *bindtypes, TupleTableSlot *slot)
+{
+	ExecClearTuple(slot);
+	int         natts = slot->tts_tupleDescriptor->natts;
+
+	Assert(tii != NULL);
+
+	for (int i = 0; i < natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(slot->tts_tupleDescriptor, i);
+
+		if (!att->attisdropped && row[i] != NULL)
+		{
+			bool isnull;
+			TypeInputInfo *ptii = tii + i;
+
+			slot->tts_values[i] = myBinaryInputFuncCall(ptii, row[i], lengths[i],
+								    types[i], bindtypes[i], &isnull);
+			slot->tts_isnull[i] = isnull;
+		}
+		else
+		{
+			slot->tts_values[i] = (Datum) 0;
+			slot->tts_isnull[i] = true;
+		}
+	}
+	ExecStoreVirtualTuple(slot);
+}
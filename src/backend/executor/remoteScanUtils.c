@@ -151,7 +151,8 @@ bool alloc_scanvar_for_expr(ScanTupleGenContext *context, Expr *expr)
 	if (!pushable || context->rpec.num_vals > 1)
 		context->unpushable_exprs = lappend(context->unpushable_exprs, expr);
 
-	if (vpc->nvars == 0)
+	/* An aggregate like count(*) is computed remotely without any column */
+	if (vpc->nvars == 0 && !IsA(expr, Aggref))
 		return split;
 
 	/* 
@@ -451,6 +451,14 @@ _copyRemoteScan(const RemoteScan *from)
 	COPY_SCALAR_FIELD(scanrelid);
 	COPY_SCALAR_FIELD(check_exists);
 	COPY_SCALAR_FIELD(materialized);
+	COPY_NODE_FIELD(sortexprs);
+	COPY_POINTER_FIELD(sortdesc, list_length(from->sortexprs) * sizeof(bool));
+	COPY_POINTER_FIELD(nullsFirst, list_length(from->sortexprs) * sizeof(bool));
+	COPY_SCALAR_FIELD(remote_agg);
+	COPY_NODE_FIELD(groupexprs);
+	COPY_SCALAR_FIELD(joinrelid);
+	COPY_SCALAR_FIELD(jointype);
+	COPY_NODE_FIELD(joinquals);
 
 	return newnode;
 }
@@ -545,6 +545,8 @@ _outScan(StringInfo str, const Scan *node)
 static void
 _outRemoteScan(StringInfo str, const RemoteScan *node)
 {
+	int			i;
+
 	WRITE_NODE_TYPE("REMOTESCAN");
 
 	_outPlanInfo(str, (const Plan *) node);
@@ -552,6 +554,21 @@ _outRemoteScan(StringInfo str, const RemoteScan *node)
 	WRITE_BOOL_FIELD(check_exists);
 	WRITE_BOOL_FIELD(materialized);
 	WRITE_INT_FIELD(query_level);
+	WRITE_NODE_FIELD(sortexprs);
+
+	appendStringInfoString(str, " :sortdesc");
+	for (i = 0; i < list_length(node->sortexprs); i++)
+		appendStringInfo(str, " %s", booltostr(node->sortdesc[i]));
+
+	appendStringInfoString(str, " :nullsFirst");
+	for (i = 0; i < list_length(node->sortexprs); i++)
+		appendStringInfo(str, " %s", booltostr(node->nullsFirst[i]));
+
+	WRITE_BOOL_FIELD(remote_agg);
+	WRITE_NODE_FIELD(groupexprs);
+	WRITE_UINT_FIELD(joinrelid);
+	WRITE_ENUM_FIELD(jointype, JoinType);
+	WRITE_NODE_FIELD(joinquals);
 }
 
 static void
@@ -2087,6 +2104,31 @@ _outAggPath(StringInfo str, const AggPath *node)
 	WRITE_NODE_FIELD(qual);
 }
 
+static void
+_outRemoteAggPath(StringInfo str, const RemoteAggPath *node)
+{
+	WRITE_NODE_TYPE("REMOTEAGGPATH");
+
+	_outPathInfo(str, (const Path *) node);
+
+	WRITE_NODE_FIELD(subpath);
+	WRITE_NODE_FIELD(groupexprs);
+	WRITE_FLOAT_FIELD(numGroups, "%.0f");
+}
+
+static void
+_outRemoteJoinPath(StringInfo str, const RemoteJoinPath *node)
+{
+	WRITE_NODE_TYPE("REMOTEJOINPATH");
+
+	_outPathInfo(str, (const Path *) node);
+
+	WRITE_NODE_FIELD(outerpath);
+	WRITE_NODE_FIELD(innerpath);
+	WRITE_ENUM_FIELD(jointype, JoinType);
+	WRITE_NODE_FIELD(joinrestrictinfo);
+}
+
 static void
 _outRollupData(StringInfo str, const RollupData *node)
 {
@@ -4113,6 +4155,12 @@ outNode(StringInfo str, const void *obj)
 			case T_AggPath:
 				_outAggPath(str, obj);
 				break;
+			case T_RemoteAggPath:
+				_outRemoteAggPath(str, obj);
+				break;
+			case T_RemoteJoinPath:
+				_outRemoteJoinPath(str, obj);
+				break;
 			case T_GroupingSetsPath:
 				_outGroupingSetsPath(str, obj);
 				break;
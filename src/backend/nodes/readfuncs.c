@@ -1973,6 +1973,32 @@ _readForeignScan(void)
 	READ_DONE();
 }
 
+/*
+ * _readRemoteScan
+ */
+static RemoteScan *
+_readRemoteScan(void)
+{
+	READ_LOCALS(RemoteScan);
+
+	ReadCommonPlan(&local_node->plan);
+
+	READ_OID_FIELD(scanrelid);
+	READ_BOOL_FIELD(check_exists);
+	READ_BOOL_FIELD(materialized);
+	READ_INT_FIELD(query_level);
+	READ_NODE_FIELD(sortexprs);
+	READ_BOOL_ARRAY(sortdesc, list_length(local_node->sortexprs));
+	READ_BOOL_ARRAY(nullsFirst, list_length(local_node->sortexprs));
+	READ_BOOL_FIELD(remote_agg);
+	READ_NODE_FIELD(groupexprs);
+	READ_UINT_FIELD(joinrelid);
+	READ_ENUM_FIELD(jointype, JoinType);
+	READ_NODE_FIELD(joinquals);
+
+	READ_DONE();
+}
+
 /*
  * _readCustomScan
  */
@@ -2735,6 +2761,8 @@ parseNodeString(void)
 		return_value = _readForeignScan();
 	else if (MATCH("CUSTOMSCAN", 10))
 		return_value = _readCustomScan();
+	else if (MATCH("REMOTESCAN", 10))
+		return_value = _readRemoteScan();
 	else if (MATCH("JOIN", 4))
 		return_value = _readJoin();
 	else if (MATCH("NESTLOOP", 8))
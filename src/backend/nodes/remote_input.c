@@ -14,8 +14,11 @@
 #include "catalog/pg_type_map.h"
 #include "nodes/execnodes.h"
 #include "nodes/remote_input.h"
+#include "utils/date.h"
+#include "utils/datetime.h"
 #include "utils/syscache.h"
 #include "utils/lsyscache.h"
+#include "utils/timestamp.h"
 
 void myInputInfo(Oid typid, int typmod, TypeInputInfo *info)
 {
@@ -24,6 +27,7 @@ void myInputInfo(Oid typid, int typmod, TypeInputInfo *info)
 
         if (HeapTupleIsValid(tup))
         {
+                info->typid = typid;
                 info->typioparam = getTypeIOParam(tup);
                 info->typmod = typmod;
 
@@ -109,4 +113,127 @@ Datum myInputFuncCall(TypeInputInfo *info, char *str, int len, enum enum_field_t
 	}
 
 	return result;
-}
\ No newline at end of file
+}
+
+/*
+ * Convert a field value returned through the mysql binary protocol. 'buf'
+ * holds a value of 'bindtype' as bound by the storage connection, see
+ * binary_bind_type() in sharding_conn.c. Values that map directly to the
+ * target pg type are converted into Datums without any text parsing, all
+ * others go through the type's input function as text protocol values do.
+ */
+Datum myBinaryInputFuncCall(TypeInputInfo *info, char *buf, int len,
+	enum enum_field_types mytype, enum enum_field_types bindtype, bool *isnull)
+{
+	char textbuf[MAXDATELEN + 1];
+
+	*isnull = false;
+	if (buf == NULL)
+	{
+		*isnull = true;
+		return (Datum) 0;
+	}
+
+	if (info->typisenum)
+		return myInputFuncCall(info, buf, len, mytype, isnull);
+
+	switch (bindtype)
+	{
+	case MYSQL_TYPE_LONGLONG:
+	{
+		int64 val;
+
+		/* values restored from matcache may be unaligned */
+		memcpy(&val, buf, sizeof(val));
+		switch (info->typid)
+		{
+		case INT8OID:
+			return Int64GetDatum(val);
+		case INT4OID:
+			if (val >= PG_INT32_MIN && val <= PG_INT32_MAX)
+				return Int32GetDatum((int32) val);
+			break;
+		case INT2OID:
+			if (val >= PG_INT16_MIN && val <= PG_INT16_MAX)
+				return Int16GetDatum((int16) val);
+			break;
+		case BOOLOID:
+			return BoolGetDatum(val != 0);
+		default:
+			break;
+		}
+		/* Let the input function do range checks and other conversions */
+		len = snprintf(textbuf, sizeof(textbuf), INT64_FORMAT, val);
+		break;
+	}
+	case MYSQL_TYPE_DOUBLE:
+	{
+		double val;
+
+		memcpy(&val, buf, sizeof(val));
+		if (info->typid == FLOAT8OID)
+			return Float8GetDatum(val);
+		else if (info->typid == FLOAT4OID && !isinf(val) &&
+				 (isinf((float4) val) == 0))
+			return Float4GetDatum((float4) val);
+		len = snprintf(textbuf, sizeof(textbuf), "%.17g", val);
+		break;
+	}
+	case MYSQL_TYPE_DATE:
+	case MYSQL_TYPE_DATETIME:
+	case MYSQL_TYPE_TIME:
+	{
+		MYSQL_TIME val;
+		struct pg_tm tm;
+
+		memcpy(&val, buf, sizeof(val));
+		memset(&tm, 0, sizeof(tm));
+		tm.tm_year = val.year;
+		tm.tm_mon = val.month;
+		tm.tm_mday = val.day;
+		tm.tm_hour = val.hour;
+		tm.tm_min = val.minute;
+		tm.tm_sec = val.second;
+
+		/*
+		  Zero dates, negative times and typmods needing rounding are left to
+		  the input functions.
+		*/
+		if (val.time_type == MYSQL_TIMESTAMP_DATE && info->typid == DATEOID &&
+			val.month > 0 && val.day > 0 && IS_VALID_JULIAN(val.year, val.month, val.day))
+			return DateADTGetDatum(date2j(val.year, val.month, val.day) - POSTGRES_EPOCH_JDATE);
+		else if (val.time_type == MYSQL_TIMESTAMP_DATETIME && val.month > 0 && val.day > 0 &&
+				 (info->typid == TIMESTAMPOID || info->typid == TIMESTAMPTZOID) &&
+				 (info->typmod < 0 || info->typmod >= 6))
+		{
+			Timestamp ts;
+
+			/* timestamptz values are stored in UTC+0, see my_timestamptz_in() */
+			if (tm2timestamp(&tm, val.second_part, NULL, &ts) == 0)
+				return TimestampGetDatum(ts);
+		}
+		else if (val.time_type == MYSQL_TIMESTAMP_TIME && info->typid == TIMEOID &&
+				 !val.neg && val.hour < HOURS_PER_DAY &&
+				 (info->typmod < 0 || info->typmod >= 6))
+			return TimeADTGetDatum(((((val.hour * MINS_PER_HOUR) + val.minute) * SECS_PER_MINUTE) +
+									val.second) * USECS_PER_SEC + val.second_part);
+
+		if (val.time_type == MYSQL_TIMESTAMP_DATE)
+			len = snprintf(textbuf, sizeof(textbuf), "%04u-%02u-%02u",
+						   val.year, val.month, val.day);
+		else if (val.time_type == MYSQL_TIMESTAMP_TIME)
+			len = snprintf(textbuf, sizeof(textbuf), "%s%02u:%02u:%02u.%06lu",
+						   val.neg ? "-" : "", val.hour, val.minute, val.second,
+						   val.second_part);
+		else
+			len = snprintf(textbuf, sizeof(textbuf), "%04u-%02u-%02u %02u:%02u:%02u.%06lu",
+						   val.year, val.month, val.day, val.hour, val.minute,
+						   val.second, val.second_part);
+		break;
+	}
+	default:
+		return myInputFuncCall(info, buf, len, mytype, isnull);
+	}
+
+	return myInputFuncCall(info, textbuf, len, mytype, isnull);
+}
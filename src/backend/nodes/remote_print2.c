@@ -12,6 +12,8 @@
 #include "access/remotetup.h"
 #include "access/sysattr.h"
 #include "catalog/heap.h"
+#include "catalog/pg_aggregate.h"
+#include "catalog/pg_namespace.h"
 #include "catalog/pg_type.h"
 #include "catalog/pg_type_map.h"
 #include "catalog/pg_operator.h"
@@ -28,6 +30,8 @@
 #include "parser/parsetree.h"
 #include "pgtime.h"
 #include "utils/builtins.h"
+#include "utils/date.h"
+#include "utils/timestamp.h"
 #include "utils/catcache.h"
 #include "utils/lsyscache.h"
 #include "utils/syscache.h"
@@ -573,7 +577,10 @@ snprint_var(StringInfo str, RemotePrintExprContext *rpec, Var* var)
 		if (varname)
 		{
 			done = true;
-			APPEND_STR(varname);
+			if (rpec->qualify_columns && !IS_SPECIAL_VARNO(var->varno))
+				APPEND_STR_FMT2("t%d.%s", (int)var->varno, varname);
+			else
+				APPEND_STR(varname);
 		}
 	}
 
@@ -713,6 +720,21 @@ snprint_param_expr(StringInfo str, RemotePrintExprContext *rpec, Param *param)
 		isnull = exec_data->isnull;
 		paramtype = param->paramtype;
 		pval = exec_data->value;
+
+		if (rpec->print_placeholders &&
+		    remote_param_bindable(paramtype, isnull, pval))
+		{
+			if (!rpec->noprint)
+			{
+				RemoteParamValue *rpv = palloc(sizeof(RemoteParamValue));
+				rpv->type = paramtype;
+				rpv->isnull = isnull;
+				rpv->value = pval;
+				rpec->param_values = lappend(rpec->param_values, rpv);
+			}
+			APPEND_STR("?");
+			return nw;
+		}
 	}
 	else if (param->paramkind == PARAM_EXTERN)
 	{
@@ -909,10 +931,36 @@ snprint_list_expr(StringInfo str, RemotePrintExprContext *rpec, List *list)
 	return nw;
 }
 
+/*
+  Print a partial aggregate that the storage node computes for us, see
+  remote_partial_agg_supported(). The MySQL aggregate returns exactly the
+  transition state of the PG aggregate, so the compute node only needs to
+  combine and finalize the states of all shards. avg() is not printed, its
+  {count, sum} state is built by the RemoteScan node from count() and sum().
+*/
 static int
 snprint_agg_expr(StringInfo str, RemotePrintExprContext *rpec, Aggref *aggref)
 {
-	return -1;	
+	int nw = 0, nw1;
+	char *fname;
+
+	if (aggref->aggsplit != AGGSPLIT_INITIAL_SERIAL ||
+		!remote_partial_agg_supported(aggref))
+		return -1;
+
+	fname = get_func_name(aggref->aggfnoid);
+	if (strcmp(fname, "avg") == 0)
+		return -1;
+
+	APPEND_STR(fname);
+	APPEND_CHAR('(');
+	if (aggref->aggstar)
+		APPEND_CHAR('*');
+	else
+		APPEND_EXPR(((TargetEntry *)linitial(aggref->args))->expr);
+	APPEND_CHAR(')');
+
+	return nw;
 }
 
 static int
@@ -1279,6 +1327,95 @@ output_const_type_value(StringInfo str, bool isnull, Oid type, Datum value)
 	return snprint_const_type_value(str, isnull, type, value, &rpec);
 }
 
+/*
+  Whether MySQL compares values of 'typid' exactly as the default btree
+  opclass of the type does, so that rows sorted, grouped or min/max'ed by the
+  storage node agree with the compute node. Text types are excluded because
+  MySQL compares them by the column's collation.
+*/
+bool remote_type_compares_same(Oid typid)
+{
+	switch (typid)
+	{
+	case BOOLOID:
+	case INT2OID:
+	case INT4OID:
+	case INT8OID:
+	case FLOAT4OID:
+	case FLOAT8OID:
+	case NUMERICOID:
+	case DATEOID:
+	case TIMEOID:
+	case TIMESTAMPOID:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+  Whether the storage node can compute the partial aggregation of 'aggref',
+  i.e. whether a MySQL aggregate returns the transition state that the
+  combining aggregate on the compute node expects. sum() of int8 and numeric
+  and avg() of types other than int2/int4 have internal states and are not
+  supported.
+*/
+bool remote_partial_agg_supported(Aggref *aggref)
+{
+	Oid argtype;
+	char *fname;
+
+	if (aggref->aggdistinct || aggref->aggorder || aggref->aggfilter ||
+		aggref->aggvariadic || aggref->aggkind != AGGKIND_NORMAL ||
+		list_length(aggref->args) > 1 ||
+		get_func_namespace(aggref->aggfnoid) != PG_CATALOG_NAMESPACE)
+		return false;
+
+	fname = get_func_name(aggref->aggfnoid);
+	if (strcmp(fname, "count") == 0)
+		return true;
+	if (aggref->aggstar || aggref->args == NIL)
+		return false;
+
+	argtype = linitial_oid(aggref->aggargtypes);
+	if (strcmp(fname, "sum") == 0)
+		return argtype == INT2OID || argtype == INT4OID ||
+			argtype == FLOAT4OID || argtype == FLOAT8OID;
+	if (strcmp(fname, "avg") == 0)
+		return argtype == INT2OID || argtype == INT4OID;
+	if (strcmp(fname, "min") == 0 || strcmp(fname, "max") == 0)
+		return remote_type_compares_same(argtype);
+
+	return false;
+}
+
+/*
+  Whether a param value can be bound to a '?' placeholder of a prepared stmt
+  in its native form, see bind_stmt_params() in sharding_conn.c. Values of
+  other types are printed as literals.
+*/
+bool remote_param_bindable(Oid type, bool isnull, Datum value)
+{
+	switch (type)
+	{
+	case INT2OID:
+	case INT4OID:
+	case INT8OID:
+	case FLOAT8OID:
+	case TEXTOID:
+	case VARCHAROID:
+	case BPCHAROID:
+		return true;
+	case DATEOID:
+		return isnull || !DATE_NOT_FINITE(DatumGetDateADT(value));
+	case TIMESTAMPOID:
+	case TIMESTAMPTZOID:
+		return isnull || !TIMESTAMP_NOT_FINITE(DatumGetTimestamp(value));
+	default:
+		return false;
+	}
+}
+
 Oid my_output_funcoid(Oid typid, bool *typIsVarlena)
 {
 	HeapTuple tup1, tup2;
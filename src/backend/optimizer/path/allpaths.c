@@ -22,6 +22,7 @@
 #include "access/tsmapi.h"
 #include "access/remote_dml.h"
 #include "access/remote_meta.h"
+#include "access/xact.h"
 #include "catalog/pg_class.h"
 #include "catalog/pg_operator.h"
 #include "catalog/pg_proc.h"
@@ -81,6 +82,9 @@ static void set_rel_pathlist(PlannerInfo *root, RelOptInfo *rel,
 static void set_plain_rel_size(PlannerInfo *root, RelOptInfo *rel,
 				   RangeTblEntry *rte);
 static void create_plain_partial_paths(PlannerInfo *root, RelOptInfo *rel);
+static List *get_remote_sort_pathkeys(PlannerInfo *root, RelOptInfo *rel);
+static void add_remote_index_order_path(PlannerInfo *root, RelOptInfo *rel,
+							IndexOptInfo *index, ScanDirection scandir);
 static void set_rel_consider_parallel(PlannerInfo *root, RelOptInfo *rel,
 						  RangeTblEntry *rte);
 static void set_plain_rel_pathlist(PlannerInfo *root, RelOptInfo *rel,
@@ -604,6 +608,20 @@ set_rel_consider_parallel(PlannerInfo *root, RelOptInfo *rel,
 					return;
 			}
 
+			/*
+			 * A worker reads a remote table through its own connections to
+			 * the storage shards, outside of the leader's XA transaction, so
+			 * it can't see what that transaction wrote nor lock rows for it.
+			 * Only read-only queries out of transaction blocks may do so. The
+			 * plan may still be run in a transaction block, where
+			 * ExecParallelRemoteScanAllowed() keeps the workers from starting.
+			 */
+			if (IS_REMOTE_RELOPT(root, rel) &&
+				(!enable_parallel_remotescan ||
+				 root->parse->rowMarks != NIL ||
+				 IsTransactionBlock()))
+				return;
+
 			/*
 			 * There are additional considerations for appendrels, which we'll
 			 * deal with in set_append_rel_size and set_append_rel_pathlist.
@@ -730,10 +748,37 @@ set_plain_rel_pathlist(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
 	 * */
 	if (IS_REMOTE_RELOPT(root, rel))
 	{
-		add_path(rel, create_remotescan_path(root, rel, required_outer, 0));
+		List	   *sort_pathkeys;
+		ListCell   *lc;
+
+		add_path(rel, create_remotescan_path(root, rel, required_outer, 0, NIL));
+
 		/*
-		 * TODO: Add more paths.
+		 * Also consider having the storage node return rows in the order the
+		 * query wants, so that the rows of a single table or a MergeAppend
+		 * over the partitions need no local sort.
 		 * */
+		if (required_outer == NULL &&
+			(sort_pathkeys = get_remote_sort_pathkeys(root, rel)) != NIL)
+			add_path(rel, create_remotescan_path(root, rel, NULL, 0,
+												 sort_pathkeys));
+
+		/*
+		 * And the orders of its indexes which are useful for merge joins or
+		 * the query, the storage node returns them without sorting.
+		 */
+		foreach(lc, rel->indexlist)
+		{
+			IndexOptInfo *index = (IndexOptInfo *) lfirst(lc);
+
+			if (required_outer != NULL)
+				break;
+
+			add_remote_index_order_path(root, rel, index,
+										ForwardScanDirection);
+			add_remote_index_order_path(root, rel, index,
+										BackwardScanDirection);
+		}
 		return;
 	}
 
@@ -751,6 +796,54 @@ set_plain_rel_pathlist(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte)
 	create_tidscan_paths(root, rel);
 }
 
+/*
+ * get_remote_sort_pathkeys
+ *	  Return the query's pathkeys if the storage node of remote relation
+ *	  'rel' can sort by all of them, NIL otherwise.
+ */
+static List *
+get_remote_sort_pathkeys(PlannerInfo *root, RelOptInfo *rel)
+{
+	ListCell   *lc;
+
+	foreach(lc, root->query_pathkeys)
+	{
+		if (!find_remote_sort_expr((PathKey *) lfirst(lc), rel))
+			return NIL;
+	}
+	return root->query_pathkeys;
+}
+
+/*
+ * add_remote_index_order_path
+ *	  Add a remote scan path of 'rel' returning rows in the order of its
+ *	  index 'index' scanned in direction 'scandir', if the order is useful
+ *	  and the storage node can provide it.
+ */
+static void
+add_remote_index_order_path(PlannerInfo *root, RelOptInfo *rel,
+							IndexOptInfo *index, ScanDirection scandir)
+{
+	List	   *pathkeys;
+	ListCell   *lc;
+
+	pathkeys = build_index_pathkeys(root, index, scandir);
+	pathkeys = truncate_useless_pathkeys(root, rel, pathkeys);
+	if (pathkeys == NIL)
+		return;
+
+	foreach(lc, pathkeys)
+	{
+		if (!find_remote_sort_expr((PathKey *) lfirst(lc), rel))
+			return;
+	}
+
+	if (!remote_index_provides_order(root, rel, pathkeys))
+		return;
+
+	add_path(rel, create_remotescan_path(root, rel, NULL, 0, pathkeys));
+}
+
 /*
  * create_plain_partial_paths
  *	  Build partial access paths for parallel scan of a plain relation
@@ -946,12 +1039,16 @@ set_append_rel_size(PlannerInfo *root, RelOptInfo *rel,
 	/*
 	 * If this is a partitioned baserel, set the consider_partitionwise_join
 	 * flag; currently, we only consider partitionwise joins with the baserel
-	 * if its targetlist doesn't contain a whole-row Var.
+	 * if its targetlist doesn't contain a whole-row Var. Matching partitions
+	 * of remote tables may be joined by their storage shard, see
+	 * try_remote_join_path(), so enable_remote_join_pushdown applies to
+	 * remote partitioned tables only.
 	 */
-	if (enable_partitionwise_join &&
-		rel->reloptkind == RELOPT_BASEREL &&
+	if (rel->reloptkind == RELOPT_BASEREL &&
 		rte->relkind == RELKIND_PARTITIONED_TABLE &&
-		rel->attr_needed[InvalidAttrNumber - rel->min_attr] == NULL)
+		rel->attr_needed[InvalidAttrNumber - rel->min_attr] == NULL &&
+		(enable_partitionwise_join ||
+		 (enable_remote_join_pushdown && IS_REMOTE_PARENT_RTE(rte))))
 		rel->consider_partitionwise_join = true;
 
 	/*
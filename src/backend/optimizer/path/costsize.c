@@ -83,6 +83,7 @@
 #include "executor/nodeHash.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
+#include "nodes/print.h"
 #include "optimizer/clauses.h"
 #include "optimizer/cost.h"
 #include "optimizer/pathnode.h"
@@ -115,6 +116,10 @@ double		cpu_index_tuple_cost = DEFAULT_CPU_INDEX_TUPLE_COST;
 double		cpu_operator_cost = DEFAULT_CPU_OPERATOR_COST;
 double		parallel_tuple_cost = DEFAULT_PARALLEL_TUPLE_COST;
 double		parallel_setup_cost = DEFAULT_PARALLEL_SETUP_COST;
+double		remote_stmt_cost = DEFAULT_REMOTE_STMT_COST;
+double		remote_tuple_cost = DEFAULT_REMOTE_TUPLE_COST;
+double		remote_byte_cost = DEFAULT_REMOTE_BYTE_COST;
+double		remote_filter_cost_factor = DEFAULT_REMOTE_FILTER_COST_FACTOR;
 
 int			effective_cache_size = DEFAULT_EFFECTIVE_CACHE_SIZE;
 
@@ -136,6 +141,9 @@ bool		enable_hashjoin = true;
 bool		enable_gathermerge = true;
 bool		enable_partitionwise_join = false;
 bool		enable_partitionwise_aggregate = false;
+bool		enable_remote_agg_pushdown = true;
+bool		enable_remote_join_pushdown = true;
+bool		enable_parallel_remotescan = true;
 bool		enable_parallel_append = true;
 bool		enable_parallel_hash = true;
 bool		enable_partition_pruning = true;
@@ -278,6 +286,113 @@ cost_seqscan(Path *path, PlannerInfo *root,
 	path->total_cost = startup_cost + cpu_run_cost + disk_run_cost;
 }
 
+/*
+ * cost_remotescan
+ *	  Determines and returns the cost of scanning a remote relation, whose
+ *	  rows are fetched from its storage shard by one remote statement.
+ *
+ * The storage node scans the table and evaluates the quals that can be
+ * pushed down to it, at remote_filter_cost_factor of their local cost; only
+ * rows passing them are transferred, each at remote_tuple_cost plus
+ * remote_byte_cost per byte. The remaining quals are evaluated locally.
+ *
+ * 'baserel' is the relation to be scanned
+ * 'param_info' is the ParamPathInfo if this is a parameterized path, else NULL
+ */
+void
+cost_remotescan(Path *path, PlannerInfo *root,
+				RelOptInfo *baserel, ParamPathInfo *param_info)
+{
+	Cost		startup_cost = 0;
+	Cost		remote_run_cost;
+	Cost		local_run_cost;
+	QualCost	remote_qual_cost;
+	QualCost	local_qual_cost;
+	List	   *remote_quals = NIL;
+	List	   *local_quals = NIL;
+	Selectivity local_selec;
+	double		fetched_rows;
+	RemotePrintExprContext rpec;
+	StringInfoData buf;
+	ListCell   *lc;
+
+	/* Should only be applied to base relations */
+	Assert(baserel->relid > 0);
+	Assert(baserel->rtekind == RTE_RELATION);
+
+	/* Mark the path with the correct row estimate */
+	if (param_info)
+		path->rows = param_info->ppi_rows;
+	else
+		path->rows = baserel->rows;
+
+	/*
+	 * Split the quals into those the storage node evaluates and the rest.
+	 * Join clauses of a parameterized scan are sent along with their param
+	 * values, so they are always evaluated remotely.
+	 */
+	InitRemotePrintExprContext(&rpec, root->parse->rtable);
+	rpec.noprint = true;
+	initStringInfo(&buf);
+	foreach(lc, baserel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+		if (snprint_expr(&buf, rinfo->clause, &rpec) < 0)
+			local_quals = lappend(local_quals, rinfo);
+		else
+			remote_quals = lappend(remote_quals, rinfo);
+	}
+	pfree(buf.data);
+	if (param_info)
+		remote_quals = list_concat(remote_quals,
+								   list_copy(param_info->ppi_clauses));
+
+	cost_qual_eval(&remote_qual_cost, remote_quals, root);
+	cost_qual_eval(&local_qual_cost, local_quals, root);
+
+	/* Rows the storage node returns, before local quals filter them */
+	local_selec = clauselist_selectivity(root, local_quals, 0,
+										 JOIN_INNER, NULL);
+	fetched_rows = local_selec > 0 ?
+		clamp_row_est(path->rows / local_selec) : path->rows;
+
+	/*
+	 * Storage node costs. A parameterized scan is expected to be answered by
+	 * an index lookup on the join keys, but never costs more than a full scan.
+	 */
+	remote_run_cost = seq_page_cost * baserel->pages +
+		(cpu_tuple_cost + remote_qual_cost.per_tuple * remote_filter_cost_factor) *
+		baserel->tuples;
+	if (param_info)
+	{
+		double		pages_fetched;
+
+		pages_fetched = index_pages_fetched(fetched_rows, baserel->pages,
+											(double) baserel->pages, root);
+		remote_run_cost = Min(remote_run_cost,
+							  random_page_cost * pages_fetched +
+							  cpu_tuple_cost * fetched_rows);
+	}
+
+	/* One round trip per statement, then the rows are streamed back */
+	startup_cost += remote_stmt_cost +
+		remote_qual_cost.startup * remote_filter_cost_factor;
+	remote_run_cost += (remote_tuple_cost +
+						remote_byte_cost * path->pathtarget->width) *
+		fetched_rows;
+
+	/* Local CPU costs */
+	startup_cost += local_qual_cost.startup;
+	local_run_cost = (cpu_tuple_cost + local_qual_cost.per_tuple) * fetched_rows;
+	/* tlist eval costs are paid per output row, not per tuple scanned */
+	startup_cost += path->pathtarget->cost.startup;
+	local_run_cost += path->pathtarget->cost.per_tuple * path->rows;
+
+	path->startup_cost = startup_cost;
+	path->total_cost = startup_cost + remote_run_cost + local_run_cost;
+}
+
 /*
  * cost_samplescan
  *	  Determines and returns the cost of scanning a relation using sampling.
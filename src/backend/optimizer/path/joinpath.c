@@ -16,12 +16,15 @@
 
 #include <math.h>
 
+#include "catalog/pg_class.h"
 #include "executor/executor.h"
 #include "foreign/fdwapi.h"
+#include "nodes/print.h"
 #include "optimizer/cost.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
 #include "optimizer/planmain.h"
+#include "parser/parsetree.h"
 
 /* Hook for plugins to get control in add_paths_to_joinrel() */
 set_join_pathlist_hook_type set_join_pathlist_hook = NULL;
@@ -71,6 +74,9 @@ static void consider_parallel_mergejoin(PlannerInfo *root,
 static void hash_inner_and_outer(PlannerInfo *root, RelOptInfo *joinrel,
 					 RelOptInfo *outerrel, RelOptInfo *innerrel,
 					 JoinType jointype, JoinPathExtraData *extra);
+static void try_remote_join_path(PlannerInfo *root, RelOptInfo *joinrel,
+					 RelOptInfo *outerrel, RelOptInfo *innerrel,
+					 JoinType jointype, JoinPathExtraData *extra);
 static List *select_mergejoin_clauses(PlannerInfo *root,
 						 RelOptInfo *joinrel,
 						 RelOptInfo *outerrel,
@@ -307,6 +313,14 @@ add_paths_to_joinrel(PlannerInfo *root,
 		hash_inner_and_outer(root, joinrel, outerrel, innerrel,
 							 jointype, &extra);
 
+	/*
+	 * 4a. If inner and outer relations are remote tables stored in the same
+	 * storage shard, consider having the shard do the join.
+	 */
+	if (enable_remote_join_pushdown)
+		try_remote_join_path(root, joinrel, outerrel, innerrel,
+							 jointype, &extra);
+
 	/*
 	 * 5. If inner and outer relations are foreign tables (or joins) belonging
 	 * to the same server and assigned to the same user to check access
@@ -1906,6 +1920,84 @@ hash_inner_and_outer(PlannerInfo *root,
 	}
 }
 
+/*
+ * try_remote_join_path
+ *	  Consider a RemoteJoinPath which has the storage shard join outerrel
+ *	  and innerrel, if both are remote tables (or partitions) stored in the
+ *	  same shard.
+ *
+ * The shard must be able to evaluate everything: all restriction clauses
+ * of both relations and of the join must be printable as MySQL SQL, and the
+ * join's target must consist of plain columns.  Rows of SELECT ... FOR
+ * UPDATE and of DML statements are always fetched per relation.
+ */
+static void
+try_remote_join_path(PlannerInfo *root,
+					 RelOptInfo *joinrel,
+					 RelOptInfo *outerrel,
+					 RelOptInfo *innerrel,
+					 JoinType jointype,
+					 JoinPathExtraData *extra)
+{
+	Path	   *outer_path = outerrel->cheapest_total_path;
+	Path	   *inner_path = innerrel->cheapest_total_path;
+	RemotePrintExprContext rpec;
+	StringInfoData buf;
+	List	   *clauses;
+	ListCell   *lc;
+
+	if ((jointype != JOIN_INNER && jointype != JOIN_LEFT) ||
+		extra->sjinfo->jointype != jointype)
+		return;
+
+	if (!IS_SIMPLE_REL(outerrel) || !IS_SIMPLE_REL(innerrel) ||
+		outerrel->rtekind != RTE_RELATION ||
+		innerrel->rtekind != RTE_RELATION ||
+		!IS_REMOTE_RELOPT(root, outerrel) ||
+		!IS_REMOTE_RELOPT(root, innerrel) ||
+		outerrel->relshardid != innerrel->relshardid)
+		return;
+
+	if (root->parse->commandType != CMD_SELECT || root->rowMarks != NIL ||
+		joinrel->lateral_relids != NULL)
+		return;
+
+	if (outer_path == NULL || outer_path->pathtype != T_RemoteScan ||
+		outer_path->param_info != NULL ||
+		inner_path == NULL || inner_path->pathtype != T_RemoteScan ||
+		inner_path->param_info != NULL)
+		return;
+
+	foreach(lc, joinrel->reltarget->exprs)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+
+		if (!IsA(var, Var) || var->varattno <= 0)
+			return;
+	}
+
+	InitRemotePrintExprContext(&rpec, root->parse->rtable);
+	initStringInfo(&buf);
+
+	clauses = list_concat(list_copy(outerrel->baserestrictinfo),
+						  list_copy(innerrel->baserestrictinfo));
+	clauses = list_concat(clauses, list_copy(extra->restrictlist));
+	foreach(lc, clauses)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+		resetStringInfo(&buf);
+		if (rinfo->pseudoconstant ||
+			snprint_expr(&buf, rinfo->clause, &rpec) < 0)
+			return;
+	}
+	pfree(buf.data);
+
+	add_path(joinrel, (Path *)
+			 create_remote_join_path(root, joinrel, outer_path, inner_path,
+									 jointype, extra->restrictlist));
+}
+
 /*
  * select_mergejoin_clauses
  *	  Select mergejoin clauses that are usable for a particular join.
@@ -17,15 +17,22 @@
  */
 #include "postgres.h"
 
+#include "access/htup_details.h"
 #include "access/stratnum.h"
+#include "catalog/pg_am.h"
+#include "catalog/pg_attribute.h"
+#include "commands/defrem.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "nodes/plannodes.h"
+#include "nodes/print.h"
 #include "optimizer/clauses.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
 #include "optimizer/tlist.h"
+#include "parser/parsetree.h"
 #include "utils/lsyscache.h"
+#include "utils/syscache.h"
 
 
 static bool pathkey_is_redundant(PathKey *new_pathkey, List *pathkeys);
@@ -1696,3 +1703,122 @@ has_useful_pathkeys(PlannerInfo *root, RelOptInfo *rel)
 		return true;			/* might be able to use them for ordering */
 	return false;				/* definitely useless */
 }
+
+/****************************************************************************
+ *		REMOTE SCAN PATHKEYS
+ ****************************************************************************/
+
+/*
+ * find_remote_sort_expr
+ *	  Find the column of remote relation 'rel' that 'pathkey' sorts by, so
+ *	  that the storage node can be asked to return rows in that order.
+ *
+ * Returns NULL if there is no such plain column, or if MySQL may sort the
+ * column's values differently than the pathkey's btree opfamily does, see
+ * remote_type_compares_same().
+ */
+Expr *
+find_remote_sort_expr(PathKey *pathkey, RelOptInfo *rel)
+{
+	EquivalenceClass *ec = pathkey->pk_eclass;
+	ListCell   *lc;
+
+	if (ec->ec_has_volatile)
+		return NULL;
+
+	foreach(lc, ec->ec_members)
+	{
+		EquivalenceMember *em = (EquivalenceMember *) lfirst(lc);
+		Var		   *var = (Var *) em->em_expr;
+		Oid			opclass;
+
+		if (!IsA(var, Var) || var->varlevelsup != 0 || var->varattno <= 0 ||
+			!bms_equal(em->em_relids, rel->relids))
+			continue;
+
+		if (!remote_type_compares_same(var->vartype))
+			continue;
+
+		opclass = GetDefaultOpClass(var->vartype, BTREE_AM_OID);
+		if (!OidIsValid(opclass) ||
+			get_opclass_family(opclass) != pathkey->pk_opfamily)
+			continue;
+
+		return (Expr *) var;
+	}
+
+	return NULL;
+}
+
+/*
+ * remote_column_not_null
+ *	  Is column 'attno' of remote relation 'rel' declared NOT NULL?
+ */
+static bool
+remote_column_not_null(PlannerInfo *root, RelOptInfo *rel, AttrNumber attno)
+{
+	RangeTblEntry *rte = planner_rt_fetch(rel->relid, root);
+	HeapTuple	tp;
+	bool		result = false;
+
+	tp = SearchSysCache2(ATTNUM,
+						 ObjectIdGetDatum(rte->relid),
+						 Int16GetDatum(attno));
+	if (HeapTupleIsValid(tp))
+	{
+		result = ((Form_pg_attribute) GETSTRUCT(tp))->attnotnull;
+		ReleaseSysCache(tp);
+	}
+	return result;
+}
+
+/*
+ * remote_index_provides_order
+ *	  Can the storage node of remote relation 'rel' return its rows in the
+ *	  order of 'pathkeys' by scanning one of its indexes, instead of sorting?
+ *
+ * The pathkeys must be a prefix of the index's key columns, all scanned in
+ * the same direction, and must place NULLs where MySQL does (before all
+ * other values), unless the column is NOT NULL.
+ */
+bool
+remote_index_provides_order(PlannerInfo *root, RelOptInfo *rel,
+							List *pathkeys)
+{
+	ListCell   *lc;
+
+	foreach(lc, rel->indexlist)
+	{
+		IndexOptInfo *index = (IndexOptInfo *) lfirst(lc);
+		int			backward = -1;
+		int			i = 0;
+		ListCell   *lc2;
+
+		if (index->relam != BTREE_AM_OID || index->indpred != NIL ||
+			list_length(pathkeys) > index->nkeycolumns)
+			continue;
+
+		foreach(lc2, pathkeys)
+		{
+			PathKey    *pathkey = (PathKey *) lfirst(lc2);
+			Var		   *var = (Var *) find_remote_sort_expr(pathkey, rel);
+			bool		desc = (pathkey->pk_strategy == BTGreaterStrategyNumber);
+
+			if (var == NULL || var->varattno != index->indexkeys[i])
+				break;
+			if (backward < 0)
+				backward = (desc != index->reverse_sort[i]);
+			else if (backward != (desc != index->reverse_sort[i]))
+				break;
+			if (pathkey->pk_nulls_first == desc &&
+				!remote_column_not_null(root, rel, var->varattno))
+				break;
+			i++;
+		}
+
+		if (lc2 == NULL)
+			return true;
+	}
+
+	return false;
+}
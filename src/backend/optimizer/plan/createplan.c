@@ -294,6 +294,10 @@ static GatherMerge *create_gather_merge_plan(PlannerInfo *root,
 static RemoteScan *
 create_remotescan_plan(PlannerInfo *root, Path *best_path,
 					   List *tlist, List *scan_clauses);
+static Plan *create_remote_agg_plan(PlannerInfo *root,
+					   RemoteAggPath *best_path);
+static Plan *create_remote_join_plan(PlannerInfo *root,
+						RemoteJoinPath *best_path);
 
 
 /*
@@ -387,9 +391,18 @@ create_plan_recurse(PlannerInfo *root, Path *best_path, int flags)
 		case T_NamedTuplestoreScan:
 		case T_ForeignScan:
 		case T_CustomScan:
-		case T_RemoteScan:
 			plan = create_scan_plan(root, best_path, flags);
 			break;
+		case T_RemoteScan:
+			if (IsA(best_path, RemoteAggPath))
+				plan = create_remote_agg_plan(root,
+											  (RemoteAggPath *) best_path);
+			else if (IsA(best_path, RemoteJoinPath))
+				plan = create_remote_join_plan(root,
+											   (RemoteJoinPath *) best_path);
+			else
+				plan = create_scan_plan(root, best_path, flags);
+			break;
 		case T_HashJoin:
 		case T_MergeJoin:
 		case T_NestLoop:
@@ -2522,9 +2535,124 @@ create_remotescan_plan(PlannerInfo *root, Path *best_path,
 	scan_plan->query_level = root->query_level;
 	copy_generic_path_info(&scan_plan->plan, best_path);
 
+	/* Have the storage node return rows in the path's order */
+	if (best_path->pathkeys != NIL)
+	{
+		int			nkeys = list_length(best_path->pathkeys);
+		int			i = 0;
+		ListCell   *lc;
+
+		scan_plan->sortdesc = (bool *) palloc(nkeys * sizeof(bool));
+		scan_plan->nullsFirst = (bool *) palloc(nkeys * sizeof(bool));
+		foreach(lc, best_path->pathkeys)
+		{
+			PathKey    *pathkey = (PathKey *) lfirst(lc);
+			Expr	   *expr = find_remote_sort_expr(pathkey, best_path->parent);
+
+			if (!expr)
+				elog(ERROR, "could not find pathkey item to sort");
+			scan_plan->sortexprs = lappend(scan_plan->sortexprs,
+										   copyObject(expr));
+			scan_plan->sortdesc[i] =
+				(pathkey->pk_strategy == BTGreaterStrategyNumber);
+			scan_plan->nullsFirst[i] = pathkey->pk_nulls_first;
+			i++;
+		}
+	}
+
 	return scan_plan;
 }
 
+/*
+ * create_remote_agg_plan
+ *	 Returns a RemoteScan plan which has the storage node partially
+ *	 aggregate the rows of the remote relation scanned by best_path->subpath.
+ *
+ * The targetlist contains the partial Aggrefs themselves, setrefs.c matches
+ * them with the combining Aggrefs of the Finalize Aggregate above, and
+ * the executor replaces them with columns of the remote query's result.
+ */
+static Plan *
+create_remote_agg_plan(PlannerInfo *root, RemoteAggPath *best_path)
+{
+	RelOptInfo *rel = best_path->subpath->parent;
+	RemoteScan *scan_plan;
+	List	   *tlist;
+	List	   *scan_clauses;
+
+	Assert(rel->relid > 0 && rel->rtekind == RTE_RELATION);
+
+	tlist = build_path_tlist(root, &best_path->path);
+
+	/* All clauses are pushed down, see add_remote_partial_grouping_path() */
+	scan_clauses = order_qual_clauses(root, rel->baserestrictinfo);
+	scan_clauses = extract_actual_clauses(scan_clauses, false);
+
+	scan_plan = make_remotescan(tlist, scan_clauses, rel->relid);
+	scan_plan->query_level = root->query_level;
+	scan_plan->remote_agg = true;
+	scan_plan->groupexprs = copyObject(best_path->groupexprs);
+	copy_generic_path_info(&scan_plan->plan, &best_path->path);
+
+	return (Plan *) scan_plan;
+}
+
+/*
+ * create_remote_join_plan
+ *	 Returns a RemoteScan plan which has the storage shard join the two
+ *	 remote relations scanned by best_path's outer and inner paths.
+ *
+ * The plan scans the outer relation and joins it with joinrelid. For a
+ * JOIN_LEFT, the join clauses and the clauses of the inner relation are
+ * the ON clauses of the join, all other clauses are the plan's quals.
+ */
+static Plan *
+create_remote_join_plan(PlannerInfo *root, RemoteJoinPath *best_path)
+{
+	RelOptInfo *outerrel = best_path->outerpath->parent;
+	RelOptInfo *innerrel = best_path->innerpath->parent;
+	RemoteScan *scan_plan;
+	List	   *tlist;
+	List	   *scan_clauses;
+	List	   *inner_clauses;
+	List	   *joinclauses;
+	List	   *otherclauses;
+
+	Assert(outerrel->relid > 0 && innerrel->relid > 0);
+
+	tlist = build_path_tlist(root, &best_path->path);
+
+	if (IS_OUTER_JOIN(best_path->jointype))
+	{
+		extract_actual_join_clauses(best_path->joinrestrictinfo,
+									best_path->path.parent->relids,
+									&joinclauses, &otherclauses);
+	}
+	else
+	{
+		joinclauses = NIL;
+		otherclauses = extract_actual_clauses(best_path->joinrestrictinfo,
+											  false);
+	}
+
+	scan_clauses = extract_actual_clauses(outerrel->baserestrictinfo, false);
+	inner_clauses = extract_actual_clauses(innerrel->baserestrictinfo, false);
+	if (IS_OUTER_JOIN(best_path->jointype))
+		joinclauses = list_concat(joinclauses, inner_clauses);
+	else
+		scan_clauses = list_concat(scan_clauses, inner_clauses);
+	scan_clauses = list_concat(scan_clauses, otherclauses);
+
+	scan_plan = make_remotescan(tlist, scan_clauses, outerrel->relid);
+	scan_plan->query_level = root->query_level;
+	scan_plan->joinrelid = innerrel->relid;
+	scan_plan->jointype = best_path->jointype;
+	scan_plan->joinquals = joinclauses;
+	copy_generic_path_info(&scan_plan->plan, &best_path->path);
+
+	return (Plan *) scan_plan;
+}
+
 /*
  * create_seqscan_plan
  *	 Returns a seqscan plan for the base relation scanned by 'best_path'
@@ -4963,6 +5091,14 @@ make_remotescan(List *qptlist,
 	node->query_level = 0;
 	node->check_exists = false;
 	node->materialized = false;
+	node->sortexprs = NIL;
+	node->sortdesc = NULL;
+	node->nullsFirst = NULL;
+	node->remote_agg = false;
+	node->groupexprs = NIL;
+	node->joinrelid = 0;
+	node->jointype = JOIN_INNER;
+	node->joinquals = NIL;
 	return node;
 }
 
@@ -37,9 +37,7 @@
 #include "lib/knapsack.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
-#ifdef OPTIMIZER_DEBUG
 #include "nodes/print.h"
-#endif
 #include "optimizer/clauses.h"
 #include "optimizer/cost.h"
 #include "optimizer/paramassign.h"
@@ -220,9 +218,15 @@ static RelOptInfo *create_partial_grouping_paths(PlannerInfo *root,
 							  grouping_sets_data *gd,
 							  GroupPathExtraData *extra,
 							  bool force_rel_creation);
+static void add_remote_partial_grouping_path(PlannerInfo *root,
+								 RelOptInfo *input_rel,
+								 RelOptInfo *partially_grouped_rel,
+								 grouping_sets_data *gd,
+								 GroupPathExtraData *extra);
 static void gather_grouping_paths(PlannerInfo *root, RelOptInfo *rel);
 static bool can_partial_agg(PlannerInfo *root,
 				const AggClauseCosts *agg_costs);
+static bool rel_is_remote(PlannerInfo *root, RelOptInfo *rel);
 static void apply_scanjoin_target_to_paths(PlannerInfo *root,
 							   RelOptInfo *rel,
 							   List *scanjoin_targets,
@@ -3843,8 +3847,13 @@ create_grouping_paths(PlannerInfo *root,
 		 * It can be disabled by the user, and for now, we don't try to
 		 * support grouping sets.  create_ordinary_grouping_paths() will check
 		 * additional conditions, such as whether input_rel is partitioned.
+		 * Partitions of a remote table are aggregated one by one when
+		 * enable_remote_agg_pushdown is set, so that each storage shard can
+		 * do the partial aggregation of its partitions.
 		 */
-		if (enable_partitionwise_aggregate && !parse->groupingSets)
+		if ((enable_partitionwise_aggregate ||
+			 (enable_remote_agg_pushdown && rel_is_remote(root, input_rel))) &&
+			!parse->groupingSets)
 			extra.patype = PARTITIONWISE_AGGREGATE_FULL;
 		else
 			extra.patype = PARTITIONWISE_AGGREGATE_NONE;
@@ -4096,6 +4105,8 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 		gather_grouping_paths(root, partially_grouped_rel);
 		set_cheapest(partially_grouped_rel);
 	}
+	else if (partially_grouped_rel && partially_grouped_rel->pathlist)
+		set_cheapest(partially_grouped_rel);
 
 	/*
 	 * Estimate number of groups.
@@ -6479,6 +6490,15 @@ create_partial_grouping_paths(PlannerInfo *root,
 	ListCell   *lc;
 	bool		can_hash = (extra->flags & GROUPING_CAN_USE_HASH) != 0;
 	bool		can_sort = (extra->flags & GROUPING_CAN_USE_SORT) != 0;
+	bool		remote_agg;
+
+	/*
+	 * The storage node of a remote relation may do the partial aggregation,
+	 * see add_remote_partial_grouping_path().
+	 */
+	remote_agg = enable_remote_agg_pushdown && !parse->groupingSets &&
+		IS_SIMPLE_REL(input_rel) && input_rel->rtekind == RTE_RELATION &&
+		IS_REMOTE_RELOPT(root, input_rel);
 
 	/*
 	 * Consider whether we should generate partially aggregated non-partial
@@ -6506,6 +6526,7 @@ create_partial_grouping_paths(PlannerInfo *root,
 	 */
 	if (cheapest_total_path == NULL &&
 		cheapest_partial_path == NULL &&
+		!remote_agg &&
 		!force_rel_creation)
 		return NULL;
 
@@ -6732,6 +6753,10 @@ create_partial_grouping_paths(PlannerInfo *root,
 		}
 	}
 
+	if (remote_agg)
+		add_remote_partial_grouping_path(root, input_rel,
+										 partially_grouped_rel, gd, extra);
+
 	/*
 	 * If there is an FDW that's responsible for all baserels of the query,
 	 * let it consider adding partially grouped ForeignPaths.
@@ -6750,6 +6775,91 @@ create_partial_grouping_paths(PlannerInfo *root,
 	return partially_grouped_rel;
 }
 
+/*
+ * add_remote_partial_grouping_path
+ *
+ * Add a RemoteAggPath to partially_grouped_rel, which has the storage node
+ * of remote relation input_rel do the partial aggregation, i.e. compute
+ * the partial aggregates for each group of its rows and return only the
+ * groups. This is possible if all grouping expressions, partial aggregates
+ * and restriction clauses of input_rel can be printed as MySQL SQL and the
+ * MySQL aggregates return the transition states of the partial aggregates,
+ * see remote_partial_agg_supported().
+ */
+static void
+add_remote_partial_grouping_path(PlannerInfo *root,
+								 RelOptInfo *input_rel,
+								 RelOptInfo *partially_grouped_rel,
+								 grouping_sets_data *gd,
+								 GroupPathExtraData *extra)
+{
+	PathTarget *target = partially_grouped_rel->reltarget;
+	Path	   *subpath = input_rel->cheapest_total_path;
+	RemotePrintExprContext rpec;
+	StringInfoData buf;
+	List	   *groupexprs = NIL;
+	double		dNumGroups;
+	ListCell   *lc;
+	int			i = 0;
+
+	if (subpath == NULL || subpath->pathtype != T_RemoteScan ||
+		subpath->param_info != NULL)
+		return;
+
+	InitRemotePrintExprContext(&rpec, root->parse->rtable);
+	initStringInfo(&buf);
+
+	foreach(lc, input_rel->baserestrictinfo)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+
+		resetStringInfo(&buf);
+		if (rinfo->pseudoconstant ||
+			snprint_expr(&buf, rinfo->clause, &rpec) < 0)
+			return;
+	}
+
+	foreach(lc, target->exprs)
+	{
+		Expr	   *expr = (Expr *) lfirst(lc);
+		Index		sgref = get_pathtarget_sortgroupref(target, i);
+
+		i++;
+		resetStringInfo(&buf);
+		if (sgref != 0)
+		{
+			/* MySQL must group the values exactly as we would. */
+			if (!contain_var_clause((Node *) expr) ||
+				!remote_type_compares_same(exprType((Node *) expr)) ||
+				snprint_expr(&buf, expr, &rpec) < 0)
+				return;
+			groupexprs = lappend(groupexprs, expr);
+		}
+		else if (IsA(expr, Aggref))
+		{
+			Aggref	   *aggref = (Aggref *) expr;
+
+			if (!remote_partial_agg_supported(aggref))
+				return;
+			if (aggref->args != NIL &&
+				snprint_expr(&buf,
+							 ((TargetEntry *) linitial(aggref->args))->expr,
+							 &rpec) < 0)
+				return;
+		}
+		else
+			return;
+	}
+	pfree(buf.data);
+
+	dNumGroups = get_number_of_groups(root, subpath->rows, gd,
+									  extra->targetList);
+
+	add_path(partially_grouped_rel, (Path *)
+			 create_remote_agg_path(root, partially_grouped_rel, subpath,
+									target, groupexprs, dNumGroups));
+}
+
 /*
  * Generate Gather and Gather Merge paths for a grouping relation or partial
  * grouping relation.
@@ -6797,6 +6907,32 @@ gather_grouping_paths(PlannerInfo *root, RelOptInfo *rel)
 	}
 }
 
+/*
+ * rel_is_remote
+ *
+ * Returns true if all base relations of 'rel' are remote tables, or remote
+ * partitioned tables whose partitions are stored in storage shards.
+ */
+static bool
+rel_is_remote(PlannerInfo *root, RelOptInfo *rel)
+{
+	int			relid = -1;
+
+	if (bms_is_empty(rel->relids))
+		return false;
+
+	while ((relid = bms_next_member(rel->relids, relid)) >= 0)
+	{
+		RangeTblEntry *rte = planner_rt_fetch(relid, root);
+
+		if (rte->rtekind != RTE_RELATION ||
+			!(IS_REMOTE_RTE(rte) || IS_REMOTE_PARENT_RTE(rte)))
+			return false;
+	}
+
+	return true;
+}
+
 /*
  * can_partial_agg
  *
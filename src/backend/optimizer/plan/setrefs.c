@@ -630,15 +630,14 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 				splan->plan.qual =
 					fix_scan_list(root, splan->plan.qual, rtoffset);
 
-#if 0
-				remote scan will need an expected order, decided according to
-				the 'ORDER BY' clause or sort-merge join.
-
-				splan->indexorderby =
-					fix_scan_list(root, splan->indexorderby, rtoffset);
-				splan->indexorderbyorig =
-					fix_scan_list(root, splan->indexorderbyorig, rtoffset);
-#endif
+				splan->sortexprs =
+					fix_scan_list(root, splan->sortexprs, rtoffset);
+				splan->groupexprs =
+					fix_scan_list(root, splan->groupexprs, rtoffset);
+				if (splan->joinrelid != 0)
+					splan->joinrelid += rtoffset;
+				splan->joinquals =
+					fix_scan_list(root, splan->joinquals, rtoffset);
 			}
 			break;
 
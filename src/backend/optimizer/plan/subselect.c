@@ -2051,9 +2051,12 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 			break;
 
 		case T_RemoteScan:
-			/*finalize_primnode((Node *) ((RemoteScan *) plan)->indexorderby,
+			finalize_primnode((Node *) ((RemoteScan *) plan)->sortexprs,
+							  &context);
+			finalize_primnode((Node *) ((RemoteScan *) plan)->groupexprs,
+							  &context);
+			finalize_primnode((Node *) ((RemoteScan *) plan)->joinquals,
 							  &context);
-			*/
 			/*
 			 * we need not look at indexqualorig, since it will have the same
 			 * param references as indexqual.  Likewise, we can ignore
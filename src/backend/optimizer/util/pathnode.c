@@ -945,15 +945,24 @@ add_partial_path_precheck(RelOptInfo *parent_rel, Cost total_cost,
  *		PATH NODE CREATION ROUTINES
  *****************************************************************************/
 
+/*
+ * Extra cost of having the storage node sort the rows of a remote scan, as
+ * a fraction of the unsorted scan's cost. Not charged if an index of the
+ * remote relation provides the order.
+ */
+#define REMOTE_SORT_COST_MULTIPLIER 1.2
+
 /*
  * dzw:
  * create_remotescan_path
  *	  Creates a path corresponding to a remote scan, returning the
- *	  pathnode.
+ *	  pathnode. If 'pathkeys' isn't NIL the storage node is asked to return
+ *	  rows in that order, see find_remote_sort_expr().
  */
 Path *
 create_remotescan_path(PlannerInfo *root, RelOptInfo *rel,
-				       Relids required_outer, int parallel_workers)
+				       Relids required_outer, int parallel_workers,
+				       List *pathkeys)
 {
 	Path	   *pathnode = makeNode(Path);
 
@@ -963,11 +972,113 @@ create_remotescan_path(PlannerInfo *root, RelOptInfo *rel,
 	pathnode->param_info = get_baserel_parampathinfo(root, rel,
 													 required_outer);
 	pathnode->parallel_aware = false;
-	pathnode->parallel_safe = false;
+	pathnode->parallel_safe = rel->consider_parallel;
 	pathnode->parallel_workers = parallel_workers;
-	pathnode->pathkeys = NIL;	/* TODO: need to know the order, i.e. a valid pathkey */
+	pathnode->pathkeys = pathkeys;
 
-	cost_seqscan(pathnode, root, rel, pathnode->param_info);
+	cost_remotescan(pathnode, root, rel, pathnode->param_info);
+	if (pathkeys != NIL && !remote_index_provides_order(root, rel, pathkeys))
+	{
+		pathnode->startup_cost *= REMOTE_SORT_COST_MULTIPLIER;
+		pathnode->total_cost *= REMOTE_SORT_COST_MULTIPLIER;
+	}
+
+	return pathnode;
+}
+
+/*
+ * create_remote_agg_path
+ *	  Creates a pathnode that represents partial aggregation of a remote
+ *	  relation done by its storage node, see
+ *	  add_remote_partial_grouping_path().
+ *
+ * 'rel' is the partially grouped rel, 'subpath' the RemoteScan path of the
+ * remote relation and 'target' the partial grouping target.
+ */
+RemoteAggPath *
+create_remote_agg_path(PlannerInfo *root,
+					   RelOptInfo *rel,
+					   Path *subpath,
+					   PathTarget *target,
+					   List *groupexprs,
+					   double numGroups)
+{
+	RemoteAggPath *pathnode = makeNode(RemoteAggPath);
+
+	Assert(subpath->pathtype == T_RemoteScan && subpath->param_info == NULL);
+
+	pathnode->path.pathtype = T_RemoteScan;
+	pathnode->path.parent = rel;
+	pathnode->path.pathtarget = target;
+	pathnode->path.param_info = NULL;
+	pathnode->path.parallel_aware = false;
+	pathnode->path.parallel_safe = rel->consider_parallel &&
+		subpath->parallel_safe;
+	pathnode->path.parallel_workers = 0;
+	pathnode->path.pathkeys = NIL;	/* MySQL doesn't promise group order */
+	pathnode->subpath = subpath;
+	pathnode->groupexprs = groupexprs;
+	pathnode->numGroups = numGroups;
+
+	/*
+	 * The storage node scans and aggregates the rows where they are, only
+	 * the groups are sent back and processed here.
+	 */
+	pathnode->path.rows = numGroups;
+	pathnode->path.startup_cost = subpath->total_cost;
+	pathnode->path.total_cost = subpath->total_cost +
+		cpu_tuple_cost * numGroups;
+
+	return pathnode;
+}
+
+/*
+ * create_remote_join_path
+ *	  Creates a pathnode that represents a join of two remote relations done
+ *	  by their storage shard, see try_remote_join_path().
+ *
+ * 'outer_path' and 'inner_path' are the RemoteScan paths of the relations,
+ * 'restrict_clauses' are the RestrictInfos to apply to the join.
+ */
+RemoteJoinPath *
+create_remote_join_path(PlannerInfo *root,
+						RelOptInfo *joinrel,
+						Path *outer_path,
+						Path *inner_path,
+						JoinType jointype,
+						List *restrict_clauses)
+{
+	RemoteJoinPath *pathnode = makeNode(RemoteJoinPath);
+	QualCost	restrict_qual_cost;
+
+	pathnode->path.pathtype = T_RemoteScan;
+	pathnode->path.parent = joinrel;
+	pathnode->path.pathtarget = joinrel->reltarget;
+	pathnode->path.param_info = NULL;
+	pathnode->path.parallel_aware = false;
+	pathnode->path.parallel_safe = joinrel->consider_parallel &&
+		outer_path->parallel_safe && inner_path->parallel_safe;
+	pathnode->path.parallel_workers = 0;
+	pathnode->path.pathkeys = NIL;
+	pathnode->outerpath = outer_path;
+	pathnode->innerpath = inner_path;
+	pathnode->jointype = jointype;
+	pathnode->joinrestrictinfo = restrict_clauses;
+
+	/*
+	 * The storage shard scans both relations and joins the rows where they
+	 * are, only the join result is sent back to us. Both subpaths are
+	 * charged a statement round trip, but only one statement is sent.
+	 */
+	cost_qual_eval(&restrict_qual_cost, restrict_clauses, root);
+	pathnode->path.rows = joinrel->rows;
+	pathnode->path.startup_cost = outer_path->startup_cost +
+		inner_path->total_cost + restrict_qual_cost.startup -
+		remote_stmt_cost;
+	pathnode->path.total_cost = outer_path->total_cost +
+		inner_path->total_cost + restrict_qual_cost.startup -
+		remote_stmt_cost +
+		(cpu_tuple_cost + restrict_qual_cost.per_tuple) * joinrel->rows;
 
 	return pathnode;
 }
@@ -154,13 +154,10 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
 	rel->relshardid = relation->rd_rel->relshardid;
 	/*
 	  dzw: we never need to consider alternative AMs for accessing remote
-	  tables, so ignore its indexes.
+	  tables, but their indexes are kept, they tell which columns are unique
+	  and which orders the storage node can return rows in cheaply. Such
+	  indexes have no local storage, see below.
 	*/
-	if (IsRemoteRelation(relation))
-	{
-		rel->indexlist = NULL;
-		goto next;
-	}
 
 	/*
 	 * Make list of indexes.  Ignore indexes on system catalogs if told to.
@@ -406,7 +403,10 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
 			 */
 			if (info->indpred == NIL)
 			{
-				info->pages = RelationGetNumberOfBlocks(indexRelation);
+				if (IsRemoteRelation(indexRelation))
+					info->pages = indexRelation->rd_rel->relpages;
+				else
+					info->pages = RelationGetNumberOfBlocks(indexRelation);
 				info->tuples = rel->tuples;
 			}
 			else
@@ -419,7 +419,7 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
 					info->tuples = rel->tuples;
 			}
 
-			if (info->relam == BTREE_AM_OID)
+			if (info->relam == BTREE_AM_OID && !IsRemoteRelation(indexRelation))
 			{
 				/* For btrees, get tree height while we have the index open */
 				info->tree_height = _bt_getrootheight(indexRelation);
@@ -440,7 +440,6 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
 
 	rel->indexlist = indexinfos;
 
-next:
 	rel->statlist = get_relation_statistics(rel, relation);
 	/* Grab foreign-table info using the relcache, while we have it */
 	if (relation->rd_rel->relkind == RELKIND_FOREIGN_TABLE)
@@ -1599,8 +1599,13 @@ build_joinrel_partition_info(RelOptInfo *joinrel, RelOptInfo *outer_rel,
 	int			cnt;
 	PartitionScheme part_scheme;
 
-	/* Nothing to do if partitionwise join technique is disabled. */
-	if (!enable_partitionwise_join)
+	/*
+	 * Nothing to do if partitionwise join technique is disabled. Without
+	 * enable_partitionwise_join, only remote partitioned tables have
+	 * consider_partitionwise_join set, see set_append_rel_size(), so joins of
+	 * local partitioned tables are rejected below.
+	 */
+	if (!enable_partitionwise_join && !enable_remote_join_pushdown)
 	{
 		Assert(!IS_PARTITIONED_REL(joinrel));
 		return;
@@ -3612,6 +3612,9 @@ pgstat_get_wait_client(WaitEventClient w)
 		case WAIT_EVENT_WAL_SENDER_WRITE_DATA:
 			event_name = "WalSenderWriteData";
 			break;
+		case WAIT_EVENT_SHARD_RESULT:
+			event_name = "ShardResult";
+			break;
 			/* no default case, so that compiler will warn */
 	}
 
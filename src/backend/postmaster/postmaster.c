@@ -256,9 +256,11 @@ static pid_t StartupPID = 0,
 			PgArchPID = 0,
 			PgStatPID = 0,
 			SysLoggerPID = 0,
-			XidSenderPID = 0,
 			TopoServicePID = 0;
 
+/* PIDs of the xidsenders, the first cluster_commitlog_senders are used */
+static pid_t XidSenderPIDs[MAX_XID_SENDERS];
+
 /* Startup process's status */
 typedef enum
 {
@@ -426,6 +428,9 @@ static bool RandomCancelKey(int32 *cancel_key);
 static void signal_child(pid_t pid, int signal);
 static bool SignalSomeChildren(int signal, int targets);
 static void TerminateChildren(int signal);
+static void StartXidSenders(void);
+static void SignalXidSenders(int signal);
+static bool XidSendersRunning(void);
 
 #define SignalChildren(sig)			   SignalSomeChildren(sig, BACKEND_TYPE_ALL)
 
@@ -1773,8 +1778,8 @@ ServerLoop(void)
 		if (PgArchPID == 0 && PgArchStartupAllowed())
 			PgArchPID = pgarch_start();
 
-		if (XidSenderPID == 0 && pmState == PM_RUN)
-			XidSenderPID = xidsender_start();
+		if (pmState == PM_RUN)
+			StartXidSenders();
 
 		/* If we need to signal the autovacuum launcher, do so now */
 		if (avlauncher_needs_signal)
@@ -2560,8 +2565,7 @@ SIGHUP_handler(SIGNAL_ARGS)
 			signal_child(SysLoggerPID, SIGHUP);
 		if (PgStatPID != 0)
 			signal_child(PgStatPID, SIGHUP);
-		if (XidSenderPID != 0)
-			signal_child(XidSenderPID, SIGHUP);
+		SignalXidSenders(SIGHUP);
 		if (TopoServicePID!=0)
 			signal_child(TopoServicePID, SIGHUP);
 
@@ -2654,8 +2658,7 @@ pmdie(SIGNAL_ARGS)
 				/* and the walwriter too */
 				if (WalWriterPID != 0)
 					signal_child(WalWriterPID, SIGTERM);
-				if (XidSenderPID != 0)
-					signal_child(XidSenderPID, SIGTERM);
+				SignalXidSenders(SIGTERM);
 
 				/*
 				 * If we're in recovery, we can't kill the startup process
@@ -2704,8 +2707,7 @@ pmdie(SIGNAL_ARGS)
 				signal_child(BgWriterPID, SIGTERM);
 			if (WalReceiverPID != 0)
 				signal_child(WalReceiverPID, SIGTERM);
-			if (XidSenderPID != 0)
-				signal_child(XidSenderPID, SIGTERM);
+			SignalXidSenders(SIGTERM);
 			if (TopoServicePID != 0)
 				signal_child(TopoServicePID, SIGTERM);
 			if (pmState == PM_STARTUP || pmState == PM_RECOVERY)
@@ -2797,6 +2799,7 @@ reaper(SIGNAL_ARGS)
 	int			save_errno = errno;
 	int			pid;			/* process id of dead child process */
 	int			exitstatus;		/* its exit status */
+	int			i;
 
 	PG_SETMASK(&BlockSig);
 
@@ -2902,8 +2905,7 @@ reaper(SIGNAL_ARGS)
 				PgArchPID = pgarch_start();
 			if (PgStatPID == 0)
 				PgStatPID = pgstat_start();
-			if (XidSenderPID == 0)
-				XidSenderPID = xidsender_start();
+			StartXidSenders();
 			if (TopoServicePID == 0)
 				TopoServicePID = StartTopoService();
 
@@ -3091,10 +3093,15 @@ reaper(SIGNAL_ARGS)
 			continue;
 		}
 
-		/* Was it the xid sender?  If so, try to start a new one */
-		if (pid == XidSenderPID)
+		/* Was it an xid sender?  If so, try to start a new one */
+		for (i = 0; i < MAX_XID_SENDERS; i++)
+		{
+			if (pid == XidSenderPIDs[i])
+				break;
+		}
+		if (i < MAX_XID_SENDERS)
 		{
-			XidSenderPID = 0;
+			XidSenderPIDs[i] = 0;
 			/* for safety's sake, launch new sender *first* */
 			if (!EXIT_STATUS_0(exitstatus) && !EXIT_STATUS_1(exitstatus))
 			{
@@ -3564,15 +3571,18 @@ HandleChildCrash(int pid, int exitstatus, const char *procname)
 		allow_immediate_pgstat_restart();
 	}
 
-	if (pid == XidSenderPID)
-		XidSenderPID = 0;
-	else if (XidSenderPID != 0 && take_action)
+	for (int i = 0; i < MAX_XID_SENDERS; i++)
 	{
-		ereport(DEBUG2,
-				(errmsg_internal("sending %s to process %d",
-								 (SendStop ? "SIGSTOP" : "SIGQUIT"),
-								 (int) XidSenderPID)));
-		signal_child(XidSenderPID, (SendStop ? SIGSTOP : SIGQUIT));
+		if (pid == XidSenderPIDs[i])
+			XidSenderPIDs[i] = 0;
+		else if (XidSenderPIDs[i] != 0 && take_action)
+		{
+			ereport(DEBUG2,
+					(errmsg_internal("sending %s to process %d",
+									 (SendStop ? "SIGSTOP" : "SIGQUIT"),
+									 (int) XidSenderPIDs[i])));
+			signal_child(XidSenderPIDs[i], (SendStop ? SIGSTOP : SIGQUIT));
+		}
 	}
 	/* We do NOT restart the syslogger */
 
@@ -3730,7 +3740,7 @@ PostmasterStateMachine(void)
 			 (!FatalError && Shutdown < ImmediateShutdown)) &&
 			WalWriterPID == 0 &&
 			AutoVacPID == 0 &&
-			XidSenderPID == 0 &&
+			!XidSendersRunning() &&
 			TopoServicePID == 0)
 		{
 			if (Shutdown >= ImmediateShutdown || FatalError)
@@ -3781,8 +3791,7 @@ PostmasterStateMachine(void)
 						signal_child(PgArchPID, SIGQUIT);
 					if (PgStatPID != 0)
 						signal_child(PgStatPID, SIGQUIT);
-					if (XidSenderPID != 0)
-						signal_child(XidSenderPID, SIGQUIT);
+					SignalXidSenders(SIGQUIT);
 				}
 			}
 		}
@@ -3827,7 +3836,7 @@ PostmasterStateMachine(void)
 			Assert(CheckpointerPID == 0);
 			Assert(WalWriterPID == 0);
 			Assert(AutoVacPID == 0);
-			Assert(XidSenderPID == 0);
+			Assert(!XidSendersRunning());
 			/* syslogger is not considered here */
 			pmState = PM_NO_CHILDREN;
 		}
@@ -4021,12 +4030,50 @@ TerminateChildren(int signal)
 		signal_child(PgArchPID, signal);
 	if (PgStatPID != 0)
 		signal_child(PgStatPID, signal);
-	if (XidSenderPID != 0)
-		signal_child(XidSenderPID, signal);
+	SignalXidSenders(signal);
 	if (TopoServicePID != 0)
 		signal_child(TopoServicePID, signal);
 }
 
+/*
+ * StartXidSenders -- start the xidsenders that are not running
+ *
+ * It doesn't matter if this fails, we'll just try again later.
+ */
+static void
+StartXidSenders(void)
+{
+	for (int i = 0; i < cluster_commitlog_senders; i++)
+	{
+		if (XidSenderPIDs[i] == 0)
+			XidSenderPIDs[i] = xidsender_start(i);
+	}
+}
+
+/*
+ * SignalXidSenders -- send a signal to all running xidsenders
+ */
+static void
+SignalXidSenders(int signal)
+{
+	for (int i = 0; i < MAX_XID_SENDERS; i++)
+	{
+		if (XidSenderPIDs[i] != 0)
+			signal_child(XidSenderPIDs[i], signal);
+	}
+}
+
+static bool
+XidSendersRunning(void)
+{
+	for (int i = 0; i < MAX_XID_SENDERS; i++)
+	{
+		if (XidSenderPIDs[i] != 0)
+			return true;
+	}
+	return false;
+}
+
 /*
  * BackendStartup -- start backend process
  *
@@ -5034,7 +5081,7 @@ SubPostmasterMain(int argc, char *argv[])
 
 		SysLoggerMain(argc, argv);	/* does not return */
 	}
-	if (strcmp(argv[1], "--fork_xidsender") == 0)
+	if (strncmp(argv[1], "--fork_xidsender=", 17) == 0)
 	{
 		/* Restore basic shared memory pointers */
 		InitShmemAccess(UsedShmemSegAddr);
@@ -29,6 +29,7 @@
 #endif
 
 #include "pgstat.h"
+#include "funcapi.h"
 #include "access/htup.h"
 #include "access/htup_details.h"
 #include "access/remote_meta.h"
@@ -41,6 +42,8 @@
 #include "postmaster/xidsender.h"
 #include "postmaster/fork_process.h"
 #include "postmaster/postmaster.h"
+#include "port/atomics.h"
+#include "portability/instr_time.h"
 #include "sharding/cluster_meta.h"
 #include "storage/bufmgr.h"
 #include "storage/dsm.h"
@@ -49,6 +52,7 @@
 #include "storage/latch.h"
 #include "storage/shmem.h"
 #include "storage/smgr.h"
+#include "storage/spin.h"
 #include "storage/pmsignal.h"
 #include "storage/proc.h"
 #include "storage/pg_shmem.h"
@@ -89,18 +93,87 @@ typedef struct GlobalXid
 	long fenceNo;
 } GlobalXid;
 
-typedef struct XidGlobalInfo
+/* ----------
+ * Max number of concurrently running transactions.
+ *
+ * ----------
+ */
+#define MaxConcurrentTxns (MaxBackends)
+
+/*
+  Backends append their slots to one of these partitions, picked by
+  pgprocno, so that concurrent committers mostly take different spinlocks.
+  A backend whose partition is full spills into the next ones.
+  Partition p is reaped by xidsender p % cluster_commitlog_senders, each
+  sender sends its own batches over its own metadata shard connection.
+*/
+#define XIDSENDER_NPARTITIONS 16
+#define XidSlotsPerPartition \
+	((MaxConcurrentTxns + XIDSENDER_NPARTITIONS - 1) / XIDSENDER_NPARTITIONS)
+#define XidSlotsTotal (XidSlotsPerPartition * XIDSENDER_NPARTITIONS)
+#define XidPartitionSender(partno) ((partno) % cluster_commitlog_senders)
+
+typedef struct XidSlotPartition
 {
+	slock_t mutex;
 	int num_used_slots;
-	TransactionId max_trxid;
+	/*
+	  Bumped each time non-empty slots are reaped, a slot appended when it's
+	  N is sent in the batch of generation N + 1.
+	*/
+	uint64 reap_gen;
+	/* reap_gen of the last batch whose commit logs have been written. */
+	pg_atomic_uint64 done_gen;
+} XidSlotPartition;
+
+typedef union XidSlotPartitionPadded
+{
+	XidSlotPartition part;
+	char pad[PG_CACHE_LINE_SIZE];
+} XidSlotPartitionPadded;
+
+/*
+  Statistics of the commit log insert stmts sent by the xidsender, only
+  written by the xidsender.
+*/
+typedef struct XidSenderStats
+{
+	uint64 nbatches;
+	uint64 nxids;
+	uint64 nretries;
+	uint64 total_latency_us;
+	uint64 max_latency_us;
+	uint64 last_latency_us;
+	int last_batch_size;
+	double recent_latency_us; /* moving average of recent batches */
+} XidSenderStats;
+
+typedef struct XidSenderInfo
+{
+	pg_atomic_uint32 num_pending; /* slots appended but not reaped yet */
 	pid_t procid;
-	sig_atomic_t counter;
+	/*
+	  Number of pending slots at which backends wake up the xidsender, adapted
+	  by the xidsender when cluster_commitlog_latency_target_ms is set.
+	*/
+	int group_size;
+} XidSenderInfo;
+
+typedef struct XidGlobalInfo
+{
+	TransactionId max_trxid;
+	XidSenderInfo senders[MAX_XID_SENDERS];
+	slock_t stats_mutex;
+	XidSenderStats stats;
 }XidGlobalInfo;
 
 
+static XidSlotPartitionPadded *XidPartitions = NULL;
 static GlobalXid *XidSlots = NULL;
 static XidGlobalInfo *g_xgi = NULL;
 static MYSQL_CONN cluster_conn;
+/* Index of this xidsender process in g_xgi->senders, -1 in other procs. */
+static int MyXidSenderNo = -1;
 /*
   Do not retry connection, let upper level caller repeat its operation instead,
   so that we can handle topo checks ASAP.
@@ -110,6 +183,8 @@ const static int MAX_METASHARD_MASTER_CONN_RETRIES = 1;
 // GUC
 int cluster_commitlog_group_size = 8;
 int cluster_commitlog_delay_ms = 0;
+int cluster_commitlog_latency_target_ms = 0;
+int cluster_commitlog_senders = 1;
 bool skip_tidsync = false;
 
 /* Signal handler flags */
@@ -587,54 +662,130 @@ dump_shards_bitmap(int nshards, ulong *bitmap, StringInfo str)
 	appendStringInfoChar(str, ']');
 }
 
+#define XidPartitionSlots(i) (XidSlots + (i) * XidSlotsPerPartition)
+
+/*
+ * Number of pending slots at which an xidsender is waken up to send them.
+ */
+static inline int
+commit_log_group_size(XidSenderInfo *sender)
+{
+	if (cluster_commitlog_latency_target_ms > 0)
+		return sender->group_size;
+	return cluster_commitlog_group_size;
+}
+
+static inline void
+wakeup_xidsender(XidSenderInfo *sender)
+{
+	pid_t pid = sender->procid;
+
+	if (pid != 0)
+		kill(pid, SIGUSR2);
+}
+
+/*
+ * Copy 'xidslot' into a free slot, starting from the partition of this
+ * backend. Only a spinlock of one partition is held during the copy.
+ * @retval false if all partitions are full.
+ * */
+static bool
+append_xid_slot(GlobalXid *xidslot, int *partno, uint64 *gen, uint32 *npending)
+{
+	int start = MyProc->pgprocno % XIDSENDER_NPARTITIONS;
+
+	for (int i = 0; i < XIDSENDER_NPARTITIONS; i++)
+	{
+		XidSlotPartition *part;
+		XidSenderInfo *sender;
+
+		*partno = (start + i) % XIDSENDER_NPARTITIONS;
+		part = &XidPartitions[*partno].part;
+		sender = &g_xgi->senders[XidPartitionSender(*partno)];
+
+		SpinLockAcquire(&part->mutex);
+		if (part->num_used_slots < XidSlotsPerPartition)
+		{
+			XidPartitionSlots(*partno)[part->num_used_slots++] = *xidslot;
+			/*
+			  Counted while holding the spinlock so that reapXids() never sees
+			  a slot before it's counted.
+			*/
+			*npending = pg_atomic_add_fetch_u32(&sender->num_pending, 1);
+			*gen = part->reap_gen;
+			SpinLockRelease(&part->mutex);
+			return true;
+		}
+		SpinLockRelease(&part->mutex);
+	}
+
+	return false;
+}
+
 /*
  * Called by backends to wait for commit log write completion.
  * @retval 1: successful; 0: failure; -1: timeout
  * */
 char WaitForXidCommitLogWrite(Oid comp_nodeid, GlobalTrxId xid, time_t deadline, List *prepared_shards, bool commit_it)
 {
-	LWLockAcquire(GlobalXidSenderLock, LW_EXCLUSIVE);
-	int slot_idx = g_xgi->num_used_slots++;
-	GlobalXid *slot = XidSlots + slot_idx;
-	slot->comp_nodeid = comp_nodeid;
-	slot->deadline = deadline;
-	slot->gtrxid = xid;
-	slot->proc = MyProc;
-	slot->txn_action = (commit_it ? 1 : 0);
-	slot->pid = MyProc->pid;
-	slot->fenceNo = MyProc->fence.fence_no;
+	GlobalXid xidslot;
+	XidSenderInfo *sender;
+	int partno;
+	uint64 gen;
+	uint32 npending;
+
+	xidslot.comp_nodeid = comp_nodeid;
+	xidslot.deadline = deadline;
+	xidslot.gtrxid = xid;
+	xidslot.proc = MyProc;
+	xidslot.txn_action = (commit_it ? 1 : 0);
+	xidslot.pid = MyProc->pid;
+	xidslot.fenceNo = MyProc->fence.fence_no;
 	
-	/* Encode prepared shards */
-	slot->nshards = list_length(prepared_shards);
-	memset(slot->shards_bitmap, 0, sizeof(slot->shards_bitmap));
+	/*
+	 * Encode prepared shards, this may need to look up the shards in catalog
+	 * so it's done before taking any lock.
+	 */
+	xidslot.nshards = list_length(prepared_shards);
+	memset(xidslot.shards_bitmap, 0, sizeof(xidslot.shards_bitmap));
 	ListCell *lc;
 	foreach(lc, prepared_shards)
 	{
-		encode_shards_bitmap(lfirst_oid(lc), slot->shards_bitmap);
+		encode_shards_bitmap(lfirst_oid(lc), xidslot.shards_bitmap);
 	}
 
-	uint64_t counter = g_xgi->counter;
-	if (g_xgi->num_used_slots >= cluster_commitlog_group_size && g_xgi->procid != 0)
-		kill(g_xgi->procid, SIGUSR2);
-	LWLockRelease(GlobalXidSenderLock);
+	while (!append_xid_slot(&xidslot, &partno, &gen, &npending))
+	{
+		/*
+		  Aborting backends don't wait for their slots to be sent, so in rare
+		  cases there can be more slots than backends. Let the xidsenders reap
+		  them and retry.
+		*/
+		for (int i = 0; i < cluster_commitlog_senders; i++)
+			wakeup_xidsender(&g_xgi->senders[i]);
+		pg_usleep(1000L);
+	}
+
+	sender = &g_xgi->senders[XidPartitionSender(partno)];
+	if (npending >= commit_log_group_size(sender))
+		wakeup_xidsender(sender);
 
 	/* 
 	 * Wait for completion if committing, no need to wait if aborting, because
 	 * prepared txn branches will be aborted after timeouts.
-	 * Only wait if our task has not been reap'ed yet otherwise this process
-	 * won't be waken up ever.
+	 * Only wait if the batch carrying our slot has not been sent yet,
+	 * otherwise this process won't be waken up ever.
 	 */
 	int ret = 0;
 
-	if (commit_it && g_xgi->counter == counter)
+	if (commit_it &&
+		pg_atomic_read_u64(&XidPartitions[partno].part.done_gen) <= gen)
 	{
 		/*
-		  We read the non-atomic g_xgi->counter without holding GlobalXidSenderLock,
-		  this isn't a problem --- the worst case is that the proc isn't notified
-		  by PGSemaphoreUnlock(), and timeout mechanism will make sure the user
-		  backend won't block forever but return correctly after statement timeout.
-		  OTOH, we have 100% guarantee that if we don't wait here, the commit log
-		  has definitely been received by metadata shard.
+		  If the batch completes after the check above, our semaphore has
+		  been unlocked and the wait below returns at once. The timeout
+		  mechanism makes sure the user backend won't block forever but
+		  return correctly after statement timeout.
 		*/
 		ret = PGSemaphoreTimedLockFence(MyProc->sem, StatementTimeout, &MyProc->fence);
 		Assert(ret == 0 || ret == 1);
@@ -649,6 +800,8 @@ char WaitForXidCommitLogWrite(Oid comp_nodeid, GlobalTrxId xid, time_t deadline,
 			RequestShardingTopoCheck(METADATA_SHARDID);
 		}
 	}
+	else if (commit_it)
+		pg_read_barrier();	/* pairs with the barrier in XidSenderMain() */
 
 	return MyProc->commit_log_append_done;
 }
@@ -665,28 +818,140 @@ void disconnect_request_kill_meta_conn(int c, Datum d)
 }
 
 /*
- * Quickly copy slots to local buffer to assemble insert stmt to send to
- * remote meta server. 'slots' is assumed big enough, it has MaxBackends
- * slots just as big as XidSlots.
+ * Quickly copy slots of the partitions owned by this xidsender to local
+ * buffer to assemble insert stmt to send to remote meta server. 'slots' is
+ * assumed big enough, it has XidSlotsTotal slots just as big as XidSlots.
+ * The generation of the batch of each reaped partition is stored into
+ * 'gens', 0 if nothing was reaped from it.
  * */
-static int reapXids(GlobalXid *slots)
+static int reapXids(GlobalXid *slots, uint64 *gens)
 {
+	XidSenderInfo *sender = &g_xgi->senders[MyXidSenderNo];
 	int ret = 0;
-	LWLockAcquire(GlobalXidSenderLock, LW_EXCLUSIVE);
-	memcpy(slots, XidSlots, g_xgi->num_used_slots * sizeof(GlobalXid));
-	ret = g_xgi->num_used_slots;
-	g_xgi->num_used_slots = 0;
-	LWLockRelease(GlobalXidSenderLock);
+
+	for (int i = MyXidSenderNo; i < XIDSENDER_NPARTITIONS;
+		 i += cluster_commitlog_senders)
+	{
+		XidSlotPartition *part = &XidPartitions[i].part;
+		int n;
+
+		gens[i] = 0;
+		SpinLockAcquire(&part->mutex);
+		n = part->num_used_slots;
+		if (n > 0)
+		{
+			memcpy(slots + ret, XidPartitionSlots(i), n * sizeof(GlobalXid));
+			part->num_used_slots = 0;
+			gens[i] = ++part->reap_gen;
+		}
+		SpinLockRelease(&part->mutex);
+		ret += n;
+	}
+
+	if (ret > 0)
+		pg_atomic_sub_fetch_u32(&sender->num_pending, ret);
 	return ret;
 }
 
+/*
+ * Milliseconds to wait for more slots to accumulate before sending a batch.
+ * With a latency target, a commit may wait as long as the target leaves
+ * after the recent insert round trip time.
+ * */
+static int commit_log_wait_ms(void)
+{
+	int ms;
 
-/* ----------
- * Max number of concurrently running transactions.
- *
- * ----------
+	if (cluster_commitlog_latency_target_ms <= 0)
+		return cluster_commitlog_delay_ms;
+
+	ms = cluster_commitlog_latency_target_ms -
+		(int)(g_xgi->stats.recent_latency_us / 1000);
+	return Max(ms, 1);
+}
+
+/*
+ * Account a sent batch, and adapt the group size to the latency target:
+ * grow it while batches fill up and are sent in time, so that the sender is
+ * waken up less often; shrink it when the target is missed or when the wait
+ * times out before the group is full.
+ * */
+static void update_commit_log_stats(int batch_size, int nretries,
+									uint64 latency_us, bool filled)
+{
+	XidSenderStats *stats = &g_xgi->stats;
+	XidSenderInfo *sender = &g_xgi->senders[MyXidSenderNo];
+	int group_size = sender->group_size;
+
+	SpinLockAcquire(&g_xgi->stats_mutex);
+	stats->nbatches++;
+	stats->nxids += batch_size;
+	stats->nretries += nretries;
+	stats->total_latency_us += latency_us;
+	stats->max_latency_us = Max(stats->max_latency_us, latency_us);
+	stats->last_latency_us = latency_us;
+	stats->last_batch_size = batch_size;
+	if (stats->recent_latency_us == 0)
+		stats->recent_latency_us = latency_us;
+	else
+		stats->recent_latency_us = 0.8 * stats->recent_latency_us + 0.2 * latency_us;
+	SpinLockRelease(&g_xgi->stats_mutex);
+
+	if (cluster_commitlog_latency_target_ms <= 0)
+	{
+		sender->group_size = cluster_commitlog_group_size;
+		return;
+	}
+
+	if (latency_us > cluster_commitlog_latency_target_ms * 1000L)
+		group_size = group_size / 2;
+	else if (filled)
+		group_size += Max(group_size / 4, 1);
+	else
+		group_size = (group_size + batch_size) / 2;
+
+	sender->group_size = Min(Max(group_size, 1), XidSlotsTotal);
+}
+
+/*
+ * Show statistics of the commit log batches sent by the xidsenders, the
+ * group size is the sum of that of all xidsenders.
  */
-#define MaxConcurrentTxns (MaxBackends)
+Datum
+cluster_commitlog_stats(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	XidSenderStats stats;
+	int			group_size = 0;
+	Datum		values[10];
+	bool		nulls[10];
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	SpinLockAcquire(&g_xgi->stats_mutex);
+	stats = g_xgi->stats;
+	SpinLockRelease(&g_xgi->stats_mutex);
+
+	for (int i = 0; i < cluster_commitlog_senders; i++)
+		group_size += commit_log_group_size(&g_xgi->senders[i]);
+
+	MemSet(nulls, 0, sizeof(nulls));
+	values[0] = Int64GetDatum(stats.nbatches);
+	values[1] = Int64GetDatum(stats.nxids);
+	values[2] = Int64GetDatum(stats.nretries);
+	values[3] = Float8GetDatum(stats.nbatches ?
+							   (double)stats.nxids / stats.nbatches : 0);
+	values[4] = Float8GetDatum(stats.nbatches ?
+							   stats.total_latency_us / 1000.0 / stats.nbatches : 0);
+	values[5] = Float8GetDatum(stats.max_latency_us / 1000.0);
+	values[6] = Int32GetDatum(stats.last_batch_size);
+	values[7] = Float8GetDatum(stats.last_latency_us / 1000.0);
+	values[8] = Float8GetDatum(stats.recent_latency_us / 1000.0);
+	values[9] = Int32GetDatum(group_size);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
 
 static MemoryContext xidSenderLocalContext = NULL;
 
@@ -696,7 +961,7 @@ static MemoryContext xidSenderLocalContext = NULL;
  * ----------
  */
 #ifdef EXEC_BACKEND
-static pid_t xidsender_forkexec(void);
+static pid_t xidsender_forkexec(int senderno);
 #endif
 
 static void xidsender_exit(SIGNAL_ARGS);
@@ -729,13 +994,16 @@ xidsender_setup_memcxt(void)
  * Format up the arglist for xid sender process, then fork and exec.
  */
 static pid_t
-xidsender_forkexec(void)
+xidsender_forkexec(int senderno)
 {
 	char	   *av[10];
+	char		forkav[MAXPGPATH];
 	int			ac = 0;
 
+	snprintf(forkav, MAXPGPATH, "--fork_xidsender=%d", senderno);
+
 	av[ac++] = "postgres";
-	av[ac++] = "--fork_xidsender";
+	av[ac++] = forkav;
 	av[ac++] = NULL;			/* filled in by postmaster_forkexec */
 
 	av[ac] = NULL;
@@ -789,23 +1057,25 @@ xidsender_sigusr2_handler(SIGNAL_ARGS)
 /*
  * xidsender_start() -
  *
- *	Called from postmaster at startup or after an existing sender dies.
+ *	Called from postmaster at startup or after an existing sender dies,
+ *	'senderno' is in [0, cluster_commitlog_senders).
  *
  *	Returns PID of child process, or 0 if fail.
  *
  *	Note: if fail, we will be called again from the postmaster main loop.
  */
 int
-xidsender_start(void)
+xidsender_start(int senderno)
 {
 	pid_t		xidSenderPid;
 
+	Assert(senderno >= 0 && senderno < cluster_commitlog_senders);
 	MyPMChildSlot = AssignPostmasterChildSlot();
 	/*
 	 * Okay, fork off the xid sender.
 	 */
 #ifdef EXEC_BACKEND
-	switch ((xidSenderPid = xidsender_forkexec()))
+	switch ((xidSenderPid = xidsender_forkexec(senderno)))
 #else
 	switch ((xidSenderPid = fork_process()))
 #endif
@@ -829,6 +1099,7 @@ xidsender_start(void)
 			dsm_detach_all();
 			PGSharedMemoryDetach();*/
 
+			MyXidSenderNo = senderno;
 			XidSenderMain(0, NULL);
 			break;
 #endif
@@ -974,18 +1245,17 @@ end:
 		pfree(stmt.data);
 }
 
-static uint64_t MAX_SIGATOMIC = 0;
-
 void XidSenderMain(int argc, char **argv)
 {
 	sigjmp_buf	local_sigjmp_buf;
+	XidSenderInfo *sender;
 
-	if (sizeof(sig_atomic_t) == 4)
-		MAX_SIGATOMIC = UINT32_MAX;
-	else if (sizeof(sig_atomic_t) == 8)
-		MAX_SIGATOMIC = UINT64_MAX;
-	else
-		Assert(false);
+#ifdef EXEC_BACKEND
+	Assert(argc >= 2 && strncmp(argv[1], "--fork_xidsender=", 17) == 0);
+	MyXidSenderNo = atoi(argv[1] + 17);
+#endif
+	Assert(MyXidSenderNo >= 0 && MyXidSenderNo < cluster_commitlog_senders);
+	sender = &g_xgi->senders[MyXidSenderNo];
 	/*
 	 * Identify myself via ps
 	 */
@@ -1013,7 +1283,7 @@ void XidSenderMain(int argc, char **argv)
 	PG_SETMASK(&UnBlockSig);
 	
 	IsBackgroundWorker = true;
-	g_xgi->procid = getpid();
+	sender->procid = getpid();
 
 	/*
 	 * If an exception is encountered, processing resumes here.
@@ -1110,13 +1380,16 @@ void XidSenderMain(int argc, char **argv)
 	xidsender_setup_memcxt();
 	GlobalXid *localbuf =
 		MemoryContextAlloc(xidSenderLocalContext,
-						   MaxBackends * sizeof(GlobalXid));
+						   XidSlotsTotal * sizeof(GlobalXid));
+	uint64 reaped_gens[XIDSENDER_NPARTITIONS];
 	StringInfoData stmt, json_shards;
         initStringInfo2(&stmt, 8192, xidSenderLocalContext);
 	initStringInfo2(&json_shards, 8192, xidSenderLocalContext);
 	time_t now = 0, when_last_send = 0;
 
-	recover_nextXid_global();
+	/* Only one xidsender needs to recover the next xid. */
+	if (MyXidSenderNo == 0)
+		recover_nextXid_global();
 start:
 
 	now = time(0);
@@ -1133,7 +1406,8 @@ start:
 		 * */
 		if (got_SIGHUP)
 		{
-
+			got_SIGHUP = false;
+			ProcessConfigFile(PGC_SIGHUP);
 		}
 
 		if (!cluster_conn.connected)
@@ -1141,10 +1415,11 @@ start:
 			connect_to_metadata_cluster(true);
 		}
 
-		// Do an inaccurate unsynced read, wait 1s if no much work accumulated yet.
-		if (g_xgi->num_used_slots < cluster_commitlog_group_size)
+		// Wait a while if no much work accumulated yet.
+		int group_size = commit_log_group_size(sender);
+		if (pg_atomic_read_u32(&sender->num_pending) < group_size)
 		{
-			wait_latch(cluster_commitlog_delay_ms);
+			wait_latch(commit_log_wait_ms());
 		}
 
 		CHECK_FOR_INTERRUPTS();
@@ -1155,11 +1430,14 @@ start:
 			when_last_send = now;
 		}
 
-		int nslots = reapXids(localbuf);
+		int nslots = reapXids(localbuf, reaped_gens);
 
 		if (nslots == 0)
 			continue;
 
+		int batch_size = nslots;
+		instr_time start_time, elapsed;
+		INSTR_TIME_SET_CURRENT(start_time);
 		
 		// send the stmt.
 		int retry_count = 0;
@@ -1220,16 +1498,32 @@ retry_send:
 			}
 
 			when_last_send = time(0);
-			LWLockAcquire(GlobalXidSenderLock, LW_EXCLUSIVE);
-			g_xgi->counter++;
-			if (g_xgi->counter == MAX_SIGATOMIC)
-				g_xgi->counter = 0;
-			LWLockRelease(GlobalXidSenderLock);
+
+			INSTR_TIME_SET_CURRENT(elapsed);
+			INSTR_TIME_SUBTRACT(elapsed, start_time);
+			update_commit_log_stats(batch_size, retry_count,
+									INSTR_TIME_GET_MICROSEC(elapsed),
+									batch_size >= group_size);
+
+			for (int i = 0; i < nslots; i++)
+				localbuf[i].proc->commit_log_append_done = (done ? 1 : 0);
+
+			/*
+			  Backends seeing the new generation don't wait for their
+			  semaphores, so their results must be visible before it.
+			*/
+			pg_write_barrier();
+			for (int i = MyXidSenderNo; i < XIDSENDER_NPARTITIONS;
+				 i += cluster_commitlog_senders)
+			{
+				if (reaped_gens[i] != 0)
+					pg_atomic_write_u64(&XidPartitions[i].part.done_gen,
+										reaped_gens[i]);
+			}
 
 			for (int i = 0; i < nslots; i++)
 			{
 				GlobalXid *slot = localbuf + i;
-				slot->proc->commit_log_append_done = (done ? 1 : 0);
 				if (slot->txn_action == 1 && // only commit waits
 				    slot->proc->pid == slot->pid)
 				{
@@ -1253,7 +1547,8 @@ BackendXidSenderShmemSize(void)
 	Size		size;
 
 	/* XidSlots: */
-	size = mul_size(sizeof(GlobalXid), MaxConcurrentTxns);
+	size = mul_size(sizeof(GlobalXid), XidSlotsTotal);
+	size = add_size(size, mul_size(sizeof(XidSlotPartitionPadded), XIDSENDER_NPARTITIONS));
 	size += MAXALIGN(sizeof(XidGlobalInfo));
 	return size;
 }
@@ -1272,7 +1567,12 @@ CreateSharedBackendXidSlots(void)
 	/* Create or attach to the shared array */
 	size = BackendXidSenderShmemSize();
 	g_xgi = (XidGlobalInfo*)ShmemInitStruct("Backend Global XID Info and Slots Array", size, &found);
-	XidSlots = (GlobalXid *) ((char*)g_xgi + MAXALIGN(sizeof(XidGlobalInfo)));
+	XidPartitions = (XidSlotPartitionPadded *) ((char*)g_xgi + MAXALIGN(sizeof(XidGlobalInfo)));
+	XidSlots = (GlobalXid *) (XidPartitions + XIDSENDER_NPARTITIONS);
+
+	/* every xidsender must own at least one slot partition */
+	StaticAssertStmt(MAX_XID_SENDERS <= XIDSENDER_NPARTITIONS,
+					 "too many xidsenders");
 
 	if (!found)
 	{
@@ -1281,6 +1581,17 @@ CreateSharedBackendXidSlots(void)
 		 */
 		MemSet(g_xgi, 0, size);
 		g_xgi->max_trxid = InvalidTransactionId;
+		for (int i = 0; i < MAX_XID_SENDERS; i++)
+		{
+			g_xgi->senders[i].group_size = cluster_commitlog_group_size;
+			pg_atomic_init_u32(&g_xgi->senders[i].num_pending, 0);
+		}
+		SpinLockInit(&g_xgi->stats_mutex);
+		for (int i = 0; i < XIDSENDER_NPARTITIONS; i++)
+		{
+			SpinLockInit(&XidPartitions[i].part.mutex);
+			pg_atomic_init_u64(&XidPartitions[i].part.done_gen, 0);
+		}
 	}
 }
 
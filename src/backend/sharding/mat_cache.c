@@ -1,5 +1,6 @@
 #include "postgres.h"
 
+#include "miscadmin.h"
 #include "utils/palloc.h"
 #include "utils/memutils.h"
 #include "sharding/mat_cache.h"
@@ -7,109 +8,182 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+static void matcache_flush_tail(MatCache *cache);
+
 MatCache *matcache_create()
 {
-    MemoryContext mem_ctx = MemoryContextSwitchTo(TopMemoryContext);
-    MatCache *cache = (MatCache *)palloc0(sizeof(MatCache));
-    cache->file = BufFileCreateTemp(true);
-    cache->mode = WRITE_MODE;
-    MemoryContextSwitchTo(mem_ctx);
+    MatCache *cache = (MatCache *)MemoryContextAllocZero(TopMemoryContext, sizeof(MatCache));
+    cache->mem_limit = work_mem * 1024L;
+    cache->file_pos = -1;
 
     return cache;
 }
 
 void matcache_close(MatCache *cache)
 {
-    BufFileClose(cache->file);
+    if (cache->file)
+        BufFileClose(cache->file);
+    if (cache->mem)
+        pfree(cache->mem);
+    if (cache->tail)
+        pfree(cache->tail);
     pfree(cache);
 }
 
+/*
+  Drop all bytes in the cache. The memory and the temp file are kept to be
+  reused.
+*/
 void matcache_reset(MatCache *cache)
 {
-    memset(&cache->read_pos, 0, sizeof(MatCachePos));
-    memset(&cache->write_pos, 0, sizeof(MatCachePos));
-    BufFileSeek(cache->file, 0, 0, SEEK_SET);
+    cache->read_pos.offset = 0;
+    cache->write_pos.offset = 0;
+    cache->mem_len = 0;
+    cache->file_len = 0;
+    cache->tail_len = 0;
 }
 
 bool matcache_eof(MatCache *cache)
 {
-    if (cache->mode == READ_MODE)
-        BufFileTell(cache->file, &cache->read_pos.fileno, &cache->read_pos.offset);
-    else
-        BufFileTell(cache->file, &cache->write_pos.fileno, &cache->write_pos.offset);
-
-    return memcmp(&cache->read_pos, &cache->write_pos, sizeof(MatCachePos)) == 0;
+    return cache->read_pos.offset == cache->write_pos.offset;
 }
 
-void matcache_write(MatCache *cache, uchar *data, size_t len)
+/*
+  Write the tail to the end of the temp file.
+*/
+static void matcache_flush_tail(MatCache *cache)
 {
-    MemoryContext mem_ctx = MemoryContextSwitchTo(TopMemoryContext);
+    if (cache->tail_len == 0)
+        return;
 
-    if (cache->mode == READ_MODE)
+    if (!cache->file)
     {
-        /* Save the read pos */
-        BufFileTell(cache->file, &cache->read_pos.fileno, &cache->read_pos.offset);
-
-        BufFileSeek(cache->file, cache->write_pos.fileno, cache->write_pos.offset, SEEK_SET);
-
-        cache->mode = WRITE_MODE;
+        MemoryContext mem_ctx = MemoryContextSwitchTo(TopMemoryContext);
+        cache->file = BufFileCreateTemp(true);
+        MemoryContextSwitchTo(mem_ctx);
+        cache->file_pos = 0;
     }
 
-    BufFileWrite(cache->file, data, len);
+    if (cache->file_pos != cache->file_len &&
+        BufFileSeek(cache->file, 0, cache->file_len, SEEK_SET) != 0)
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("Kunlun-db: could not seek in materialization cache temp file: %m")));
 
-    MemoryContextSwitchTo(mem_ctx);
+    if (BufFileWrite(cache->file, cache->tail, cache->tail_len) != cache->tail_len)
+        ereport(ERROR,
+                (errcode_for_file_access(),
+                 errmsg("Kunlun-db: could not write to materialization cache temp file: %m")));
+
+    cache->file_len += cache->tail_len;
+    cache->file_pos = cache->file_len;
+    cache->tail_len = 0;
 }
 
-size_t matcache_read(MatCache *cache, uchar *buff, size_t len)
+void matcache_write(MatCache *cache, uchar *data, size_t len)
 {
-    MemoryContext mem_ctx = MemoryContextSwitchTo(TopMemoryContext);
+    cache->write_pos.offset += len;
 
-    if (cache->mode == WRITE_MODE)
+    /* Keep it in memory if nothing is spilled yet and it fits. */
+    if (cache->file_len == 0 && cache->tail_len == 0 &&
+        cache->mem_len + len <= cache->mem_limit)
     {
-        /* Save the write pos */
-        BufFileTell(cache->file, &cache->write_pos.fileno, &cache->write_pos.offset);
+        if (cache->mem_len + len > cache->mem_size)
+        {
+            size_t newsize = Max(cache->mem_size, BUFF_SIZE);
+
+            while (newsize < cache->mem_len + len)
+                newsize *= 2;
+            newsize = Min(newsize, cache->mem_limit);
+
+            if (cache->mem)
+                cache->mem = repalloc(cache->mem, newsize);
+            else
+                cache->mem = MemoryContextAlloc(TopMemoryContext, newsize);
+            cache->mem_size = newsize;
+        }
+        memcpy(cache->mem + cache->mem_len, data, len);
+        cache->mem_len += len;
+        return;
+    }
 
-        /* Switch to read mode, and set the proper read pos */
-        BufFileSeek(cache->file, cache->read_pos.fileno, cache->read_pos.offset, SEEK_SET);
+    if (!cache->tail)
+        cache->tail = MemoryContextAlloc(TopMemoryContext, MATCACHE_TAIL_SIZE);
 
-        cache->mode = READ_MODE;
+    while (len > 0)
+    {
+        size_t n = Min(len, MATCACHE_TAIL_SIZE - cache->tail_len);
+
+        memcpy(cache->tail + cache->tail_len, data, n);
+        cache->tail_len += n;
+        data += n;
+        len -= n;
+        if (cache->tail_len == MATCACHE_TAIL_SIZE)
+            matcache_flush_tail(cache);
     }
+}
 
-    size_t size = BufFileRead(cache->file, buff, len);
+size_t matcache_read(MatCache *cache, uchar *buff, size_t len)
+{
+    size_t done = 0;
+    off_t mem_end = cache->mem_len;
+    off_t file_end = mem_end + cache->file_len;
 
-    MemoryContextSwitchTo(mem_ctx);
+    len = Min(len, cache->write_pos.offset - cache->read_pos.offset);
 
-    return size;
+    while (done < len)
+    {
+        off_t off = cache->read_pos.offset;
+        size_t n;
+
+        if (off < mem_end)
+        {
+            n = Min(len - done, mem_end - off);
+            memcpy(buff + done, cache->mem + off, n);
+        }
+        else if (off < file_end)
+        {
+            off -= mem_end;
+            if (cache->file_pos != off &&
+                BufFileSeek(cache->file, 0, off, SEEK_SET) != 0)
+                ereport(ERROR,
+                        (errcode_for_file_access(),
+                         errmsg("Kunlun-db: could not seek in materialization cache temp file: %m")));
+
+            n = BufFileRead(cache->file, buff + done,
+                            Min(len - done, cache->file_len - off));
+            if (n == 0)
+                ereport(ERROR,
+                        (errcode_for_file_access(),
+                         errmsg("Kunlun-db: could not read from materialization cache temp file: %m")));
+            cache->file_pos = off + n;
+        }
+        else
+        {
+            off -= file_end;
+            n = Min(len - done, cache->tail_len - off);
+            memcpy(buff + done, cache->tail + off, n);
+        }
+
+        done += n;
+        cache->read_pos.offset += n;
+    }
+
+    return done;
 }
 
 void matcache_get_read_pos(MatCache *cache, MatCachePos *pos)
 {
-    if (cache->mode == WRITE_MODE)
-        *pos = cache->read_pos;
-    else
-        BufFileTell(cache->file, &pos->fileno, &pos->offset);
+    *pos = cache->read_pos;
 }
 
 void matcache_get_write_pos(MatCache *cache, MatCachePos *pos)
 {
-    if (cache->mode == READ_MODE)
-        *pos = cache->write_pos;
-    else
-        BufFileTell(cache->file, &pos->fileno, &pos->offset);
+    *pos = cache->write_pos;
 }
 
 void matcache_set_read_pos(MatCache *cache, MatCachePos pos)
 {
-    if (cache->mode == WRITE_MODE)
-        cache->read_pos = pos;
-    else
-        BufFileSeek(cache->file, pos.fileno, pos.offset, SEEK_SET);
-}
-
-void matcache_set_write_pos(MatCache *cache, MatCachePos pos)
-{
-    if (cache->mode == READ_MODE)
-        cache->write_pos = pos;
-    else
-        BufFileSeek(cache->file, pos.fileno, pos.offset, SEEK_SET);
+    Assert(pos.offset >= 0 && pos.offset <= cache->write_pos.offset);
+    cache->read_pos = pos;
 }
@@ -22,12 +22,23 @@
 #include "sharding/sharding.h"
 #include "sharding/mysql_vars.h"
 #include "sharding/mat_cache.h"
+#include "access/hash.h"
 #include "access/parallel.h"
 #include "access/remote_meta.h"
 #include "access/remotetup.h"
 #include "access/remote_xact.h"
+#include "access/xact.h"
+#include "catalog/pg_type.h"
+#include "funcapi.h"
+#include "lib/ilist.h"
+#include "nodes/print.h"
+#include "pgtime.h"
 #include "utils/algos.h"
 #include "utils/builtins.h"
+#include "utils/date.h"
+#include "utils/datetime.h"
+#include "utils/timestamp.h"
+#include "utils/tuplestore.h"
 #include "utils/memutils.h"
 #include "utils/hsearch.h"
 #include "utils/lsyscache.h"
@@ -39,6 +50,7 @@
 #include "miscadmin.h"
 #include "utils/timeout.h"
 #include "storage/ipc.h"
+#include "storage/latch.h"
 #include "tcop/tcopprot.h"
 
 #include <arpa/inet.h>
@@ -46,6 +58,9 @@
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <poll.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
 #include <sys/socket.h>
 #include <unistd.h>
 
@@ -78,8 +93,151 @@ int mysql_read_timeout = 10;
 int mysql_write_timeout = 10;
 int mysql_max_packet_size = 16384;
 bool mysql_transmit_compress = false;
+bool mysql_binary_protocol = false;
+/*
+ * If true, stmts queued for a storage node connection are sent together with
+ * the one ahead of them in one multi-statement packet.
+ */
+bool mysql_coalesce_stmts = false;
+/*
+ * Max NO. of prepared stmts cached for each storage node connection, 0
+ * disables the cache.
+ */
+int mysql_prepared_stmt_cache_size = 0;
+/*
+ * If > 0, binary protocol SELECTs open a server side cursor and fetch this
+ * many rows per COM_STMT_FETCH, see stmt_parkable().
+ */
+int mysql_cursor_fetch_rows = 0;
+/*
+ * If true, read only txns read remote tables from shard replicas chosen by
+ * pg_shard_node.ro_weight, see GetAsyncStmtInfoForRead().
+ */
+bool mysql_replica_read = false;
+/*
+ * Replicas whose pg_shard_node.latency exceeds this are not read from, -1
+ * means no limit.
+ */
+int mysql_replica_max_latency = -1;
+/*
+ * If > 0, a session idle out of txn for this many seconds closes all its
+ * storage node connections, see ReleaseIdleShardConns().
+ */
+int mysql_conn_idle_timeout = 300;
+volatile bool ShardConnIdleTimeoutPending = false;
 static int32_t handle_epoch = 0;
 
+#ifdef HAVE_SYS_EPOLL_H
+/*
+ * Storage node sockets are registered edge triggered to shard_epoll_fd once
+ * per connection, and the edges epoll reports are accumulated in their
+ * ShardSockState until consumed by the stmt waiting on the socket, so a wait
+ * costs the same no matter how many shards a stmt is sent to. The epoll fd
+ * is waited for together with the process latch in shard_wait_set, see
+ * poll_remote_events_any().
+ */
+typedef struct ShardSockState
+{
+	bool registered;
+	int ready;			/* MYSQL_WAIT_* flags not consumed yet */
+} ShardSockState;
+
+#define SHARD_EPOLL_EVENTS 64
+
+static int shard_epoll_fd = -1;
+static WaitEventSet *shard_wait_set = NULL;
+static int shard_wait_latch_pos = -1;
+/* Indexed by socket fd */
+static ShardSockState *shard_socks = NULL;
+static int num_shard_socks = 0;
+#endif
+
+/*
+ * A stmt prepared through a storage node connection, keyed by its text.
+ */
+typedef struct PreparedStmtEntry
+{
+	dlist_node lru_node;	/* position in PreparedStmtCache.lru */
+	uint32 hash;
+	char *sql;
+	size_t sql_len;
+	MYSQL_STMT *stmt;
+	StmtHandle *user;	/* the stmt handle executing it, if any */
+} PreparedStmtEntry;
+
+/*
+ * Prepared stmts of one storage node connection, the most recently used one
+ * is at head of 'lru'.
+ */
+struct PreparedStmtCache
+{
+	dlist_head lru;
+	int nentries;
+
+	uint64 hits;
+	uint64 misses;
+	uint64 evictions;		/* dropped to make room for new stmts */
+	uint64 invalidations;	/* dropped because of DDL or connection reset */
+};
+
+/*
+ * Phases a binary protocol stmt goes through, each phase is one async mysql
+ * client call which may need several _start/_cont steps to complete.
+ */
+typedef enum BinaryStmtPhase
+{
+	BSP_PRE_QUERY,		/* send txn start stmts ahead of the prepared stmt */
+	BSP_PRE_NEXT_RESULT,	/* drain results of the txn start stmts */
+	BSP_PREPARE,
+	BSP_EXECUTE,
+	BSP_FETCH
+} BinaryStmtPhase;
+
+/*
+ * State of a stmt executed through the binary protocol. Result fields are
+ * bound to per-column buffers, fixed-width values are bound in their native
+ * form, all others as strings.
+ */
+struct StmtBinaryResult
+{
+	MYSQL_STMT *stmt;
+	BinaryStmtPhase phase;
+	bool started;		/* the async call of current phase was started */
+	int ret;			/* return value of the last finished async call */
+
+	/* XA START etc. which must be sent as plain text ahead of the stmt */
+	char *pre_stmt;
+	size_t pre_stmt_len;
+
+	MYSQL_BIND *binds;
+	enum enum_field_types *bind_types;
+	my_bool *nulls;
+	my_bool *errors;
+	unsigned long *lens;
+	size_t *caps;		/* capacity of binds[i].buffer */
+
+	/* The current row, exposed through StmtHandle.row and StmtHandle.lengths */
+	char **row;
+	size_t *lengths;
+
+	/* Params bound to the '?' placeholders of the stmt */
+	MYSQL_BIND *params;
+	int nparams;
+
+	bool cacheable;		/* keep the prepared stmt in the connection's cache */
+	bool prepared;		/* 'stmt' comes from the cache, no need to PREPARE */
+	PreparedStmtEntry *centry;	/* the cache entry 'stmt' belongs to */
+
+	/*
+	 * Rows are fetched through a read only server side cursor,
+	 * mysql_cursor_fetch_rows rows per COM_STMT_FETCH.
+	 */
+	bool cursor;
+};
+
+/* Initial buffer size for a string field, grown on demand */
+#define BINARY_STR_FIELD_INIT_SIZE 256
+
 static void ResetASI(AsyncStmtInfo *asi);
 static bool async_connect(MYSQL *mysql, const char *host, uint16_t port, const char *user, const char *password);
 static ShardConnection *GetConnShard(Oid shardid);
@@ -95,11 +253,36 @@ static void check_mysql_node_status(AsyncStmtInfo *asi, bool want_master);
 
 static void work_on_stmt(AsyncStmtInfo *asi, StmtHandle *handle);
 static bool send_stmt_impl(AsyncStmtInfo *asi, StmtHandle *handle);
+static int count_sql_stmts(const char *sql, size_t len, size_t *plen);
+static void coalesce_queued_stmts(AsyncStmtInfo *asi, StmtHandle *leader);
+static void next_stmt_result(AsyncStmtInfo *asi, StmtHandle *handle);
 static bool recv_stmt_result_impl(AsyncStmtInfo *asi, StmtHandle *handle);
+static StmtSafeHandle send_stmt_async_impl(AsyncStmtInfo *asi, char *stmt, size_t stmt_len,
+	CmdType cmd, bool owns_stmt_mem, enum enum_sql_command sqlcom, bool materialize, bool binary,
+	List *params, bool urge);
+static void queue_stmt_async(AsyncStmtInfo *asi, char *stmt, size_t stmt_len,
+	CmdType cmd, bool owns_stmt_mem, enum enum_sql_command sqlcom);
+static void bind_stmt_params(StmtBinaryResult *bin, List *params);
+static PreparedStmtCache *GetConnStmtCache(AsyncStmtInfo *asi);
+static void invalidate_stmt_cache(PreparedStmtCache *cache);
+static void stmt_cache_drop(PreparedStmtCache *cache, PreparedStmtEntry *entry);
+static void stmt_cache_checkout(AsyncStmtInfo *asi, StmtHandle *handle);
+static void stmt_cache_checkin(AsyncStmtInfo *asi, StmtHandle *handle);
+static void binary_stmt_bind(AsyncStmtInfo *asi, StmtHandle *handle);
+static bool recv_binary_stmt_result_impl(AsyncStmtInfo *asi, StmtHandle *handle);
+static void free_binary_stmt_result(StmtHandle *handle);
 static bool fetch_stmt_remote_next(AsyncStmtInfo *asi, StmtHandle *handle);
 static bool handle_stmt_remote_result(AsyncStmtInfo *asi, StmtHandle *handle);
 static StmtHandle* poll_remote_events_any(StmtHandle *handles[], int count, int timeout_ms);
+#ifdef HAVE_SYS_EPOLL_H
+static ShardSockState *get_shard_sock(int fd);
+static void forget_shard_sock(int fd);
+static void init_shard_wait_set(void);
+static void register_shard_sock(int fd, ShardSockState *state);
+static void harvest_shard_sock_events(void);
+#endif
 static bool process_preceding_stmts(AsyncStmtInfo *asi, StmtHandle *cur);
+static void close_parked_stmts(AsyncStmtInfo *asi, bool canceled_only);
 static void flush_invalid_stmts(AsyncStmtInfo *asi);
 static void flush_all_stmts_impl(AsyncStmtInfo **asi, int count, bool cancel);
 static void cancel_all_stmts_impl(AsyncStmtInfo *asi[], int cnt);
@@ -273,7 +456,8 @@ remote_conn_subxact_cb(SubXactEvent event, SubTransactionId mySubid,
 					handle = (StmtHandle *)lfirst(lc);
 					/* For currently running stmt, make sure its refcount bigger than zero */
 					if (handle->subxactid == mySubid &&
-					    (pasi->curr_stmt != handle || handle->refcount > 1))
+					    ((pasi->curr_stmt != handle && !handle->parked) ||
+					     handle->refcount > 1))
 						break;
 					handle = NULL;
 				}
@@ -412,7 +596,7 @@ make_conn:
 		char *setvar_stmt = produce_set_var_stmts(&setvar_stmtlen);
 		if (setvar_stmt && setvar_stmtlen > 0)
 		{
-			send_stmt_async_nowarn(asi, setvar_stmt, setvar_stmtlen, CMD_UTILITY, true, SQLCOM_SET_OPTION);
+			queue_stmt_async(asi, setvar_stmt, setvar_stmtlen, CMD_UTILITY, true, SQLCOM_SET_OPTION);
 		}
 
 		char cmdbuf[256];
@@ -426,9 +610,12 @@ make_conn:
 					  "SET NAMES 'utf8'; set session autocommit = true ");
 		Assert(cmdlen < sizeof(cmdbuf));
 
-		send_stmt_async_nowarn(asi, cmdbuf, cmdlen, CMD_UTILITY, false, SQLCOM_SET_OPTION);
+		queue_stmt_async(asi, cmdbuf, cmdlen, CMD_UTILITY, false, SQLCOM_SET_OPTION);
 
-		// must append this last in one packet of sql stmts.
+		/*
+		  Sending the stmt below or flushing the queue sends all of them
+		  in one packet of sql stmts, the node check must come last.
+		*/
 		if (want_master)
 		{
 			check_mysql_node_status(asi, want_master);
@@ -453,6 +640,123 @@ make_conn:
 	return asi;
 }
 
+/*
+ * Replica nodes we failed to connect to recently, they are not tried again
+ * until retry_at so that every read doesn't wait for the connect timeout of
+ * a dead replica.
+ */
+#define MAX_FAILED_REPLICAS 32
+#define REPLICA_RETRY_DELAY_MS 30000
+typedef struct FailedReplica
+{
+	Oid nodeid;
+	TimestampTz retry_at;
+} FailedReplica;
+
+static FailedReplica failed_replicas[MAX_FAILED_REPLICAS];
+
+static bool replica_failed_recently(Oid nodeid, TimestampTz now)
+{
+	for (int i = 0; i < MAX_FAILED_REPLICAS; i++)
+		if (failed_replicas[i].nodeid == nodeid)
+			return failed_replicas[i].retry_at > now;
+	return false;
+}
+
+static void mark_replica_failed(Oid nodeid, TimestampTz now)
+{
+	int slot = 0;
+
+	for (int i = 0; i < MAX_FAILED_REPLICAS; i++)
+	{
+		if (failed_replicas[i].nodeid == nodeid)
+		{
+			slot = i;
+			break;
+		}
+		// reuse the entry which expires earliest.
+		if (failed_replicas[i].retry_at < failed_replicas[slot].retry_at)
+			slot = i;
+	}
+
+	failed_replicas[slot].nodeid = nodeid;
+	failed_replicas[slot].retry_at =
+		TimestampTzPlusMilliseconds(now, REPLICA_RETRY_DELAY_MS);
+}
+
+/*
+  Get communication port to read from shard 'shardid'. If mysql_replica_read
+  is on and current txn is read only, it's a replica of the shard, chosen by
+  ro_weight, otherwise or if no replica is usable, it's the shard's master.
+  A txn always reads a shard from the same node, so a read only txn still
+  sees one snapshot of each shard.
+*/
+AsyncStmtInfo *GetAsyncStmtInfoForRead(Oid shardid)
+{
+	if (!mysql_replica_read || !XactReadOnly || IsParallelWorker())
+		return GetAsyncStmtInfo(shardid);
+
+	List *replicas = NIL;
+	ListCell *lc;
+	AsyncStmtInfo *asi = NULL;
+	TimestampTz now = GetCurrentTimestamp();
+
+	/* Keep reading from the node this txn already reads the shard from. */
+	for (int i = 0; i < cur_session.num_asis_used; i++)
+	{
+		AsyncStmtInfo *pasi = cur_session.asis + i;
+		if (pasi->shard_id == shardid && pasi->conn && IsConnValid(pasi))
+			return pasi;
+	}
+
+	replicas = GetShardReplicaNodeIds(shardid, mysql_replica_max_latency);
+
+	foreach(lc, replicas)
+	{
+		Oid nodeid = lfirst_oid(lc);
+		int num_used = cur_session.num_asis_used;
+
+		if (replica_failed_recently(nodeid, now))
+			continue;
+
+		PG_TRY();
+		{
+			asi = GetAsyncStmtInfoNode(shardid, nodeid, false);
+		}
+		PG_CATCH();
+		{
+			asi = NULL;
+			/*
+			  A replica being down must not fail the read, we downgrade the
+			  error to warning and go on with the next node.
+			*/
+			HOLD_INTERRUPTS();
+			downgrade_error();
+			errfinish(0);
+			FlushErrorState();
+			RESUME_INTERRUPTS();
+		}
+		PG_END_TRY();
+
+		if (asi)
+			break;
+
+		mark_replica_failed(nodeid, now);
+		/* Drop the half made port so it's never returned for the shard. */
+		while (cur_session.num_asis_used > num_used)
+		{
+			AsyncStmtInfo *pasi = cur_session.asis + (--cur_session.num_asis_used);
+			ResetASI(pasi);
+			pasi->shard_id = InvalidOid;
+			pasi->node_id = InvalidOid;
+		}
+	}
+
+	list_free(replicas);
+
+	return asi ? asi : GetAsyncStmtInfo(shardid);
+}
+
 /*
  * Reset asi at end(or start) of a stmt.
  * */
@@ -594,6 +898,7 @@ static int AllocShardConnNodeSlot(ShardConnection *sconn, Oid nodeid, int *newco
 		memmove(ids + inspos + 1, ids + inspos, (sconn->num_nodes - inspos) * sizeof(Oid));
 		memmove(sconn->conns + inspos + 1, sconn->conns + inspos, (sconn->num_nodes - inspos) * sizeof(void *));
 		memmove(sconn->conn_flags + inspos + 1, sconn->conn_flags + inspos, (sconn->num_nodes - inspos) * sizeof(char));
+		memmove(sconn->stmt_caches + inspos + 1, sconn->stmt_caches + inspos, (sconn->num_nodes - inspos) * sizeof(void *));
 	}
 
 	if (inspos < 0) // allocing&inserting 1st element.
@@ -609,6 +914,7 @@ static int AllocShardConnNodeSlot(ShardConnection *sconn, Oid nodeid, int *newco
 
 	sconn->conns[inspos] = mysql_conn;
 	sconn->conn_flags[inspos] = 0;
+	sconn->stmt_caches[inspos] = NULL;
 make_conn:
 	found_shard_node = FindCachedShardNode(sconn->shard_id, nodeid, &snode);
 
@@ -648,6 +954,9 @@ static bool MarkConnFlag(AsyncStmtInfo *asi, int flagbit, bool b)
 	int pos = bin_search(&nodeid, ids, sconn->num_nodes, sizeof(nodeid), oid_cmp, &inspos);
 	if (pos < 0)
 		return false;
+	/* Stmts prepared through a closed or reset connection are gone */
+	if ((flagbit == CONN_VALID && !b) || (flagbit == CONN_RESET && b))
+		invalidate_stmt_cache(sconn->stmt_caches[pos]);
 	if (b)
 		sconn->conn_flags[pos] |= flagbit;
 	else
@@ -884,6 +1193,14 @@ static bool async_connect(MYSQL *mysql, const char *host, uint16_t port, const c
 		return false;
 	}
 
+#ifdef HAVE_SYS_EPOLL_H
+	/*
+	  The socket fd may have been used by a closed connection, which epoll
+	  removed from its interest list when it was closed.
+	*/
+	forget_shard_sock(mysql_get_socket(mysql));
+#endif
+
 	elog(LOG, "Connected to mysql instance at %s:%u", host, port);
 	return true;
 }
@@ -946,6 +1263,39 @@ int set_stmt_ignored_error(int eno)
 StmtSafeHandle
 send_stmt_async(AsyncStmtInfo *asi, char *stmt, size_t stmt_len,
 		CmdType cmd, bool owns_stmt_mem, enum enum_sql_command sqlcom, bool materialize)
+{
+	return send_stmt_async_impl(asi, stmt, stmt_len, cmd, owns_stmt_mem,
+				    sqlcom, materialize, false, NIL, true);
+}
+
+/**
+ * Same as send_stmt_async(), but 'stmt' is a SELECT stmt to be executed
+ * through the binary protocol.
+ */
+StmtSafeHandle
+send_stmt_async_binary(AsyncStmtInfo *asi, char *stmt, size_t stmt_len,
+		       bool owns_stmt_mem, bool materialize)
+{
+	return send_stmt_async_impl(asi, stmt, stmt_len, CMD_SELECT, owns_stmt_mem,
+				    SQLCOM_SELECT, materialize, true, NIL, true);
+}
+
+/**
+ * Same as send_stmt_async_binary(), but 'stmt' is a template whose '?'
+ * placeholders are bound to 'params', see RemoteParamValue.
+ */
+StmtSafeHandle
+send_stmt_async_prepared(AsyncStmtInfo *asi, char *stmt, size_t stmt_len,
+			 bool owns_stmt_mem, bool materialize, List *params)
+{
+	return send_stmt_async_impl(asi, stmt, stmt_len, CMD_SELECT, owns_stmt_mem,
+				    SQLCOM_SELECT, materialize, true, params, true);
+}
+
+static StmtSafeHandle
+send_stmt_async_impl(AsyncStmtInfo *asi, char *stmt, size_t stmt_len,
+		CmdType cmd, bool owns_stmt_mem, enum enum_sql_command sqlcom,
+		bool materialize, bool binary, List *params, bool urge)
 {
 	/*
 	  If the shard node isn't connected, don't append stmt to it. This could happen
@@ -992,6 +1342,14 @@ send_stmt_async(AsyncStmtInfo *asi, char *stmt, size_t stmt_len,
 	handle->ignore_errno = stmt_ignored_eno;
 	handle->is_dml_write =
 	    (cmd == CMD_INSERT || cmd == CMD_DELETE || cmd == CMD_UPDATE);
+	handle->binary = binary;
+	if (binary)
+	{
+		handle->bin = (StmtBinaryResult *)palloc0(sizeof(StmtBinaryResult));
+		handle->bin->cacheable = (mysql_prepared_stmt_cache_size > 0);
+		handle->bin->cursor = (mysql_cursor_fetch_rows > 0);
+		bind_stmt_params(handle->bin, params);
+	}
 	asi->stmt_queue = lappend(asi->stmt_queue, handle);
 	asi->stmt_inuse = lappend(asi->stmt_inuse, handle);
 
@@ -1003,9 +1361,10 @@ send_stmt_async(AsyncStmtInfo *asi, char *stmt, size_t stmt_len,
 	 *  (2) The running statement does not return a tuple, which avoids expensive materialization.
 	 *  (3) Too many pending statements
 	 */
-	if (asi->curr_stmt == NULL ||
-	    asi->curr_stmt->cmd != CMD_SELECT ||
-	    list_length(asi->stmt_queue) > 10)
+	if (urge &&
+	    (asi->curr_stmt == NULL ||
+	     asi->curr_stmt->cmd != CMD_SELECT ||
+	     list_length(asi->stmt_queue) > 10))
 	{
 		process_preceding_stmts(asi, NULL);
 	}
@@ -1013,6 +1372,20 @@ send_stmt_async(AsyncStmtInfo *asi, char *stmt, size_t stmt_len,
 	return SAFE_HANDLE(handle);
 }
 
+/**
+ * Append 'stmt' into asi's job queue without sending anything, so that it
+ * goes out in the same packet as the stmts queued after it, see
+ * coalesce_queued_stmts(). Its result is not checked.
+ */
+static void
+queue_stmt_async(AsyncStmtInfo *asi, char *stmt, size_t stmt_len,
+		 CmdType cmd, bool owns_stmt_mem, enum enum_sql_command sqlcom)
+{
+	StmtSafeHandle handle = send_stmt_async_impl(asi, stmt, stmt_len, cmd,
+		owns_stmt_mem, sqlcom, false, false, NIL, false);
+	release_stmt_handle(handle);
+}
+
 /**
  * @brief Before sending the statement, update the inner status of asi, and add extra info to the handle
  */
@@ -1031,12 +1404,23 @@ work_on_stmt(AsyncStmtInfo *asi, StmtHandle *handle)
 	 *
 	 * In a txn the 1st stmt might be a subtxn and it might fail and be aborted,
 	 * and in this case we should avoid generating&sending another XA START stmt.
+	 *
+	 * A parallel worker only sends read only stmts of queries out of txn
+	 * blocks which wrote no shards(see ExecParallelRemoteScanAllowed()), and
+	 * it can't join the leader's XA txns nor assign an XID to name its own,
+	 * so its stmts are autocommit.
+	 *
+	 * Replication status queries(SQLCOM_SHOW_SLAVE_STAT), e.g. the primary
+	 * watch of the topo service, read no transactional data, so they
+	 * neither start the txn nor count as reading the shard.
 	 * */
 
 	if (!asi->did_write &&
 	    !asi->did_read &&
+	    !IsParallelWorker() &&
 	    handle->cmd != CMD_DDL &&
 	    handle->sqlcom != SQLCOM_SET_OPTION &&
+	    handle->sqlcom != SQLCOM_SHOW_SLAVE_STAT &&
 	    IsTransactionState())
 	{
 		/*
@@ -1057,13 +1441,25 @@ work_on_stmt(AsyncStmtInfo *asi, StmtHandle *handle)
 
 			initStringInfo2(&txnstart, tslen, TopTransactionContext);
 			StartTxnRemote(&txnstart);
-			appendStringInfoChar(&txnstart, ';');
-			appendBinaryStringInfo(&txnstart, handle->stmt, handle->stmt_len);
-			if (handle->owns_stmt_mem)
-				pfree(handle->stmt);
-			handle->stmt_len = lengthStringInfo(&txnstart);
-			handle->stmt = donateStringInfo(&txnstart);
-			handle->owns_stmt_mem = true;
+			if (handle->binary)
+			{
+				/*
+				  A prepared stmt can't be a multi-statement, the txn start
+				  stmts are sent ahead of it in text.
+				*/
+				handle->bin->pre_stmt_len = lengthStringInfo(&txnstart);
+				handle->bin->pre_stmt = donateStringInfo(&txnstart);
+			}
+			else
+			{
+				appendStringInfoChar(&txnstart, ';');
+				appendBinaryStringInfo(&txnstart, handle->stmt, handle->stmt_len);
+				if (handle->owns_stmt_mem)
+					pfree(handle->stmt);
+				handle->stmt_len = lengthStringInfo(&txnstart);
+				handle->stmt = donateStringInfo(&txnstart);
+				handle->owns_stmt_mem = true;
+			}
 			asi->txn_in_progress = true;
 		}
 	}
@@ -1073,11 +1469,198 @@ work_on_stmt(AsyncStmtInfo *asi, StmtHandle *handle)
 		asi->did_write = (cmd == CMD_INSERT || cmd == CMD_UPDATE || cmd == CMD_DELETE);
 	if (!asi->did_ddl)
 		asi->did_ddl = (cmd == CMD_DDL);
-	if (!asi->did_read)
+	/*
+	  Stmts prepared before a DDL may refer to altered or dropped objects,
+	  drop them instead of having the storage node reprepare them.
+	*/
+	if (cmd == CMD_DDL)
+		invalidate_stmt_cache(GetConnStmtCache(asi));
+	if (!asi->did_read && handle->sqlcom != SQLCOM_SHOW_SLAVE_STAT)
 		asi->did_read = (cmd == CMD_SELECT || cmd == CMD_UTILITY);
 	asi->executed_stmts++;
 }
 
+/**
+ * @brief Count the sql stmts in 'sql' as the storage node would split it at
+ *  ';', skipping quoted strings, quoted identifiers and comments.
+ *
+ * @param plen	Set to the length of 'sql' without the trailing ';', spaces
+ * 		and comments.
+ * @return the NO. of stmts, or -1 if 'sql' has an empty stmt in the middle,
+ * 	an unterminated quote or comment, or no stmt at all.
+ */
+static int
+count_sql_stmts(const char *sql, size_t len, size_t *plen)
+{
+	int nstmts = 0;
+	bool has_content = false;
+	size_t end = 0;
+	size_t i = 0;
+
+	while (i < len)
+	{
+		char c = sql[i];
+
+		if (c == '\'' || c == '"' || c == '`')
+		{
+			/* Backslash escapes only apply in strings, '' and "" are escapes too */
+			for (++i; i < len && sql[i] != c; ++i)
+			{
+				if (sql[i] == '\\' && c != '`')
+					++i;
+			}
+			if (i >= len)
+				return -1;
+			has_content = true;
+			end = ++i;
+		}
+		else if (c == '#' ||
+			 (c == '-' && i + 1 < len && sql[i + 1] == '-' &&
+			  (i + 2 == len || isspace((unsigned char)sql[i + 2]))))
+		{
+			while (i < len && sql[i] != '\n')
+				++i;
+		}
+		else if (c == '/' && i + 1 < len && sql[i + 1] == '*')
+		{
+			/* Comments starting with ! or + are executed by the storage node */
+			bool executed = (i + 2 < len && (sql[i + 2] == '!' || sql[i + 2] == '+'));
+
+			for (i += 2; i + 1 < len && !(sql[i] == '*' && sql[i + 1] == '/'); ++i)
+				;
+			if (i + 1 >= len)
+				return -1;
+			i += 2;
+			if (executed)
+			{
+				has_content = true;
+				end = i;
+			}
+		}
+		else if (c == ';')
+		{
+			if (!has_content)
+				return -1;
+			nstmts++;
+			has_content = false;
+			++i;
+		}
+		else
+		{
+			if (!isspace((unsigned char)c))
+			{
+				has_content = true;
+				end = i + 1;
+			}
+			++i;
+		}
+	}
+
+	if (has_content)
+		nstmts++;
+	*plen = end;
+	return nstmts > 0 ? nstmts : -1;
+}
+
+/**
+ * @brief Append the text of the stmts queued after 'leader' to its own text,
+ *  so that they are all sent in one multi-statement packet. Each of them
+ *  takes its own results in turn, see next_stmt_result().
+ *
+ *  DDL and binary protocol stmts are never coalesced, and a stmt ignoring an
+ *  error ends the packet since the storage node stops executing the rest of
+ *  a multi-statement packet at the first error.
+ */
+static void
+coalesce_queued_stmts(AsyncStmtInfo *asi, StmtHandle *leader)
+{
+	StringInfoData buf;
+	StmtHandle *last = NULL;
+	size_t len;
+	int nstmts;
+	ListCell *lc;
+
+	if (!mysql_coalesce_stmts || leader->cmd == CMD_DDL ||
+	    leader->ignore_errno != 0 || list_length(asi->stmt_queue) == 0)
+		return;
+
+	if ((nstmts = count_sql_stmts(leader->stmt, leader->stmt_len, &len)) < 0)
+		return;
+
+	foreach (lc, asi->stmt_queue)
+	{
+		StmtHandle *handle = (StmtHandle *)lfirst(lc);
+		size_t hlen;
+		int n;
+
+		if (handle->binary || handle->cancel || handle->cmd == CMD_DDL ||
+		    (last && last->ignore_errno != 0))
+			break;
+
+		/* Leave room for the txn start stmts */
+		if ((last ? buf.len : len) + handle->stmt_len + 512 > mysql_max_packet_size ||
+		    count_sql_stmts(handle->stmt, handle->stmt_len, &hlen) < 0)
+			break;
+
+		if (!last)
+		{
+			initStringInfo2(&buf, Max(1024, len + handle->stmt_len + 512),
+					TopTransactionContext);
+			appendBinaryStringInfo(&buf, leader->stmt, len);
+			leader->nresults = nstmts;
+		}
+
+		/* A txn might be started by this stmt */
+		work_on_stmt(asi, handle);
+		if ((n = count_sql_stmts(handle->stmt, handle->stmt_len, &hlen)) < 0)
+			elog(ERROR, "Kunlun-db: Invalid txn start stmts for shard %u node %u.",
+			     asi->shard_id, asi->node_id);
+
+		appendStringInfoChar(&buf, ';');
+		appendBinaryStringInfo(&buf, handle->stmt, hlen);
+		handle->nresults = n;
+		handle->coalesced = true;
+		if (handle->owns_stmt_mem)
+			pfree(handle->stmt);
+		handle->stmt = NULL;
+		handle->stmt_len = 0;
+		handle->owns_stmt_mem = false;
+		last = handle;
+	}
+
+	if (!last)
+		return;
+
+	/* The last one takes all the rest results, whatever they are */
+	last->nresults = 0;
+
+	if (leader->owns_stmt_mem)
+		pfree(leader->stmt);
+	leader->stmt_len = lengthStringInfo(&buf);
+	leader->stmt = donateStringInfo(&buf);
+	leader->owns_stmt_mem = true;
+}
+
+/**
+ * @brief Done with a result of the stmt, it's finished if that's the last one
+ *  it owns, otherwise start reading the next one.
+ */
+static void
+next_stmt_result(AsyncStmtInfo *asi, StmtHandle *handle)
+{
+	if (!mysql_more_results(asi->conn) ||
+	    (handle->nresults > 0 && ++handle->nresults_done == handle->nresults))
+	{
+		handle->finished = true;
+	}
+	else
+	{
+		int ret;
+		handle->status_req = mysql_next_result_start(&ret, asi->conn);
+		handle->nextres = (handle->status_req != 0);
+	}
+}
+
 static bool
 send_stmt_impl(AsyncStmtInfo *asi, StmtHandle *handle)
 {
@@ -1085,11 +1668,90 @@ send_stmt_impl(AsyncStmtInfo *asi, StmtHandle *handle)
 	Assert(handle->asi == asi);
 	Assert(ASIConnected(asi));
 	int ret = 0;
+
+	/*
+	  The text of a coalesced stmt was sent already, its results follow
+	  those of the stmts ahead of it.
+	*/
+	if (handle->coalesced)
+	{
+		asi->curr_stmt = handle;
+		asi->stmt_queue = list_delete_ptr(asi->stmt_queue, handle);
+		handle->first_packet = true;
+
+		if (!mysql_more_results(asi->conn))
+		{
+			/* A preceding stmt of the packet failed */
+			handle->finished = true;
+			if (!handle->cancel)
+			{
+				asi->curr_stmt = NULL;
+				release_stmt_handle(SAFE_HANDLE(handle));
+				ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("Kunlun-db: Statement not executed because a preceding statement sent in the same packet to shard %u node %u failed.",
+						asi->shard_id, asi->node_id)));
+			}
+			return true;
+		}
+
+		handle->status_req = mysql_next_result_start(&ret, asi->conn);
+		handle->nextres = (handle->status_req != 0);
+		return handle->status_req == 0;
+	}
+
+	/* The connection is idle, close the cursors no longer wanted first */
+	close_parked_stmts(asi, true);
+
 	/* update asi status, and add extra info to current statment */
 	work_on_stmt(asi, handle);
 	
 	asi->curr_stmt = handle;
 	asi->stmt_queue = list_delete_ptr(asi->stmt_queue, handle);
+
+	/*
+	  The binary protocol stmt is driven by recv_binary_stmt_result_impl()
+	  through all its phases, starting from sending the txn start stmts or
+	  the PREPARE command.
+	*/
+	if (handle->binary)
+	{
+		StmtBinaryResult *bin = handle->bin;
+
+		if (bin->cacheable)
+			stmt_cache_checkout(asi, handle);
+
+		if (bin->prepared)
+			binary_stmt_bind(asi, handle);
+		else if (!(bin->stmt = mysql_stmt_init(asi->conn)))
+			ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("Kunlun-db: Failed to init a prepared statement to shard %u node %u.",
+					asi->shard_id, asi->node_id)));
+		bin->phase = bin->pre_stmt ? BSP_PRE_QUERY :
+			(bin->prepared ? BSP_EXECUTE : BSP_PREPARE);
+		bin->started = false;
+		handle->status_req = 0;
+
+		elog(DEBUG1, "sent binary protocol query to [%u, %u:%ld]%s: %s",
+		     asi->shard_id,
+		     asi->node_id,
+		     mysql_thread_id(asi->conn),
+		     bin->prepared ? " (prepared)" : "",
+		     handle->stmt);
+
+		/* A cached stmt is executed without sending its text */
+		if (bin->prepared && handle->owns_stmt_mem)
+		{
+			pfree(handle->stmt);
+			handle->stmt = NULL;
+			handle->owns_stmt_mem = false;
+		}
+		return false;
+	}
+
+	coalesce_queued_stmts(asi, handle);
+
 	/* send it */
 	handle->status_req = mysql_real_query_start(&ret,
 											asi->conn,
@@ -1137,6 +1799,9 @@ recv_stmt_result_impl(AsyncStmtInfo *asi, StmtHandle *handle)
 	int err = 0;
 	bool ret = false;
 
+	if (handle->binary)
+		return recv_binary_stmt_result_impl(asi, handle);
+
 	if (handle->finished)
 	{
 		ret = true;
@@ -1197,14 +1862,868 @@ recv_stmt_result_impl(AsyncStmtInfo *asi, StmtHandle *handle)
 	}
 	PG_END_TRY();
 
-end:
-	if (handle->finished)
+end:
+	if (handle->finished)
+	{
+		asi->curr_stmt = NULL;
+		release_stmt_handle(SAFE_HANDLE(handle));
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Decide how to bind a result field of the binary protocol. Integer,
+ *  floating point and temporal values are bound in their native form, all
+ *  others as strings.
+ */
+static enum enum_field_types
+binary_bind_type(MYSQL_FIELD *field)
+{
+	switch (field->type)
+	{
+	case MYSQL_TYPE_TINY:
+	case MYSQL_TYPE_SHORT:
+	case MYSQL_TYPE_INT24:
+	case MYSQL_TYPE_LONG:
+	case MYSQL_TYPE_YEAR:
+		return MYSQL_TYPE_LONGLONG;
+	case MYSQL_TYPE_LONGLONG:
+		/* Unsigned bigint values may not fit in a signed 64 bit integer */
+		return (field->flags & UNSIGNED_FLAG) ? MYSQL_TYPE_STRING : MYSQL_TYPE_LONGLONG;
+	case MYSQL_TYPE_FLOAT:
+	case MYSQL_TYPE_DOUBLE:
+		return MYSQL_TYPE_DOUBLE;
+	case MYSQL_TYPE_DATE:
+	case MYSQL_TYPE_NEWDATE:
+		return MYSQL_TYPE_DATE;
+	case MYSQL_TYPE_DATETIME:
+	case MYSQL_TYPE_TIMESTAMP:
+		return MYSQL_TYPE_DATETIME;
+	case MYSQL_TYPE_TIME:
+		return MYSQL_TYPE_TIME;
+	default:
+		return MYSQL_TYPE_STRING;
+	}
+}
+
+/**
+ * @brief Bind the result fields of the prepared stmt, called when PREPARE is
+ *  done and result metadata is available.
+ */
+static void
+binary_stmt_bind_result(AsyncStmtInfo *asi, StmtHandle *handle)
+{
+	StmtBinaryResult *bin = handle->bin;
+	MYSQL_RES *meta = mysql_stmt_result_metadata(bin->stmt);
+
+	if (!meta)
+		ereport(ERROR,
+			(errcode(ERRCODE_INTERNAL_ERROR),
+			 errmsg("Kunlun-db: A SELECT statement returned no result metadata from shard %u node %u.",
+				asi->shard_id, asi->node_id)));
+
+	const int nfields = mysql_num_fields(meta);
+	MYSQL_FIELD *fields = mysql_fetch_fields(meta);
+	MemoryContext saved = MemoryContextSwitchTo(TopMemoryContext);
+
+	handle->field_count = nfields;
+	handle->fetch = true;
+	handle->types = (enum enum_field_types *)palloc(nfields * sizeof(enum enum_field_types));
+	bin->binds = (MYSQL_BIND *)palloc0(nfields * sizeof(MYSQL_BIND));
+	bin->bind_types = (enum enum_field_types *)palloc(nfields * sizeof(enum enum_field_types));
+	bin->nulls = (my_bool *)palloc0(nfields * sizeof(my_bool));
+	bin->errors = (my_bool *)palloc0(nfields * sizeof(my_bool));
+	bin->lens = (unsigned long *)palloc0(nfields * sizeof(unsigned long));
+	bin->caps = (size_t *)palloc0(nfields * sizeof(size_t));
+	bin->row = (char **)palloc0(nfields * sizeof(char *));
+	bin->lengths = (size_t *)palloc0(nfields * sizeof(size_t));
+
+	for (int i = 0; i < nfields; i++)
+	{
+		MYSQL_BIND *bind = bin->binds + i;
+		enum enum_field_types btype = binary_bind_type(fields + i);
+		size_t cap;
+
+		handle->types[i] = fields[i].type;
+		bin->bind_types[i] = btype;
+
+		if (btype == MYSQL_TYPE_LONGLONG)
+			cap = sizeof(int64_t);
+		else if (btype == MYSQL_TYPE_DOUBLE)
+			cap = sizeof(double);
+		else if (btype == MYSQL_TYPE_STRING)
+			cap = Min(Max(fields[i].length + 1, 16), BINARY_STR_FIELD_INIT_SIZE);
+		else
+			cap = sizeof(MYSQL_TIME);
+
+		/*
+		  One extra byte so that every value is followed by a '\0', as
+		  text protocol rows are, see materialize_current_tuple().
+		*/
+		bind->buffer = palloc0(cap + 1);
+		bind->buffer_type = btype;
+		bind->buffer_length = cap;
+		bind->is_null = bin->nulls + i;
+		bind->error = bin->errors + i;
+		bind->length = bin->lens + i;
+		bin->caps[i] = cap;
+	}
+
+	MemoryContextSwitchTo(saved);
+	mysql_free_result(meta);
+
+	if (mysql_stmt_bind_result(bin->stmt, bin->binds))
+		handle_stmt_error(asi, handle, mysql_stmt_errno(bin->stmt));
+}
+
+/**
+ * @brief Expose the row just fetched into the bound buffers through
+ *  handle->row and handle->lengths, refetching truncated string fields into
+ *  bigger buffers.
+ */
+static void
+binary_stmt_fill_row(AsyncStmtInfo *asi, StmtHandle *handle)
+{
+	StmtBinaryResult *bin = handle->bin;
+	bool rebind = false;
+
+	for (int i = 0; i < handle->field_count; i++)
+	{
+		MYSQL_BIND *bind = bin->binds + i;
+
+		if (bin->nulls[i])
+		{
+			bin->row[i] = NULL;
+			bin->lengths[i] = 0;
+			continue;
+		}
+
+		if (bin->bind_types[i] != MYSQL_TYPE_STRING)
+		{
+			bin->row[i] = bind->buffer;
+			bin->lengths[i] = bin->caps[i];
+			continue;
+		}
+
+		/* Need room for the trailing '\0' too */
+		if (bin->lens[i] >= bin->caps[i])
+		{
+			MYSQL_BIND col;
+
+			bin->caps[i] = bin->lens[i] + 1;
+			bind->buffer = repalloc(bind->buffer, bin->caps[i] + 1);
+			bind->buffer_length = bin->caps[i];
+			col = *bind;
+			if (mysql_stmt_fetch_column(bin->stmt, &col, i, 0))
+				handle_stmt_error(asi, handle, mysql_stmt_errno(bin->stmt));
+			rebind = true;
+		}
+
+		((char *)bind->buffer)[bin->lens[i]] = '\0';
+		bin->row[i] = bind->buffer;
+		bin->lengths[i] = bin->lens[i];
+	}
+
+	if (rebind && mysql_stmt_bind_result(bin->stmt, bin->binds))
+		handle_stmt_error(asi, handle, mysql_stmt_errno(bin->stmt));
+
+	/* The matcache may have pointed these to its own buffer */
+	handle->row = bin->row;
+	handle->lengths = bin->lengths;
+}
+
+/**
+ * @brief Start or continue the async mysql client call of the current phase.
+ *
+ * @return 0 if the call is done and its return value is in bin->ret,
+ *  otherwise the events to wait for.
+ */
+static int
+binary_stmt_run_phase(AsyncStmtInfo *asi, StmtHandle *handle)
+{
+	StmtBinaryResult *bin = handle->bin;
+	const bool start = !bin->started;
+	int status = handle->status;
+	int ret = 0;
+	int res = 0;
+
+	bin->started = true;
+	switch (bin->phase)
+	{
+	case BSP_PRE_QUERY:
+		res = start ? mysql_real_query_start(&ret, asi->conn, bin->pre_stmt, bin->pre_stmt_len) :
+			mysql_real_query_cont(&ret, asi->conn, status);
+		break;
+	case BSP_PRE_NEXT_RESULT:
+		res = start ? mysql_next_result_start(&ret, asi->conn) :
+			mysql_next_result_cont(&ret, asi->conn, status);
+		break;
+	case BSP_PREPARE:
+		res = start ? mysql_stmt_prepare_start(&ret, bin->stmt, handle->stmt, handle->stmt_len) :
+			mysql_stmt_prepare_cont(&ret, bin->stmt, status);
+		break;
+	case BSP_EXECUTE:
+		res = start ? mysql_stmt_execute_start(&ret, bin->stmt) :
+			mysql_stmt_execute_cont(&ret, bin->stmt, status);
+		break;
+	case BSP_FETCH:
+		res = start ? mysql_stmt_fetch_start(&ret, bin->stmt) :
+			mysql_stmt_fetch_cont(&ret, bin->stmt, status);
+		break;
+	default:
+		Assert(false);
+		break;
+	}
+
+	handle->status = 0;
+	if (res == 0)
+	{
+		bin->started = false;
+		bin->ret = ret;
+	}
+	return res;
+}
+
+/**
+ * @brief Bind the params and result fields of the prepared stmt, called when
+ *  the stmt is prepared or got from the prepared stmt cache.
+ */
+static void
+binary_stmt_bind(AsyncStmtInfo *asi, StmtHandle *handle)
+{
+	StmtBinaryResult *bin = handle->bin;
+	const unsigned long nparams = mysql_stmt_param_count(bin->stmt);
+
+	if (nparams != (unsigned long)bin->nparams)
+	{
+		handle->finished = true;
+		ereport(ERROR,
+			(errcode(ERRCODE_INTERNAL_ERROR),
+			 errmsg("Kunlun-db: Prepared statement to shard %u node %u has %lu placeholders but %d params are given.",
+				asi->shard_id, asi->node_id, nparams, bin->nparams)));
+	}
+
+	if (nparams > 0 && mysql_stmt_bind_param(bin->stmt, bin->params))
+		handle_stmt_error(asi, handle, mysql_stmt_errno(bin->stmt));
+
+	/* A cached stmt may have been executed with or without a cursor before */
+	unsigned long cursor_type = bin->cursor ? CURSOR_TYPE_READ_ONLY : CURSOR_TYPE_NO_CURSOR;
+	unsigned long prefetch_rows = Max(mysql_cursor_fetch_rows, 1);
+	if (mysql_stmt_attr_set(bin->stmt, STMT_ATTR_CURSOR_TYPE, &cursor_type) ||
+	    (bin->cursor &&
+	     mysql_stmt_attr_set(bin->stmt, STMT_ATTR_PREFETCH_ROWS, &prefetch_rows)))
+		handle_stmt_error(asi, handle, mysql_stmt_errno(bin->stmt));
+
+	binary_stmt_bind_result(asi, handle);
+}
+
+/**
+ * @brief Close a prepared stmt, the COM_STMT_CLOSE command has no response so
+ *  this never waits for the storage node. If the stmt's connection was closed,
+ *  only its memory is freed.
+ */
+static void
+close_prepared_stmt(MYSQL_STMT *stmt)
+{
+	MYSQL *conn = stmt->mysql;
+	my_bool ret;
+
+	if (!conn)
+	{
+		mysql_stmt_close(stmt);
+		return;
+	}
+
+	int status = mysql_stmt_close_start(&ret, stmt);
+	while (status)
+	{
+		status = wait_for_mysql(conn, status, -1);
+		status = mysql_stmt_close_cont(&ret, stmt, status);
+	}
+}
+
+/**
+ * @brief Done with the prepared stmt at EOF, close it unless it's cached for
+ *  later executions.
+ */
+static void
+binary_stmt_close(StmtHandle *handle)
+{
+	StmtBinaryResult *bin = handle->bin;
+
+	if (!bin->stmt)
+		return;
+
+	if (bin->centry)
+	{
+		Assert(bin->centry->user == handle);
+		bin->centry->user = NULL;
+		bin->centry = NULL;
+	}
+	else
+		close_prepared_stmt(bin->stmt);
+	bin->stmt = NULL;
+}
+
+/**
+ * @brief Done with a cursor stmt before EOF, close the prepared stmt so that
+ *  the storage node closes its cursor, called when the connection is idle.
+ *  A cached stmt is dropped from the cache rather than kept with the cursor
+ *  open.
+ */
+static void
+binary_stmt_close_cursor(AsyncStmtInfo *asi, StmtHandle *handle)
+{
+	StmtBinaryResult *bin = handle->bin;
+
+	Assert(bin->cursor && !bin->started);
+	if (bin->centry)
+		stmt_cache_drop(GetConnStmtCache(asi), bin->centry);
+	binary_stmt_close(handle);
+}
+
+/**
+ * @brief The recv_stmt_result_impl() of binary protocol stmts, it drives the
+ *  stmt through the phases in BinaryStmtPhase.
+ *
+ * @return true 	EOF or a new row
+ * @return false 	the result is on the way
+ */
+static bool
+recv_binary_stmt_result_impl(AsyncStmtInfo *asi, StmtHandle *handle)
+{
+	StmtBinaryResult *bin = handle->bin;
+	bool ret = false;
+
+	PG_TRY();
+	{
+		while (!handle->finished)
+		{
+			if (bin->started && handle->status_req &&
+			    (handle->status_req & handle->status) == 0)
+				break;
+
+			/* A canceled cursor stmt is closed instead of fetched to EOF */
+			if (handle->cancel && bin->cursor && bin->phase == BSP_FETCH &&
+			    !bin->started)
+			{
+				handle->row = NULL;
+				handle->finished = true;
+				binary_stmt_close_cursor(asi, handle);
+				ret = true;
+				break;
+			}
+
+			if ((handle->status_req = binary_stmt_run_phase(asi, handle)))
+				break;
+
+			if (bin->phase == BSP_PRE_QUERY || bin->phase == BSP_PRE_NEXT_RESULT)
+			{
+				/* mysql_next_result() returns -1 if no more results */
+				if (bin->ret > 0 || (bin->phase == BSP_PRE_QUERY && bin->ret != 0))
+				{
+					handle_stmt_error(asi, handle, mysql_errno(asi->conn));
+					ret = true;
+					break;
+				}
+				asi->nwarnings += mysql_warning_count(asi->conn);
+				if (mysql_more_results(asi->conn))
+					bin->phase = BSP_PRE_NEXT_RESULT;
+				else
+					bin->phase = bin->prepared ? BSP_EXECUTE : BSP_PREPARE;
+				continue;
+			}
+
+			if (bin->phase == BSP_PREPARE || bin->phase == BSP_EXECUTE)
+			{
+				if (bin->ret)
+				{
+					handle_stmt_error(asi, handle, mysql_stmt_errno(bin->stmt));
+					ret = true;
+					break;
+				}
+
+				if (bin->phase == BSP_PREPARE)
+				{
+					if (bin->cacheable)
+						stmt_cache_checkin(asi, handle);
+					/* The stmt text is no longer needed */
+					if (handle->owns_stmt_mem)
+					{
+						pfree(handle->stmt);
+						handle->stmt = NULL;
+						handle->owns_stmt_mem = false;
+					}
+					binary_stmt_bind(asi, handle);
+					bin->phase = BSP_EXECUTE;
+				}
+				else
+				{
+					handle->first_packet = true;
+					bin->phase = BSP_FETCH;
+				}
+				continue;
+			}
+
+			Assert(bin->phase == BSP_FETCH);
+			if (bin->ret == MYSQL_NO_DATA)
+			{
+				handle->row = NULL;
+				handle->finished = true;
+				binary_stmt_close(handle);
+				ret = true;
+				break;
+			}
+			else if (bin->ret == 1)
+			{
+				handle_stmt_error(asi, handle, mysql_stmt_errno(bin->stmt));
+				ret = true;
+				break;
+			}
+
+			/* Discard rows of canceled stmt until EOF */
+			if (handle->cancel)
+				continue;
+
+			/* A row, maybe with truncated string fields(MYSQL_DATA_TRUNCATED) */
+			binary_stmt_fill_row(asi, handle);
+			ret = true;
+			break;
+		}
+	}
+	PG_CATCH();
+	{
+		if (handle->finished)
+		{
+			asi->curr_stmt = NULL;
+			release_stmt_handle(SAFE_HANDLE(handle));
+		}
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	if (handle->finished)
+	{
+		ret = true;
+		if (asi->curr_stmt == handle)
+		{
+			asi->curr_stmt = NULL;
+			release_stmt_handle(SAFE_HANDLE(handle));
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Free the memory of a binary protocol stmt, the prepared stmt is closed
+ *  if still open.
+ */
+static void
+free_binary_stmt_result(StmtHandle *handle)
+{
+	StmtBinaryResult *bin = handle->bin;
+
+	if (bin->stmt)
+	{
+		/*
+		  The connection may have been closed, in which case the client lib
+		  has detached the stmt and only its memory is freed here. A cached
+		  stmt is still usable after an error, it's returned to the cache.
+		*/
+		if (ASIConnected(handle->asi) && bin->stmt->mysql)
+			binary_stmt_close(handle);
+		else
+		{
+			Assert(!bin->centry);
+			mysql_stmt_close(bin->stmt);
+			bin->stmt = NULL;
+		}
+	}
+
+	if (bin->params)
+	{
+		for (int i = 0; i < bin->nparams; i++)
+		{
+			if (bin->params[i].buffer)
+				pfree(bin->params[i].buffer);
+		}
+		pfree(bin->params);
+	}
+
+	if (bin->binds)
+	{
+		for (int i = 0; i < handle->field_count; i++)
+			pfree(bin->binds[i].buffer);
+		pfree(bin->binds);
+		pfree(bin->bind_types);
+		pfree(bin->nulls);
+		pfree(bin->errors);
+		pfree(bin->lens);
+		pfree(bin->caps);
+		pfree(bin->row);
+		pfree(bin->lengths);
+	}
+	pfree(bin);
+	handle->bin = NULL;
+}
+
+/**
+ * @brief Bind 'params'(a list of RemoteParamValue) to the binary protocol stmt.
+ *  Values are copied into buffers of their MySQL binary form, which must live
+ *  until the stmt is executed.
+ */
+static void
+bind_stmt_params(StmtBinaryResult *bin, List *params)
+{
+	ListCell *lc;
+	int i = 0;
+
+	bin->nparams = list_length(params);
+	if (bin->nparams == 0)
+		return;
+
+	bin->params = (MYSQL_BIND *)palloc0(bin->nparams * sizeof(MYSQL_BIND));
+	foreach (lc, params)
+	{
+		RemoteParamValue *rpv = (RemoteParamValue *)lfirst(lc);
+		MYSQL_BIND *bind = bin->params + i++;
+
+		if (rpv->isnull)
+		{
+			bind->buffer_type = MYSQL_TYPE_NULL;
+			continue;
+		}
+
+		switch (rpv->type)
+		{
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		{
+			int64 *v = (int64 *)palloc(sizeof(int64));
+
+			if (rpv->type == INT2OID)
+				*v = DatumGetInt16(rpv->value);
+			else if (rpv->type == INT4OID)
+				*v = DatumGetInt32(rpv->value);
+			else
+				*v = DatumGetInt64(rpv->value);
+			bind->buffer_type = MYSQL_TYPE_LONGLONG;
+			bind->buffer = v;
+			break;
+		}
+		case FLOAT8OID:
+		{
+			double *v = (double *)palloc(sizeof(double));
+
+			*v = DatumGetFloat8(rpv->value);
+			bind->buffer_type = MYSQL_TYPE_DOUBLE;
+			bind->buffer = v;
+			break;
+		}
+		case TEXTOID:
+		case VARCHAROID:
+		case BPCHAROID:
+		{
+			char *v = TextDatumGetCString(rpv->value);
+
+			bind->buffer_type = MYSQL_TYPE_STRING;
+			bind->buffer = v;
+			bind->buffer_length = strlen(v);
+			break;
+		}
+		case DATEOID:
+		{
+			MYSQL_TIME *v = (MYSQL_TIME *)palloc0(sizeof(MYSQL_TIME));
+			int year, mon, mday;
+
+			j2date(DatumGetDateADT(rpv->value) + POSTGRES_EPOCH_JDATE,
+			       &year, &mon, &mday);
+			v->year = year;
+			v->month = mon;
+			v->day = mday;
+			v->time_type = MYSQL_TIMESTAMP_DATE;
+			bind->buffer_type = MYSQL_TYPE_DATE;
+			bind->buffer = v;
+			break;
+		}
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+		{
+			MYSQL_TIME *v = (MYSQL_TIME *)palloc0(sizeof(MYSQL_TIME));
+			struct pg_tm tt;
+			fsec_t fsec;
+			int tz, ret;
+
+			/* Same as my_timestamptz_out(), mysql datetime values are in UTC */
+			if (rpv->type == TIMESTAMPOID)
+				ret = timestamp2tm(DatumGetTimestamp(rpv->value), NULL,
+						   &tt, &fsec, NULL, NULL);
+			else
+				ret = timestamp2tm(DatumGetTimestampTz(rpv->value), &tz,
+						   &tt, &fsec, NULL, pg_tzset("GMT"));
+			if (ret != 0)
+				ereport(ERROR,
+					(errcode(ERRCODE_DATETIME_VALUE_OUT_OF_RANGE),
+					 errmsg("timestamp out of range")));
+			v->year = tt.tm_year;
+			v->month = tt.tm_mon;
+			v->day = tt.tm_mday;
+			v->hour = tt.tm_hour;
+			v->minute = tt.tm_min;
+			v->second = tt.tm_sec;
+			v->second_part = fsec;
+			v->time_type = MYSQL_TIMESTAMP_DATETIME;
+			bind->buffer_type = MYSQL_TYPE_DATETIME;
+			bind->buffer = v;
+			break;
+		}
+		default:
+			elog(ERROR, "Kunlun-db: Can not bind a value of type %u to a prepared statement.",
+			     rpv->type);
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Get the prepared stmt cache of asi's connection.
+ */
+static PreparedStmtCache *
+GetConnStmtCache(AsyncStmtInfo *asi)
+{
+	ShardConnection *sconn = GetConnShard(asi->shard_id);
+	int inspos;
+	int pos = bin_search(&asi->node_id, sconn->nodeids, sconn->num_nodes,
+			     sizeof(Oid), oid_cmp, &inspos);
+
+	Assert(pos >= 0);
+	if (!sconn->stmt_caches[pos])
+	{
+		PreparedStmtCache *cache = (PreparedStmtCache *)
+			MemoryContextAllocZero(TopMemoryContext, sizeof(PreparedStmtCache));
+		dlist_init(&cache->lru);
+		sconn->stmt_caches[pos] = cache;
+	}
+
+	return sconn->stmt_caches[pos];
+}
+
+/**
+ * @brief Remove an entry from the cache and close its stmt. If the stmt is
+ *  being executed, it's handed over to the executing stmt handle which closes
+ *  it at EOF.
+ */
+static void
+stmt_cache_drop(PreparedStmtCache *cache, PreparedStmtEntry *entry)
+{
+	dlist_delete(&entry->lru_node);
+	cache->nentries--;
+
+	if (entry->user)
+		entry->user->bin->centry = NULL;
+	else
+		close_prepared_stmt(entry->stmt);
+	pfree(entry->sql);
+	pfree(entry);
+}
+
+/**
+ * @brief Drop all stmts of the cache, called when the stmts may no longer be
+ *  valid, i.e. after a DDL or when the connection is closed or reset.
+ */
+static void
+invalidate_stmt_cache(PreparedStmtCache *cache)
+{
+	dlist_mutable_iter iter;
+
+	if (!cache)
+		return;
+
+	dlist_foreach_modify(iter, &cache->lru)
+	{
+		PreparedStmtEntry *entry =
+			dlist_container(PreparedStmtEntry, lru_node, iter.cur);
+		stmt_cache_drop(cache, entry);
+		cache->invalidations++;
+	}
+}
+
+/**
+ * @brief Look up the handle's stmt in the prepared stmt cache of asi's
+ *  connection, if found the cached stmt is used and the PREPARE is skipped.
+ *  Otherwise make room for the stmt to be prepared, evicting the least
+ *  recently used stmts.
+ *
+ *  Called right before the stmt is sent, when no other stmt is in flight
+ *  in the connection.
+ */
+static void
+stmt_cache_checkout(AsyncStmtInfo *asi, StmtHandle *handle)
+{
+	StmtBinaryResult *bin = handle->bin;
+	PreparedStmtCache *cache = GetConnStmtCache(asi);
+	uint32 hash = DatumGetUInt32(hash_any((unsigned char *)handle->stmt,
+					      handle->stmt_len));
+	dlist_iter iter;
+
+	dlist_foreach(iter, &cache->lru)
+	{
+		PreparedStmtEntry *entry =
+			dlist_container(PreparedStmtEntry, lru_node, iter.cur);
+
+		if (entry->hash != hash || entry->user != NULL ||
+		    entry->sql_len != handle->stmt_len ||
+		    memcmp(entry->sql, handle->stmt, handle->stmt_len) != 0)
+			continue;
+
+		dlist_move_head(&cache->lru, &entry->lru_node);
+		entry->user = handle;
+		bin->centry = entry;
+		bin->stmt = entry->stmt;
+		bin->prepared = true;
+		cache->hits++;
+		return;
+	}
+
+	cache->misses++;
+
+	while (cache->nentries >= mysql_prepared_stmt_cache_size)
+	{
+		PreparedStmtEntry *victim = NULL;
+
+		dlist_reverse_foreach(iter, &cache->lru)
+		{
+			PreparedStmtEntry *entry =
+				dlist_container(PreparedStmtEntry, lru_node, iter.cur);
+
+			if (!entry->user)
+			{
+				victim = entry;
+				break;
+			}
+		}
+
+		if (!victim)
+			break;
+		stmt_cache_drop(cache, victim);
+		cache->evictions++;
+	}
+}
+
+/**
+ * @brief Put the stmt just prepared into the prepared stmt cache of asi's
+ *  connection. It stays out of the cache if all cached stmts are in use.
+ */
+static void
+stmt_cache_checkin(AsyncStmtInfo *asi, StmtHandle *handle)
+{
+	StmtBinaryResult *bin = handle->bin;
+	PreparedStmtCache *cache = GetConnStmtCache(asi);
+	PreparedStmtEntry *entry;
+
+	Assert(!bin->centry && handle->stmt);
+	if (cache->nentries >= mysql_prepared_stmt_cache_size)
+		return;
+
+	entry = (PreparedStmtEntry *)MemoryContextAlloc(TopMemoryContext,
+							sizeof(PreparedStmtEntry));
+	entry->sql = MemoryContextAlloc(TopMemoryContext, handle->stmt_len + 1);
+	memcpy(entry->sql, handle->stmt, handle->stmt_len);
+	entry->sql[handle->stmt_len] = '\0';
+	entry->sql_len = handle->stmt_len;
+	entry->hash = DatumGetUInt32(hash_any((unsigned char *)handle->stmt,
+					      handle->stmt_len));
+	entry->stmt = bin->stmt;
+	entry->user = handle;
+	dlist_push_head(&cache->lru, &entry->lru_node);
+	cache->nentries++;
+	bin->centry = entry;
+}
+
+/*
+ * Show the prepared stmt cache of each storage node connection of this
+ * session.
+ */
+Datum
+remote_prepared_stmt_cache_stats(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	ShardConnSection *psect;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* need to build tuplestore in query context */
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupdesc = CreateTemplateTupleDesc(7, false);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 1, "shard_id", OIDOID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 2, "node_id", OIDOID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 3, "entries", INT4OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 4, "hits", INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 5, "misses", INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 6, "evictions", INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 7, "invalidations", INT8OID, -1, 0);
+
+	tupstore =
+		tuplestore_begin_heap(rsinfo->allowedModes & SFRM_Materialize_Random,
+							  false, work_mem);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	for (psect = &cur_session.all_shard_conns; psect; psect = psect->next)
 	{
-		asi->curr_stmt = NULL;
-		release_stmt_handle(SAFE_HANDLE(handle));
+		for (int i = 0; i < psect->nconns; i++)
+		{
+			ShardConnection *sconn = psect->shards + i;
+
+			for (int j = 0; j < sconn->num_nodes; j++)
+			{
+				PreparedStmtCache *cache = sconn->stmt_caches[j];
+				Datum		values[7];
+				bool		nulls[7];
+
+				if (!cache)
+					continue;
+
+				MemSet(nulls, 0, sizeof(nulls));
+				values[0] = ObjectIdGetDatum(sconn->shard_id);
+				values[1] = ObjectIdGetDatum(sconn->nodeids[j]);
+				values[2] = Int32GetDatum(cache->nentries);
+				values[3] = Int64GetDatum(cache->hits);
+				values[4] = Int64GetDatum(cache->misses);
+				values[5] = Int64GetDatum(cache->evictions);
+				values[6] = Int64GetDatum(cache->invalidations);
+
+				tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+			}
+		}
 	}
 
-	return ret;
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	return (Datum) 0;
 }
 
 /**
@@ -1246,16 +2765,7 @@ fetch_stmt_remote_next(AsyncStmtInfo *asi, StmtHandle *handle)
 
 		mysql_free_result(handle->res);
 		handle->res = NULL;
-		if (!mysql_more_results(asi->conn))
-		{
-			handle->finished = true;
-		}
-		else
-		{
-			int ret;
-			handle->status_req = mysql_next_result_start(&ret, asi->conn);
-			handle->nextres = (handle->status_req != 0);
-		}
+		next_stmt_result(asi, handle);
 	}
 	/* it's returning, so count for the affected rows */
 	else
@@ -1354,16 +2864,7 @@ handle_stmt_remote_result(AsyncStmtInfo *asi, StmtHandle *handle)
 		asi->nwarnings += mysql_warning_count(asi->conn);
 
 		/* No more results? it's EOF ? */	
-		if (!mysql_more_results(asi->conn))
-		{
-			handle->finished = true;
-		}
-		else
-		{
-			int ret;
-			handle->status_req = mysql_next_result_start(&ret, asi->conn);
-			handle->nextres = (handle->status_req != 0);
-		}
+		next_stmt_result(asi, handle);
 
 		return true;
 	}
@@ -1382,16 +2883,7 @@ handle_stmt_remote_result(AsyncStmtInfo *asi, StmtHandle *handle)
 
 			handle->status = 0;
 			handle->res = NULL;
-			if (!mysql_more_results(asi->conn))
-			{
-				handle->finished = true;
-			}
-			else
-			{
-				int ret;
-				handle->status = mysql_next_result_start(&ret, asi->conn);
-				handle->nextres = (handle->status != 0);
-			}
+			next_stmt_result(asi, handle);
 			return true;
 		}
 		else
@@ -1409,6 +2901,206 @@ bool is_stmt_eof(StmtSafeHandle h)
 	       (!handle->read_cache || !handle->cache || matcache_eof(handle->cache));
 }
 
+#ifdef HAVE_SYS_EPOLL_H
+static ShardSockState *
+get_shard_sock(int fd)
+{
+	Assert(fd >= 0);
+	if (fd >= num_shard_socks)
+	{
+		int newnum = Max(64, num_shard_socks);
+
+		while (newnum <= fd)
+			newnum *= 2;
+		if (shard_socks)
+			shard_socks = repalloc(shard_socks, sizeof(ShardSockState) * newnum);
+		else
+			shard_socks = MemoryContextAlloc(TopMemoryContext, sizeof(ShardSockState) * newnum);
+		memset(shard_socks + num_shard_socks, 0,
+		       sizeof(ShardSockState) * (newnum - num_shard_socks));
+		num_shard_socks = newnum;
+	}
+	return shard_socks + fd;
+}
+
+/**
+ * @brief Clear the state of socket 'fd' which now belongs to a new connection.
+ */
+static void
+forget_shard_sock(int fd)
+{
+	if (fd < 0)
+		return;
+	ShardSockState *state = get_shard_sock(fd);
+	state->registered = false;
+	state->ready = 0;
+}
+
+static void
+init_shard_wait_set()
+{
+	if (shard_wait_set)
+		return;
+
+	if (shard_epoll_fd < 0 &&
+	    (shard_epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+		ereport(ERROR,
+			(errcode(ERRCODE_SYSTEM_ERROR),
+			 errmsg("Kunlun-db: epoll_create1() failed with system error (%d : %s)",
+				errno, strerror(errno))));
+
+	shard_wait_set = CreateWaitEventSet(TopMemoryContext, 2);
+	shard_wait_latch_pos = AddWaitEventToSet(shard_wait_set, WL_LATCH_SET,
+						 PGINVALID_SOCKET, MyLatch, NULL);
+	AddWaitEventToSet(shard_wait_set, WL_SOCKET_READABLE, shard_epoll_fd, NULL, NULL);
+}
+
+static void
+register_shard_sock(int fd, ShardSockState *state)
+{
+	struct epoll_event ev;
+
+	ev.events = EPOLLIN | EPOLLOUT | EPOLLPRI | EPOLLET;
+	ev.data.fd = fd;
+	if (epoll_ctl(shard_epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0 &&
+	    (errno != EEXIST || epoll_ctl(shard_epoll_fd, EPOLL_CTL_MOD, fd, &ev) < 0))
+		ereport(ERROR,
+			(errcode(ERRCODE_SYSTEM_ERROR),
+			 errmsg("Kunlun-db: epoll_ctl() failed with system error (%d : %s)",
+				errno, strerror(errno))));
+
+	/*
+	  Readiness before the registration is not reported as an edge, let
+	  the first wait try the socket.
+	*/
+	state->registered = true;
+	state->ready = MYSQL_WAIT_READ | MYSQL_WAIT_WRITE | MYSQL_WAIT_EXCEPT;
+}
+
+/**
+ * @brief Accumulate the edges reported by epoll into the sockets' states.
+ */
+static void
+harvest_shard_sock_events()
+{
+	struct epoll_event evs[SHARD_EPOLL_EVENTS];
+	int n;
+
+	do
+	{
+		n = epoll_wait(shard_epoll_fd, evs, SHARD_EPOLL_EVENTS, 0);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			ereport(ERROR,
+				(errcode(ERRCODE_SYSTEM_ERROR),
+				 errmsg("Kunlun-db: epoll_wait() unexpectedly failed with system error (%d : %s)",
+					errno, strerror(errno))));
+		}
+
+		for (int i = 0; i < n; i++)
+		{
+			ShardSockState *state = get_shard_sock(evs[i].data.fd);
+			uint32 events = evs[i].events;
+
+			/* An error or EOF is reported to whoever reads or writes */
+			if (events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+				state->ready |= MYSQL_WAIT_READ;
+			if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+				state->ready |= MYSQL_WAIT_WRITE;
+			if (events & EPOLLPRI)
+				state->ready |= MYSQL_WAIT_EXCEPT;
+		}
+	} while (n == SHARD_EPOLL_EVENTS);
+}
+
+/**
+ * @brief Wait until any of the handles can go on, or timeout_ms elapses or
+ *  the process latch is set, in which case NULL is returned.
+ *
+ *  A handle's MYSQL_WAIT_* status_req is consumed from its socket's readiness
+ *  into handle->status. The mysql client lib only asks to wait for a socket
+ *  after it got EAGAIN from it, so a consumed readiness is always followed by
+ *  a new edge when more data arrives.
+ */
+static StmtHandle*
+poll_remote_events_any(StmtHandle *handles[], int size, int timeout_ms)
+{
+	StmtHandle *active_handle = NULL;
+	TimestampTz start_time = 0;
+	long cur_timeout = timeout_ms;
+
+	for (int i = 0; i < size; ++i)
+	{
+		StmtHandle *handle = handles[i];
+		if (handle->finished || !handle->status_req || (handle->status_req & handle->status))
+			return handle;
+	}
+
+	init_shard_wait_set();
+	if (timeout_ms > 0)
+		start_time = GetCurrentTimestamp();
+
+	while (true)
+	{
+		for (int i = 0; i < size; ++i)
+		{
+			StmtHandle *handle = handles[i];
+			int fd = mysql_get_socket(handle->asi->conn);
+			ShardSockState *state = get_shard_sock(fd);
+			int events;
+
+			if (!state->registered)
+				register_shard_sock(fd, state);
+
+			if ((events = (state->ready & handle->status_req)))
+			{
+				handle->status = events;
+				state->ready &= ~events;
+				active_handle = handle;
+			}
+		}
+
+		if (active_handle)
+			break;
+
+		WaitEvent occurred;
+		int rc;
+
+		if (timeout_ms > 0)
+		{
+			long secs;
+			int usecs;
+
+			TimestampDifference(start_time, GetCurrentTimestamp(), &secs, &usecs);
+			cur_timeout = timeout_ms - (secs * 1000 + usecs / 1000);
+			if (cur_timeout <= 0)
+				break;
+		}
+
+		ModifyWaitEvent(shard_wait_set, shard_wait_latch_pos, WL_LATCH_SET, MyLatch);
+		rc = WaitEventSetWait(shard_wait_set, cur_timeout, &occurred, 1,
+				      WAIT_EVENT_SHARD_RESULT);
+
+		/* Timeout, break */
+		if (rc == 0)
+			break;
+
+		/* Signals such as query cancel set the latch */
+		if (occurred.events & WL_LATCH_SET)
+		{
+			ResetLatch(MyLatch);
+			CHECK_FOR_INTERRUPTS();
+			continue;
+		}
+
+		harvest_shard_sock_events();
+	}
+
+	return active_handle;
+}
+#else
 static StmtHandle*
 poll_remote_events_any(StmtHandle *handles[], int size, int timeout_ms)
 {
@@ -1486,11 +3178,87 @@ poll_remote_events_any(StmtHandle *handles[], int size, int timeout_ms)
 
 	return active_handle;
 }
+#endif
+
+/**
+ * @brief Whether the stmt can give up its connection without materializing
+ *  the rest of its rows, true for a cursor stmt between two fetches. The
+ *  storage node keeps the cursor open while other stmts are executed in the
+ *  connection, and the stmt fetches the rest of its rows with COM_STMT_FETCH
+ *  after it takes the connection back, see resume_stmt().
+ */
+static bool
+stmt_parkable(StmtHandle *handle)
+{
+	return handle->binary && handle->bin->cursor && !handle->finished &&
+	       handle->bin->phase == BSP_FETCH && !handle->bin->started;
+}
+
+/**
+ * @brief Whether results of coalesced stmts are still to be read from asi's
+ *  connection, nothing else can be sent through it until they are.
+ */
+static inline bool
+has_coalesced_stmts(AsyncStmtInfo *asi)
+{
+	return list_length(asi->stmt_queue) > 0 &&
+	       ((StmtHandle *)linitial(asi->stmt_queue))->coalesced;
+}
+
+/**
+ * @brief Start the stmt in asi's idle connection, or take the connection back
+ *  for a parked cursor stmt.
+ */
+static void
+resume_stmt(AsyncStmtInfo *asi, StmtHandle *handle)
+{
+	Assert(!asi->curr_stmt);
+	if (handle->parked)
+	{
+		handle->parked = false;
+		asi->curr_stmt = handle;
+	}
+	else
+		send_stmt_impl(asi, handle);
+}
+
+/**
+ * @brief Finish the parked cursor stmts of asi, or only the canceled ones if
+ *  'canceled_only', closing their cursors if the connection is still up.
+ *  Called when the connection is idle.
+ */
+static void
+close_parked_stmts(AsyncStmtInfo *asi, bool canceled_only)
+{
+	StmtHandle *parked[list_length(asi->stmt_inuse) + 1];
+	int num = 0;
+	ListCell *lc;
+
+	foreach (lc, asi->stmt_inuse)
+	{
+		StmtHandle *handle = (StmtHandle *)lfirst(lc);
+		if (handle->parked && (handle->cancel || !canceled_only))
+			parked[num++] = handle;
+	}
+
+	for (int i = 0; i < num; i++)
+	{
+		StmtHandle *handle = parked[i];
+		handle->parked = false;
+		handle->cancel = true;
+		handle->finished = true;
+		if (ASIConnected(asi))
+			binary_stmt_close_cursor(asi, handle);
+		release_stmt_handle(SAFE_HANDLE(handle));
+	}
+}
 
 /**
  * @brief Urges processing of statements preceding cur .
  *
  * 	if cur = null, then all statements in the queue are urged to be processed
+ * 	if cur is a parked cursor stmt, only the current stmt is urged to give
+ * 	the connection back.
  *
  * @return true	 	All of the statements preceding cur has been processed
  * @return false 	A preceding statement is in progress, need wait for a while
@@ -1519,9 +3287,12 @@ process_preceding_stmts(AsyncStmtInfo *asi, StmtHandle *cur)
 				}
 			}
 
-			/* materialize results of previous statment */
+			/*
+			  materialize results of previous statment, a cursor stmt only
+			  needs to reach the end of a fetch to be parked.
+			*/
 			++handle->refcount;
-			while (recv_stmt_result_impl(asi, handle))
+			while (!stmt_parkable(handle) && recv_stmt_result_impl(asi, handle))
 			{
 				if (handle->finished)
 					break;
@@ -1535,19 +3306,30 @@ process_preceding_stmts(AsyncStmtInfo *asi, StmtHandle *cur)
 			if (!handle->cache)
 				handle->read_cache = false;
 
-			bool finished = handle->finished;
+			/* The current stmt keeps its reference while parked */
+			if (stmt_parkable(handle))
+			{
+				handle->parked = true;
+				asi->curr_stmt = NULL;
+			}
+
+			bool done = handle->finished || handle->parked;
 			release_stmt_handle(SAFE_HANDLE(handle));
-			if (!finished)
+			if (!done)
 				return false;
 		}
 
+		if (cur && cur->parked && !has_coalesced_stmts(asi))
+			return true;
+
 		do
 		{
 			if (list_length(asi->stmt_queue) == 0 ||
 			    (handle = (StmtHandle*)linitial(asi->stmt_queue)) == cur)
 				return true;
 
-			if (handle->cancel)
+			/* A coalesced stmt was sent, its results must be read */
+			if (handle->cancel && !handle->coalesced)
 			{
 				asi->stmt_queue = list_delete_ptr(asi->stmt_queue, handle);
 				release_stmt_handle(SAFE_HANDLE(handle));
@@ -1582,6 +3364,8 @@ flush_invalid_stmts(AsyncStmtInfo *pasi)
 		release_stmt_handle(SAFE_HANDLE(pasi->curr_stmt));
 		pasi->curr_stmt = NULL;
 	}
+
+	close_parked_stmts(pasi, false);
 }
 
 /**
@@ -1764,9 +3548,9 @@ get_stmt_next_row_common(StmtHandle *handle, bool wait)
 		}
 	}
 
-	/* Send statement if not send it yet */
+	/* Send statement if not send it yet, or resume the parked one */
 	if (!asi->curr_stmt)
-		send_stmt_impl(asi, handle);
+		resume_stmt(asi, handle);
 
 	Assert(asi->curr_stmt == handle);
 	/* wait until recv next tuple from the socket */
@@ -1819,6 +3603,13 @@ get_stmt_field_types(StmtSafeHandle handle)
 	return handle.handle->types;
 }
 
+enum enum_field_types *
+get_stmt_bind_types(StmtSafeHandle handle)
+{
+	CHECK_HANDLE_EPOCH(handle);
+	return handle.handle->bin ? handle.handle->bin->bind_types : NULL;
+}
+
 size_t *get_stmt_row_lengths(StmtSafeHandle handle)
 {
 	CHECK_HANDLE_EPOCH(handle);
@@ -1886,6 +3677,9 @@ wait_for_readable_stmt(StmtSafeHandle *handles, int size)
 				if (stmt_handles_member(handles, size, lfirst(lc)))
 					break;
 			}
+			/* a parked cursor stmt only waits for the connection */
+			if (handle->parked)
+				pending_stmts[num_pending_stmts++] = handle;
 		}
 	}
 
@@ -1895,9 +3689,10 @@ wait_for_readable_stmt(StmtSafeHandle *handles, int size)
 	{
 		handle = pending_stmts[i];
 		if (handle->asi->curr_stmt == NULL &&
-		    linitial(handle->asi->stmt_queue) == handle)
+		    ((handle->parked && !has_coalesced_stmts(handle->asi)) ||
+		     (!handle->parked && linitial(handle->asi->stmt_queue) == handle)))
 		{
-			send_stmt_impl(handle->asi, handle);
+			resume_stmt(handle->asi, handle);
 			runing_stmts[num_runing_stmts++] = handle;
 			pending_stmts[i] = pending_stmts[--num_pending_stmts];
 		}
@@ -1928,7 +3723,7 @@ wait_for_readable_stmt(StmtSafeHandle *handles, int size)
 				/* process the precding stmts to get a idle connection*/
 				if (process_preceding_stmts(handle->asi, handle))
 				{
-					send_stmt_impl(handle->asi, handle);
+					resume_stmt(handle->asi, handle);
 					runing_stmts[num_runing_stmts++] = handle;
 					pending_stmts[i] = pending_stmts[--num_pending_stmts];
 				}
@@ -2090,11 +3885,10 @@ static void
 materialize_current_tuple(AsyncStmtInfo *asi, StmtHandle *handle)
 {
 	Assert(asi->curr_stmt == handle);
-	Assert(handle->res && handle->row);
+	Assert((handle->res || handle->binary) && handle->row);
 	if (!handle->cache)
 	{
 		handle->cache = matcache_create();
-		Assert(matcache_mode(handle->cache) == WRITE_MODE);
 		initStringInfo2(&handle->read_buff, 128, TopMemoryContext);
 		initStringInfo2(&handle->buff, 128, TopMemoryContext);
 	}
@@ -2135,7 +3929,6 @@ void stmt_rewind(StmtSafeHandle h)
 	{
 		handle->read_cache = true;
 		handle->reset_cache_pos = true;
-		handle->cache_pos.fileno = 0;
 		handle->cache_pos.offset = 0;
 		matcache_set_read_pos(handle->cache, handle->cache_pos);
 	}
@@ -2153,6 +3946,8 @@ void release_stmt_handle(StmtSafeHandle h)
 		Assert(handle->finished);
 		if (handle->cache)
 			matcache_close(handle->cache);
+		if (handle->bin)
+			free_binary_stmt_result(handle);
 		if (handle->types)
 			pfree(handle->types);
 		// The memory context may have been released 
@@ -2287,6 +4082,57 @@ void send_stmt_to_all_shards_sync(char *stmt, size_t len, CmdType cmdtype, bool
 	flush_all_stmts_impl(used_asis, cnt, false);
 }
 
+/**
+ * @brief Make progress of asi's statements: receive the results which have
+ *  arrived and send queued statements once the connection is free. Wait only
+ *  while more than 'max_pending' statements are queued or running.
+ *
+ *  Nothing else polls a connection between two sends to it, so a producer
+ *  of many statements(e.g. remote inserts of COPY FROM) calls this to keep
+ *  the storage node busy while it produces the next statements.
+ *
+ * @return NO. of statements still queued or running in asi
+ */
+int progress_stmts(AsyncStmtInfo *asi, int max_pending)
+{
+	bool enable_timeout = false;
+	int npending = 0;
+
+	/*
+	  A running SELECT is read by its scan, don't materialize it to make room
+	  for queued stmts unless there are too many of them.
+	*/
+	if (asi->curr_stmt && asi->curr_stmt->cmd == CMD_SELECT &&
+	    list_length(asi->stmt_queue) + 1 <= max_pending)
+		return list_length(asi->stmt_queue) + 1;
+
+	while (ASIConnected(asi) && !process_preceding_stmts(asi, NULL))
+	{
+		bool wait;
+
+		npending = list_length(asi->stmt_queue) + 1;
+		wait = (npending > max_pending);
+
+		/* set timeout for distributed deadlock detect, as flush_all_stmts_impl() */
+		if (wait && asi->curr_stmt->is_dml_write && !enable_timeout)
+		{
+			enable_timeout = true;
+			enable_timeout_after(WRITE_SHARD_RESULT_TIMEOUT,
+					     start_global_deadlock_detection_wait_timeout);
+		}
+
+		if (!poll_remote_events_any(&asi->curr_stmt, 1, wait ? 1000 : 0) && !wait)
+			break;
+		npending = 0;
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	if (enable_timeout)
+		disable_timeout(WRITE_SHARD_RESULT_TIMEOUT, false);
+
+	return npending;
+}
+
 /**
  * @brief Send all of the statements in queue and  waiting for the result synchronously
  *
@@ -2354,8 +4200,11 @@ void cancel_stmt(StmtSafeHandle h)
 		handle->cache = NULL;
 	}
 
-	/* Check if it is currently running statment */
-	if (is_stmt_eof(h) || handle->asi->curr_stmt != handle)
+	/*
+	  Check if it is currently running statment, a parked cursor stmt takes
+	  its connection back to close the cursor.
+	*/
+	if (is_stmt_eof(h) || (handle->asi->curr_stmt != handle && !handle->parked))
 		return;
 
 	MYSQL_ROW row = get_stmt_next_row_common(handle, true);
@@ -2388,22 +4237,28 @@ cancel_all_stmts_impl(AsyncStmtInfo *asi[], int cnt)
 	for (int i = 0; i < cnt; ++i)
 	{
 		AsyncStmtInfo *pasi = asi[i];
+		List *coalesced = NIL;
 		ListCell *lc;
 		foreach (lc, pasi->stmt_queue)
 		{
 			StmtHandle *handle = lfirst(lc);
 			handle->cancel = true;
+			/* Its results are still to be read from the connection */
+			if (handle->coalesced)
+			{
+				coalesced = lappend(coalesced, handle);
+				continue;
+			}
 			handle->finished = true;
 			release_stmt_handle(SAFE_HANDLE(handle));
 		}
 		list_free(pasi->stmt_queue);
-		pasi->stmt_queue = NIL;
+		pasi->stmt_queue = coalesced;
 
 		if (pasi->curr_stmt)
-		{
 			pasi->curr_stmt->cancel = true;
+		if (pasi->curr_stmt || coalesced)
 			active[num++] = pasi;
-		}
 	}
 
 	/* make a copy to top error before loop */
@@ -2433,6 +4288,9 @@ cancel_all_stmts_impl(AsyncStmtInfo *asi[], int cnt)
 		PG_END_TRY();
 	} while (retry);
 
+	for (int i = 0; i < cnt; ++i)
+		close_parked_stmts(asi[i], false);
+
 	--deep;
 
 	/* Restore the top error information */
@@ -2532,7 +4390,11 @@ handle_stmt_error(AsyncStmtInfo *asi, StmtHandle *handle, int eno)
 
 	static char errmsg_buf[512];
 	errmsg_buf[0] = '\0';
-	strncat(errmsg_buf, mysql_error(conn), sizeof(errmsg_buf) - 1);
+	/* Errors of prepared stmts are kept in the MYSQL_STMT object */
+	if (handle->bin && handle->bin->stmt && mysql_stmt_errno(handle->bin->stmt) == eno)
+		strncat(errmsg_buf, mysql_stmt_error(handle->bin->stmt), sizeof(errmsg_buf) - 1);
+	else
+		strncat(errmsg_buf, mysql_error(conn), sizeof(errmsg_buf) - 1);
 
 	/* Mark the EOF of the statement */
 	handle->finished = true;
@@ -2630,6 +4492,20 @@ bool MySQLQueryExecuted()
 	return false;
 }
 
+/*
+ * Whether any storage shard has been written in current transaction.
+ * */
+bool MySQLWriteExecuted()
+{
+	AsyncStmtInfo *asi = cur_session.asis;
+	for (int i = 0; i < cur_session.num_asis_used; i++, asi++)
+	{
+		if (asi->did_write)
+			return true;
+	}
+	return false;
+}
+
 static void
 check_mysql_node_status(AsyncStmtInfo *asi, bool want_master)
 {
@@ -2698,6 +4574,63 @@ void disconnect_storage_shards()
 	handle_epoch ++;
 }
 
+/*
+ * Whether the session has any connection to storage nodes.
+ * */
+bool HasShardConns()
+{
+	for (ShardConnSection *psect = &cur_session.all_shard_conns; psect; psect = psect->next)
+	{
+		for (int i = 0; i < psect->nconns; i++)
+		{
+			ShardConnection *sconn = psect->idx.conns[i];
+			for (int j = 0; j < sconn->num_nodes; j++)
+				if (ShardBackendConnValid(sconn, j))
+					return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Close all connections to storage nodes when the session is idle out of
+ * txn, so that storage nodes don't keep connections of long idle sessions.
+ * This is not a pool: connections are never shared between backends, and a
+ * session that is active within mysql_conn_idle_timeout keeps one connection
+ * to every node it used, between its txns too. The ShardConnection slots are
+ * kept, and the connections are made again by next txn which needs them,
+ * with session variables set again by GetAsyncStmtInfoNode().
+ * */
+void ReleaseIdleShardConns()
+{
+	int nclosed = 0;
+
+	ShardConnIdleTimeoutPending = false;
+	if (IsTransactionOrTransactionBlock())
+		return;
+
+	for (ShardConnSection *psect = &cur_session.all_shard_conns; psect; psect = psect->next)
+	{
+		for (int i = 0; i < psect->nconns; i++)
+		{
+			ShardConnection *sconn = psect->idx.conns[i];
+			for (int j = 0; j < sconn->num_nodes; j++)
+			{
+				if (!ShardBackendConnValid(sconn, j))
+					continue;
+				mysql_close(sconn->conns[j]);
+				sconn->conn_flags[j] &= ~CONN_VALID;
+				invalidate_stmt_cache(sconn->stmt_caches[j]);
+				nclosed++;
+			}
+		}
+	}
+
+	/* invalid all handle out of this module */
+	handle_epoch++;
+	elog(DEBUG1, "Kunlun-db: Closed %d idle connections to storage nodes.", nclosed);
+}
+
 void request_topo_checks_used_shards()
 {
 	for (int i = 0; i < cur_session.num_asis_used; i++)
@@ -167,6 +167,7 @@ CreateSharedMemoryAndSemaphores(int port)
 		size = add_size(size, GDDShmemSize());
 		size = add_size(size, ShardingTopoCheckSize());
 		size = add_size(size, ShardConnKillReqQSize());
+		size = add_size(size, ShardTopoMapShmemSize());
 		/* freeze the addin request size and include it */
 		addin_request_allowed = false;
 		size = add_size(size, total_addin_request);
@@ -281,6 +282,7 @@ CreateSharedMemoryAndSemaphores(int port)
 	CreateGDDShmem();
 	ShardingTopoCheckShmemInit();
 	ShardConnKillReqQShmemInit();
+	ShardTopoMapShmemInit();
 
 	/*
 	 * Set up other modules that need some shared memory space
@@ -551,6 +551,10 @@ ProcessClientReadInterrupt(bool blocked)
 		/* Process notify interrupts, if any */
 		if (notifyInterruptPending)
 			ProcessNotifyInterrupt();
+
+		/* Close storage node connections of an idle session, if any */
+		if (ShardConnIdleTimeoutPending)
+			ReleaseIdleShardConns();
 	}
 	else if (ProcDiePending)
 	{
@@ -3698,6 +3702,7 @@ PostgresMain(int argc, char *argv[],
 	sigjmp_buf	local_sigjmp_buf;
 	volatile bool send_ready_for_query = true;
 	bool		disable_idle_in_transaction_timeout = false;
+	bool		disable_shard_conn_idle_timeout = false;
 
 	/* Initialize startup process environment if necessary. */
 	if (!IsUnderPostmaster)
@@ -4150,6 +4155,14 @@ PostgresMain(int argc, char *argv[],
 
 				set_ps_display("idle", false);
 				pgstat_report_activity(STATE_IDLE, NULL);
+
+				/* Start the timer to close idle storage node connections */
+				if (mysql_conn_idle_timeout > 0 && HasShardConns())
+				{
+					disable_shard_conn_idle_timeout = true;
+					enable_timeout_after(SHARD_CONN_IDLE_TIMEOUT,
+										 mysql_conn_idle_timeout * 1000);
+				}
 			}
 
 			ReadyForQuery(whereToSendOutput);
@@ -4189,6 +4202,12 @@ PostgresMain(int argc, char *argv[],
 			disable_timeout(IDLE_IN_TRANSACTION_SESSION_TIMEOUT, false);
 			disable_idle_in_transaction_timeout = false;
 		}
+		if (disable_shard_conn_idle_timeout)
+		{
+			disable_timeout(SHARD_CONN_IDLE_TIMEOUT, false);
+			disable_shard_conn_idle_timeout = false;
+			ShardConnIdleTimeoutPending = false;
+		}
 
 		/*
 		 * (6) check for any other interesting events that happened while we
@@ -5495,6 +5495,9 @@ get_actual_variable_range(PlannerInfo *root, VariableStatData *vardata,
 	/* No hope if no relation or it doesn't have indexes */
 	if (rel == NULL || rel->indexlist == NIL)
 		return false;
+	/* Indexes of remote relations are on storage nodes, can't probe them */
+	if (rel->relshardid != InvalidOid)
+		return false;
 	/* If it has indexes it must be a plain relation */
 	rte = root->simple_rte_array[rel->relid];
 	Assert(rte->rtekind == RTE_RELATION);
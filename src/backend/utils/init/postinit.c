@@ -42,6 +42,7 @@
 #include "postmaster/postmaster.h"
 #include "postmaster/xidsender.h"
 #include "replication/walsender.h"
+#include "sharding/sharding_conn.h"
 #include "storage/bufmgr.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
@@ -80,6 +81,7 @@ static bool ThereIsAtLeastOneRole(void);
 static void process_startup_options(Port *port, bool am_superuser);
 static void process_settings(Oid databaseid, Oid roleid);
 static void WriteShardResultTimeoutHandler(void);
+static void ShardConnIdleTimeoutHandler(void);
 
 /*** InitPostgres support ***/
 
@@ -614,6 +616,8 @@ InitPostgres(const char *in_dbname, Oid dboid, const char *username,
 						IdleInTransactionSessionTimeoutHandler);
 		RegisterTimeout(WRITE_SHARD_RESULT_TIMEOUT,
 						WriteShardResultTimeoutHandler);
+		RegisterTimeout(SHARD_CONN_IDLE_TIMEOUT,
+						ShardConnIdleTimeoutHandler);
 	}
 
 	/*
@@ -1233,6 +1237,17 @@ WriteShardResultTimeoutHandler()
 	kick_start_gdd();
 }
 
+/*
+ * The storage node connections are closed in ProcessClientReadInterrupt(),
+ * not in the signal handler.
+ */
+static void
+ShardConnIdleTimeoutHandler(void)
+{
+	ShardConnIdleTimeoutPending = true;
+	SetLatch(MyLatch);
+}
+
 
 /*
  * Returns true if at least one role is defined in this database cluster.
@@ -48,6 +48,8 @@
 #include "commands/vacuum.h"
 #include "commands/variable.h"
 #include "commands/trigger.h"
+#include "commands/copy.h"
+#include "executor/nodeAppend.h"
 #include "funcapi.h"
 #include "jit/jit.h"
 #include "libpq/auth.h"
@@ -137,11 +139,13 @@ extern bool ignore_checksum_failure;
 extern bool synchronize_seqscans;
 extern int cluster_commitlog_group_size;
 extern int cluster_commitlog_delay_ms;
+extern int cluster_commitlog_latency_target_ms;
 extern bool enable_stacktrace;
 extern bool enable_coredump;
 extern int global_txn_commit_log_wait_max_secs;
 extern bool use_mysql_native_seq;
 extern int max_remote_insert_blocks;
+extern int max_remote_insert_inflight;
 extern int sharding_policy;
 extern int check_primary_interval_secs;
 #ifdef TRACE_SYNCSCAN
@@ -985,6 +989,33 @@ static struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_remote_agg_pushdown", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables partial aggregation of remote tables by storage shards."),
+			NULL
+		},
+		&enable_remote_agg_pushdown,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_remote_join_pushdown", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables joins of remote tables on the same storage shard by the shard."),
+			NULL
+		},
+		&enable_remote_join_pushdown,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_parallel_remotescan", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables parallel workers to scan remote tables or partitions."),
+			NULL
+		},
+		&enable_parallel_remotescan,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_parallel_append", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of parallel append plans."),
@@ -1890,6 +1921,57 @@ static struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"mysql_binary_protocol", PGC_USERSET, CLIENT_CONN_OTHER,
+			gettext_noop("Whether to execute remote scans through the mysql binary(prepared statement) protocol, so that fixed-width column values are transferred without text conversion."),
+		},
+		&mysql_binary_protocol,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"mysql_coalesce_stmts", PGC_USERSET, CLIENT_CONN_OTHER,
+			gettext_noop("Whether statements queued for a mysql storage node connection are sent together in one multi-statement packet."),
+			gettext_noop("Saves a network round trip per queued statement, their results are read in turn.")
+		},
+		&mysql_coalesce_stmts,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"mysql_replica_read", PGC_USERSET, CLIENT_CONN_OTHER,
+			gettext_noop("Whether read only transactions read remote tables from shard replicas, chosen by their ro_weight in pg_shard_node."),
+			gettext_noop("The shard's primary node is used if no replica is usable.")
+		},
+		&mysql_replica_read,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_remote_async_append", PGC_USERSET, CLIENT_CONN_OTHER,
+			gettext_noop("Whether an append node of remote scans, e.g. over the partitions of a remote table, sends all their queries to storage nodes up front and returns rows of whichever is readable first."),
+		},
+		&enable_remote_async_append,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_remote_copy_to_stream", PGC_USERSET, CLIENT_CONN_OTHER,
+			gettext_noop("Whether COPY TO of a remote table sends a query to each shard holding its rows and writes rows out as they arrive, instead of running COPY (SELECT ...) TO."),
+			gettext_noop("Rows of different partitions interleave in the output.")
+		},
+		&enable_remote_copy_to_stream,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"remote_scan_adaptive", PGC_USERSET, DEVELOPER_OPTIONS,
+			gettext_noop("Whether a param dependent remote scan switches between fetching rows by param values on each rescan and fetching all rows at once, by the costs observed during execution."),
+		},
+		&remote_scan_adaptive,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_coredump", PGC_USERSET, CLIENT_CONN_OTHER,
 			gettext_noop("Whether to generate core dump file when any postgres process catches a fatal signal. Coredump files can be very useful for bug diagnosis."),
@@ -3229,6 +3311,41 @@ static struct config_int ConfigureNamesInt[] =
 		1073741824, 1024, 2*1073741823 + 1,
 		NULL, NULL, NULL
 	},
+	{
+		{"mysql_prepared_stmt_cache_size", PGC_USERSET, CLIENT_CONN_OTHER,
+			gettext_noop("Max number of prepared statements cached in each connection to a mysql storage node, 0 disables the cache."),
+			gettext_noop("Remote scans driven by outer params are prepared once per connection and later executions only send the param values.")
+		},
+		&mysql_prepared_stmt_cache_size,
+		0, 0, 16382,
+		NULL, NULL, NULL
+	},
+	{
+		{"mysql_cursor_fetch_rows", PGC_USERSET, CLIENT_CONN_OTHER,
+			gettext_noop("Number of rows fetched at a time through a server side cursor by binary protocol remote scans, 0 disables cursors."),
+			gettext_noop("Remote scans on the same storage node connection then take turns to fetch rows instead of materializing the results of each other.")
+		},
+		&mysql_cursor_fetch_rows,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+	{
+		{"mysql_replica_max_latency", PGC_USERSET, CLIENT_CONN_OTHER,
+			gettext_noop("Shard replicas whose latency in pg_shard_node exceeds this are not read from, -1 means no limit."),
+		},
+		&mysql_replica_max_latency,
+		-1, -1, INT_MAX,
+		NULL, NULL, NULL
+	},
+	{
+		{"mysql_conn_idle_timeout", PGC_USERSET, CLIENT_CONN_OTHER,
+			gettext_noop("Closes the storage node connections of a session which stays idle out of transaction for this many seconds, 0 disables it."),
+			gettext_noop("Connections are made again by the next transaction which needs them.")
+		},
+		&mysql_conn_idle_timeout,
+		300, 0, INT_MAX / 1000,
+		NULL, NULL, NULL
+	},
 	
 	{
 		{"comp_node_id", PGC_USERSET, DEVELOPER_OPTIONS,
@@ -3256,6 +3373,26 @@ static struct config_int ConfigureNamesInt[] =
 		10, 1, 1000000,
 		NULL, NULL, NULL
 	},
+
+	{
+		{"cluster_commitlog_latency_target_ms", PGC_SIGHUP, DEVELOPER_OPTIONS,
+			gettext_noop("Target latency in milliseconds of commit log writes, used by the GTSS process to adapt its group size and delay."),
+			gettext_noop("0 disables the adaption, cluster_commitlog_group_size and cluster_commitlog_delay_ms are used as is.")
+		},
+		&cluster_commitlog_latency_target_ms,
+		0, 0, 1000000,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"cluster_commitlog_senders", PGC_POSTMASTER, DEVELOPER_OPTIONS,
+			gettext_noop("Number of GTSS processes sending commit logs to metadata server."),
+			gettext_noop("Each process sends the commit logs of a share of the committing backends over its own connection, and takes a background worker slot.")
+		},
+		&cluster_commitlog_senders,
+		1, 1, MAX_XID_SENDERS,
+		NULL, NULL, NULL
+	},
 #ifdef ENABLE_DEBUG_SYNC
 	{
 		{"debug_sync_timeout", PGC_USERSET, DEVELOPER_OPTIONS,
@@ -3300,6 +3437,15 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"remote_scan_batch_size", PGC_USERSET, DEVELOPER_OPTIONS,
+			gettext_noop("Max NO. of outer rows of a nested loop join whose keys are looked up in one remote query by a param dependent inner remote scan, 1 disables batching."),
+		},
+		&remote_scan_batch_size,
+		100, 1, 10000,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"max_remote_insert_blocks", PGC_USERSET, DEVELOPER_OPTIONS,
 			gettext_noop("Max NO. of blocks ever allowed to be allocated to one session to insert rows."),
@@ -3308,6 +3454,15 @@ static struct config_int ConfigureNamesInt[] =
 		1024, 8, 1024*1024,
 		NULL, NULL, NULL
 	},
+	{
+		{"max_remote_insert_inflight", PGC_USERSET, CLIENT_CONN_OTHER,
+			gettext_noop("Max NO. of insert statements queued or running in one storage shard's connection, e.g. by COPY FROM and INSERT ... SELECT."),
+			gettext_noop("A session producing more rows waits for the shard to finish earlier ones.")
+		},
+		&max_remote_insert_inflight,
+		4, 1, 1024,
+		NULL, NULL, NULL
+	},
 	{
 		{"check_primary_interval_secs", PGC_USERSET, DEVELOPER_OPTIONS,
 			gettext_noop("check current primary nodes of all stoarge shards and the metadata shard, if no such actions performed since last such actions for this many seconds."),
@@ -3316,6 +3471,16 @@ static struct config_int ConfigureNamesInt[] =
 		3, 1, 100,
 		NULL, NULL, NULL
 	},
+	{
+		{"primary_watch_interval_ms", PGC_SIGHUP, DEVELOPER_OPTIONS,
+			gettext_noop("Interval at which the topo service asks the primary node of each storage shard and the metadata shard whether it's still the primary."),
+			gettext_noop("A changed or unavailable primary is looked for and rerouted to at once. 0 disables it."),
+			GUC_UNIT_MS
+		},
+		&primary_watch_interval_ms,
+		200, 0, 60000,
+		NULL, NULL, NULL
+	},
 
 	{
 		{"sharding_policy", PGC_USERSET, DEVELOPER_OPTIONS,
@@ -3405,6 +3570,47 @@ static struct config_real ConfigureNamesReal[] =
 		DEFAULT_PARALLEL_SETUP_COST, 0, DBL_MAX,
 		NULL, NULL, NULL
 	},
+	{
+		{"remote_stmt_cost", PGC_USERSET, QUERY_TUNING_COST,
+			gettext_noop("Sets the planner's estimate of the cost of "
+						 "a round trip of a statement sent to a storage node."),
+			NULL
+		},
+		&remote_stmt_cost,
+		DEFAULT_REMOTE_STMT_COST, 0, DBL_MAX,
+		NULL, NULL, NULL
+	},
+	{
+		{"remote_tuple_cost", PGC_USERSET, QUERY_TUNING_COST,
+			gettext_noop("Sets the planner's estimate of the cost of "
+						 "transferring each tuple (row) from a storage node."),
+			NULL
+		},
+		&remote_tuple_cost,
+		DEFAULT_REMOTE_TUPLE_COST, 0, DBL_MAX,
+		NULL, NULL, NULL
+	},
+	{
+		{"remote_byte_cost", PGC_USERSET, QUERY_TUNING_COST,
+			gettext_noop("Sets the planner's estimate of the cost of "
+						 "transferring each byte from a storage node."),
+			NULL
+		},
+		&remote_byte_cost,
+		DEFAULT_REMOTE_BYTE_COST, 0, DBL_MAX,
+		NULL, NULL, NULL
+	},
+	{
+		{"remote_filter_cost_factor", PGC_USERSET, QUERY_TUNING_COST,
+			gettext_noop("Sets the planner's estimate of the cost of evaluating "
+						 "a pushed down qual on a storage node, as a fraction "
+						 "of its local cost."),
+			NULL
+		},
+		&remote_filter_cost_factor,
+		DEFAULT_REMOTE_FILTER_COST_FACTOR, 0, DBL_MAX,
+		NULL, NULL, NULL
+	},
 
 	{
 		{"jit_above_cost", PGC_USERSET, QUERY_TUNING_COST,
@@ -22,6 +22,8 @@
 #include "nodes/execnodes.h"
 
 extern int remote_param_fetch_threshold;
+extern int remote_scan_batch_size;
+extern bool remote_scan_adaptive;
 
 typedef struct VarPickerCtx
 {
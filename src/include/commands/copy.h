@@ -23,6 +23,8 @@
 typedef struct CopyStateData *CopyState;
 typedef int (*copy_data_source_cb) (void *outbuf, int minread, int maxread);
 
+extern bool enable_remote_copy_to_stream;
+
 extern void DoCopy(ParseState *state, const CopyStmt *stmt,
 	   int stmt_location, int stmt_len,
 	   uint64 *processed);
@@ -44,6 +44,7 @@ extern void ExecParallelFinish(ParallelExecutorInfo *pei);
 extern void ExecParallelCleanup(ParallelExecutorInfo *pei);
 extern void ExecParallelReinitialize(PlanState *planstate,
 						 ParallelExecutorInfo *pei, Bitmapset *sendParam);
+extern bool ExecParallelRemoteScanAllowed(PlanState *planstate);
 
 extern void ParallelQueryMain(dsm_segment *seg, shm_toc *toc);
 
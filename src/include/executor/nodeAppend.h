@@ -17,6 +17,8 @@
 #include "access/parallel.h"
 #include "nodes/execnodes.h"
 
+extern bool enable_remote_async_append;
+
 extern AppendState *ExecInitAppend(Append *node, EState *estate, int eflags);
 extern void ExecEndAppend(AppendState *node);
 extern void ExecReScanAppend(AppendState *node);
@@ -22,6 +22,14 @@
 extern RemoteScanState *ExecInitRemoteScan(RemoteScan *node, EState *estate, int eflags);
 extern void ExecEndRemoteScan(RemoteScanState *node);
 extern void ExecReScanRemoteScan(RemoteScanState *node);
+extern bool ExecRemoteScanSetBound(RemoteScanState *node, int64 tuples_needed);
+extern bool ExecRemoteScanStart(RemoteScanState *node);
+
+/* batched key lookup support */
+extern bool ExecRemoteScanBatchable(RemoteScanState *node, List *nestParams);
+extern void ExecRemoteScanBatchBegin(RemoteScanState *node);
+extern void ExecRemoteScanBatchAddKey(RemoteScanState *node);
+extern void ExecRemoteScanBatchFetch(RemoteScanState *node);
 
 /* parallel scan support */
 extern void ExecRemoteScanEstimate(RemoteScanState *node, ParallelContext *pcxt);
@@ -31,6 +39,9 @@ extern void ExecRemoteScanInitializeWorker(RemoteScanState *node,
 							ParallelWorkerContext *pwcxt);
 extern void ExecStoreRemoteTuple(TypeInputInfo *tii, MYSQL_ROW row,
 				 unsigned long *lengths, enum enum_field_types *fieldtypes, TupleTableSlot *slot);
+extern void ExecStoreRemoteBinaryTuple(TypeInputInfo *tii, MYSQL_ROW row,
+				 unsigned long *lengths, enum enum_field_types *fieldtypes,
+				 enum enum_field_types *bindtypes, TupleTableSlot *slot);
 extern void init_type_input_info(TypeInputInfo **tii, TupleTableSlot *slot,
 	EState *estate);
 extern void release_shard_conn(RemoteScanState *node);
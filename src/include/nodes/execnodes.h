@@ -44,6 +44,7 @@ struct ExprEvalStep;			/* avoid including execExpr.h everywhere */
 struct EnumLabelOid;
 typedef struct TypeInputInfo
 {
+	Oid typid;
 	char typcat;
 	int typmod;
 	Oid typinput;
@@ -1143,6 +1144,7 @@ typedef struct ModifyTableState
  *							eliminated from the scan, or NULL if not possible.
  *		valid_subplans		for runtime pruning, valid appendplans indexes to
  *							scan.
+ *		async				scan remote subplans concurrently, see nodeAppend.c
  * ----------------
  */
 
@@ -1165,6 +1167,18 @@ struct AppendState
 	struct PartitionPruneState *as_prune_state;
 	Bitmapset  *as_valid_subplans;
 	bool		(*choose_next_subplan) (AppendState *);
+
+	/*
+	 * If as_async is set, all subplans are remote scans, whose queries are
+	 * all sent to storage nodes up front, and rows are returned from
+	 * whichever is readable first. as_asyncplans[i] is the index of a
+	 * subplan not exhausted yet, and as_asynchandles[i] its stmt handle.
+	 */
+	bool		as_async;
+	bool		as_async_started;
+	int			as_nasync;
+	int		   *as_asyncplans;
+	StmtSafeHandle *as_asynchandles;
 };
 
 /* ----------------
@@ -1321,10 +1335,67 @@ typedef struct RemoteScanState
 	/* Origial plan->qual */
 	List *orignal_qual;
 
+	/* Target list of a remote aggregation, rewritten from plan->targetlist */
+	List *agg_tlist;
+
 	/* Quals pushdown to the storage */
 	List *quals_pushdown;
 	List *having_pushdown;
 
+	/*
+	 * If set, remote_sql is a template whose '?' placeholders are bound to
+	 * remote_params(a list of RemoteParamValue) and executed through the
+	 * prepared stmt cache, see send_stmt_async_prepared().
+	 */
+	bool use_prepared;
+	List *remote_params;
+
+	/*
+	 * Max NO. of rows the parent node needs, -1 if unknown. Set by
+	 * ExecSetTupleBound() and pushed down as a LIMIT clause, if the scan's
+	 * current mode allows, see remote_scan_bound().
+	 */
+	int64 tuples_needed;
+	int64 tuples_bound;				/* as set by the parent */
+
+	/*
+	 * Batched key lookups. If batch_key_quals isn't NIL, every pushed down
+	 * qual that depends on rescan params is a 'col = $n' equality in that
+	 * list, and a NestLoop parent can send the keys of up to
+	 * remote_scan_batch_size outer rows in one 'col IN (...)' query, see
+	 * ExecRemoteScanBatchFetch(). The fetched rows are stored in batch_hash
+	 * keyed by the scan tuple's batch_key_attnos columns, and each rescan
+	 * only looks up the matches of its param values there.
+	 */
+	List *batch_key_quals;
+	int nbatch_keys;
+	AttrNumber *batch_key_attnos;	/* key columns in the scan tuple */
+	int *batch_key_paramids;		/* PARAM_EXEC ids of the keys */
+	Oid *batch_key_types;
+	bool batch_active;
+	MemoryContext batch_cxt;
+	struct HTAB *batch_hash;
+	ListCell *batch_cursor;			/* next match to return */
+	int64 nbatches;					/* for EXPLAIN ANALYZE */
+
+	/*
+	 * Adaptive choice of param_driven. If set, the scan tuple has the columns
+	 * to evaluate param_quals(the pushed down quals depending on rescan
+	 * params) locally, so that the scan can switch once between the param
+	 * driven mode, which pushes them down and uses local_qual, and the fetch
+	 * all mode, which doesn't and uses fetch_all_qual, by the costs observed
+	 * in the current mode, see remote_scan_adapt().
+	 */
+	bool adaptive;
+	List *param_quals;
+	ExprState *local_qual;
+	ExprState *fetch_all_qual;
+	int64 nscans;					/* rescans in current mode */
+	int64 nrows_read;				/* rows read in current mode */
+	int64 nrows_returned;			/* rows passing local quals in current mode */
+	int64 total_scans;
+	int64 switched_at;				/* total_scans at the switch, 0 if none */
+	int64 nqueries;					/* for EXPLAIN ANALYZE */
 } RemoteScanState;
 
 /* ----------------
@@ -1837,6 +1908,15 @@ typedef struct NestLoopState
 	bool		nl_NeedNewOuter;
 	bool		nl_MatchedOuter;
 	TupleTableSlot *nl_NullInnerTupleSlot;
+
+	/*
+	 * Set if the inner node is a RemoteScan doing batched key lookups, the
+	 * outer tuples are then read ahead and buffered in nl_OuterBatch.
+	 */
+	bool		nl_BatchInner;
+	bool		nl_OuterDone;
+	Tuplestorestate *nl_OuterBatch;
+	TupleTableSlot *nl_OuterBatchSlot;
 } NestLoopState;
 
 /* ----------------
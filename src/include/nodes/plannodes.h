@@ -366,25 +366,31 @@ typedef struct RemoteScan
 	*/
 	bool		materialized;
 	/*
-	 * TODO:
-	 * we don't need to decide for storage node which index to use to fetch
-	 * target rows, but we do need below fields of IndexScan to decide whether to
-	 * demand storage node to return rows in certain order, as either required
-	 * by the 'ORDER BY' clause, the 'GROUP BY' clause, or the 'sort merge' join.
-	 * See get_index_paths() and other functions in indexpath.c to figure out
-	 * how to get the wanted ordering of results.
-	 *
-	 * So a remotescan always has 2 Paths: one without required order, the
-	 * other one with required order. We need to assign them each a proper cost
-	 * to do query optimization; Alternatively if we always prefer pushing
-	 * heavy lifting to storage nodes, we can simply always choose the one
-	 * with wanted ordering.
-	 *
-	List	   *indexorderby;
-	List	   *indexorderbyorig;
-	List	   *indexorderbyops;
-	ScanDirection indexorderdir;
-	 * */
+	 * Order in which the storage node is asked to return rows, by an
+	 * 'ORDER BY' clause appended to the remote query, decided from the
+	 * path's pathkeys in create_remotescan_plan(). sortexprs are columns of
+	 * the scanned relation, sortdesc and nullsFirst have one entry each.
+	 */
+	List	   *sortexprs;
+	bool	   *sortdesc;		/* DESC instead of ASC */
+	bool	   *nullsFirst;		/* NULLS FIRST instead of NULLS LAST */
+	/*
+	 * True if the storage node does the partial aggregation of the scanned
+	 * rows, see create_remote_agg_plan(). The targetlist then contains the
+	 * grouping expressions and the partial Aggrefs, and groupexprs are
+	 * printed as the remote query's 'GROUP BY' clause.
+	 */
+	bool		remote_agg;
+	List	   *groupexprs;
+	/*
+	 * If joinrelid isn't 0, the storage shard joins the scanned relation
+	 * with the relation of range table entry joinrelid, which is stored in
+	 * the same shard, see create_remote_join_plan(). jointype is JOIN_INNER
+	 * or JOIN_LEFT, joinquals are the ON clauses of a JOIN_LEFT.
+	 */
+	Index		joinrelid;
+	JoinType	jointype;
+	List	   *joinquals;
 } RemoteScan;
 
 typedef struct Scan
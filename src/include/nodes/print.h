@@ -16,9 +16,21 @@
 
 #include "executor/tuptable.h"
 #include "lib/stringinfo.h"
+#include "nodes/execnodes.h"
 #include "nodes/params.h"
 
 #define nodeDisplay(x)		pprint(x)
+
+/*
+ * A param value printed as a '?' placeholder, to be bound to the prepared
+ * stmt on the storage node.
+ */
+typedef struct RemoteParamValue
+{
+	Oid type;
+	bool isnull;
+	Datum value;
+} RemoteParamValue;
 typedef struct RemotePrintExprContext
 {
 	EState *estate;
@@ -44,6 +56,20 @@ typedef struct RemotePrintExprContext
 
 	/* Do not print expr to mysql sql, just verify */
 	bool noprint;
+
+	/*
+	 * Print PARAM_EXEC params of bindable types as '?' placeholders and
+	 * append their values to 'param_values' as RemoteParamValue, so that the
+	 * printed stmt is a template which can be prepared once and reused.
+	 */
+	bool print_placeholders;
+	List *param_values;
+
+	/*
+	 * Qualify column names with the alias 't<varno>' of their table, for
+	 * a remote query that joins multiple tables.
+	 */
+	bool qualify_columns;
 } RemotePrintExprContext;
 
 extern void InitRemotePrintExprContext(RemotePrintExprContext *rpec, List*rtable);
@@ -60,4 +86,7 @@ extern void print_tl(const List *tlist, const List *rtable);
 extern void print_slot(TupleTableSlot *slot);
 extern int snprint_expr(StringInfo buf, const Expr *expr, RemotePrintExprContext *rpec);
 extern Oid my_output_funcoid(Oid typid, bool *typIsVarlena);
+extern bool remote_param_bindable(Oid type, bool isnull, Datum value);
+extern bool remote_type_compares_same(Oid typid);
+extern bool remote_partial_agg_supported(Aggref *aggref);
 #endif							/* PRINT_H */
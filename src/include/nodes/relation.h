@@ -1616,6 +1616,37 @@ typedef struct AggPath
 	List	   *qual;			/* quals (HAVING quals), if any */
 } AggPath;
 
+/*
+ * RemoteAggPath represents partial aggregation done by the storage node of
+ * a remote relation: 'subpath' is the RemoteScan path of the relation and
+ * the storage node groups its rows by 'groupexprs'.  The path's target
+ * contains the grouping expressions and the partial Aggrefs, it is always
+ * below a Finalize Aggregate.
+ */
+typedef struct RemoteAggPath
+{
+	Path		path;
+	Path	   *subpath;		/* RemoteScan path of the remote relation */
+	List	   *groupexprs;		/* grouping expressions, if any */
+	double		numGroups;		/* estimated number of groups */
+} RemoteAggPath;
+
+/*
+ * RemoteJoinPath represents a join of two remote relations done by the
+ * storage shard that both of them are stored in: outerpath and innerpath
+ * are the RemoteScan paths of the relations, and the shard applies all
+ * restriction clauses of both relations and the join.  Only JOIN_INNER and
+ * JOIN_LEFT are supported.
+ */
+typedef struct RemoteJoinPath
+{
+	Path		path;
+	Path	   *outerpath;		/* RemoteScan path of the outer relation */
+	Path	   *innerpath;		/* RemoteScan path of the inner relation */
+	JoinType	jointype;
+	List	   *joinrestrictinfo;	/* RestrictInfos to apply to join */
+} RemoteJoinPath;
+
 /*
  * Various annotations used for grouping sets in the planner.
  */
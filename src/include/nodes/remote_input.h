@@ -14,5 +14,7 @@
 extern void myInputInfo(Oid typid, int typmode, TypeInputInfo *info);
 
 extern Datum myInputFuncCall(TypeInputInfo *info, char *str, int len, enum enum_field_types mytype, bool *isnull);
+extern Datum myBinaryInputFuncCall(TypeInputInfo *info, char *buf, int len,
+		enum enum_field_types mytype, enum enum_field_types bindtype, bool *isnull);
 
 #endif
\ No newline at end of file
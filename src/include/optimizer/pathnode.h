@@ -35,7 +35,20 @@ extern bool add_partial_path_precheck(RelOptInfo *parent_rel,
 						  Cost total_cost, List *pathkeys);
 
 extern Path *create_remotescan_path(PlannerInfo *root, RelOptInfo *rel,
-					Relids required_outer, int parallel_workers);
+					Relids required_outer, int parallel_workers,
+					List *pathkeys);
+extern RemoteAggPath *create_remote_agg_path(PlannerInfo *root,
+					   RelOptInfo *rel,
+					   Path *subpath,
+					   PathTarget *target,
+					   List *groupexprs,
+					   double numGroups);
+extern RemoteJoinPath *create_remote_join_path(PlannerInfo *root,
+						RelOptInfo *joinrel,
+						Path *outer_path,
+						Path *inner_path,
+						JoinType jointype,
+						List *restrict_clauses);
 extern Path *create_seqscan_path(PlannerInfo *root, RelOptInfo *rel,
 					Relids required_outer, int parallel_workers);
 extern Path *create_samplescan_path(PlannerInfo *root, RelOptInfo *rel,
@@ -239,5 +239,8 @@ extern PathKey *make_canonical_pathkey(PlannerInfo *root,
 					   int strategy, bool nulls_first);
 extern void add_paths_to_append_rel(PlannerInfo *root, RelOptInfo *rel,
 						List *live_childrels);
+extern Expr *find_remote_sort_expr(PathKey *pathkey, RelOptInfo *rel);
+extern bool remote_index_provides_order(PlannerInfo *root, RelOptInfo *rel,
+							List *pathkeys);
 
 #endif							/* PATHS_H */
@@ -15,11 +15,16 @@
  *-------------------------------------------------------------------------
  */
 typedef uint64_t GlobalTrxId;
+
+/* Max value of cluster_commitlog_senders. */
+#define MAX_XID_SENDERS 8
+
+extern int cluster_commitlog_senders;
 extern void CreateSharedBackendXidSlots(void);
 extern Size BackendXidSenderShmemSize(void);
 extern void xidsender_initialize(void);
 extern void XidSenderMain(int argc, char **argv);
-extern int  xidsender_start(void);
+extern int  xidsender_start(int senderno);
 extern char WaitForXidCommitLogWrite(Oid comp_nodeid, GlobalTrxId xid, time_t deadline, List *prepared_shards, bool commit_it);
 extern bool wait_latch(int millisecs);
 
@@ -7,33 +7,56 @@
 
 #define BUFF_SIZE 1024
 
+/*
+  Spilled bytes are gathered in memory and written to the temp file this
+  many at a time, so that reads of the file don't have to seek back and
+  forth for every row written.
+*/
+#define MATCACHE_TAIL_SIZE (BLCKSZ * 4)
+
 typedef unsigned char uchar;
 
-#define READ_MODE 'r'
-#define WRITE_MODE 'w'
+/*
+  Logical offset of a byte in the cache, no matter it's in memory or in the
+  temp file.
+*/
 typedef struct MatCachePos
 {
-        int fileno;
         off_t offset;
 } MatCachePos;
+
+/*
+  An append only byte stream with independent read and write cursors.
+  The first mem_limit bytes(work_mem) are kept in memory, the rest are
+  spilled to a temp file which is only created when needed:
+
+  [0, mem_len)                     in mem
+  [mem_len, mem_len + file_len)    in file
+  [mem_len + file_len, write_pos)  in tail, not written to file yet
+*/
 typedef struct MatCache
 {
         MatCachePos read_pos;
         MatCachePos write_pos;
+        char *mem;
+        size_t mem_len;
+        size_t mem_size;
+        size_t mem_limit;
         BufFile *file;
-        char mode;
+        off_t file_len;
+        off_t file_pos;   /* current position of file, -1 if unknown */
+        char *tail;
+        size_t tail_len;
 } MatCache;
 
 extern MatCache *matcache_create(void);
 extern void matcache_close(MatCache *cache);
 extern void matcache_reset(MatCache *cache);
 extern bool matcache_eof(MatCache *cache);
-static inline char matcache_mode(MatCache *cache) { return cache->mode; }
 extern void matcache_write(MatCache *cache, uchar *data, size_t len);
 extern size_t matcache_read(MatCache *cache, uchar *buff, size_t len);
 
 extern void matcache_get_read_pos(MatCache *cache, MatCachePos *pos);
 extern void matcache_set_read_pos(MatCache *cache, MatCachePos pos);
 extern void matcache_get_write_pos(MatCache *cache, MatCachePos *pos);
-extern void matcache_set_write_pos(MatCache *cache, MatCachePos pos);
-#endif
\ No newline at end of file
+#endif
@@ -116,11 +116,14 @@ extern bool FindCachedShardNode(Oid shardid, Oid nodeid, Shard_node_t* out);
 
 extern Oid FindBestShardForTable(int policy, Relation rel);
 extern Oid GetShardMasterNodeId(Oid shardid);
+extern List *GetShardReplicaNodeIds(Oid shardid, int max_latency);
 
 extern Size ShardingTopoCheckSize(void);
 extern void ShardingTopoCheckShmemInit(void);
 extern bool RequestShardingTopoCheck(Oid shardid);
 extern void ProcessShardingTopoReqs(void);
+extern void WatchShardPrimaries(void);
+extern int primary_watch_interval_ms;
 
 extern void ShardConnKillReqQShmemInit(void);
 extern Size ShardConnKillReqQSize(void);
@@ -134,6 +137,10 @@ extern void inform_cluster_log_applier_main(void);
 
 extern List *GetAllShardIds(void);
 
+extern Size ShardTopoMapShmemSize(void);
+extern void ShardTopoMapShmemInit(void);
+extern void ReloadShardTopoMap(void);
+
 /* Get the pid of the topo service */
 extern pid_t get_topo_service_pid(void);
 
@@ -29,6 +29,14 @@ extern int mysql_read_timeout;
 extern int mysql_write_timeout;
 extern int mysql_max_packet_size;
 extern bool mysql_transmit_compress;
+extern bool mysql_binary_protocol;
+extern bool mysql_coalesce_stmts;
+extern int mysql_prepared_stmt_cache_size;
+extern int mysql_cursor_fetch_rows;
+extern bool mysql_replica_read;
+extern int mysql_replica_max_latency;
+extern int mysql_conn_idle_timeout;
+extern volatile bool ShardConnIdleTimeoutPending;
 
 /**
  * CONN_VALID	: Connection is valid. if not, need to reconnect at next use of the connection.
@@ -37,6 +45,7 @@ extern bool mysql_transmit_compress;
  */
 #define CONN_VALID 0x1
 #define CONN_RESET 0x2
+typedef struct PreparedStmtCache PreparedStmtCache;
 typedef struct ShardConnection
 {
 	Oid shard_id;	   // Connections to one shard's all nodes.
@@ -50,9 +59,15 @@ typedef struct ShardConnection
 
 	char conn_flags[MAX_NODES_PER_SHARD];
 	MYSQL conn_objs[MAX_NODES_PER_SHARD]; // append only
+	/*
+	 * stmt_caches[i] caches stmts prepared through conns[i], it's dropped
+	 * when conns[i] is closed or reset.
+	 * */
+	PreparedStmtCache *stmt_caches[MAX_NODES_PER_SHARD];
 } ShardConnection;
 
 typedef struct MatCache MatCache;
+typedef struct StmtBinaryResult StmtBinaryResult;
 typedef struct StmtHandle
 {
 	struct AsyncStmtInfo *asi;
@@ -74,6 +89,16 @@ typedef struct StmtHandle
 	bool finished;		// true if finish read from socket
 	bool cancel;
 	bool read_cache;	// true if should read from matcache
+	bool parked;		// true if a cursor stmt gave up the conn between fetches
+
+	/*
+	 * Set if the stmt text was sent in the multi-statement packet of a
+	 * preceding stmt, see coalesce_queued_stmts(). 'nresults' is the NO. of
+	 * results owned by the stmt in that packet, 0 means all the rest.
+	 */
+	bool coalesced;
+	int nresults;
+	int nresults_done;
 	
 	int ignore_errno;
 	uint32_t affected_rows;
@@ -85,6 +110,13 @@ typedef struct StmtHandle
 	MYSQL_ROW row;
 	int field_count;
 
+	/*
+	 * Set if the stmt is executed through the binary (prepared statement)
+	 * protocol, see send_stmt_async_binary().
+	 */
+	bool binary;
+	StmtBinaryResult *bin;
+
 	/* Used by materialize */
 	StringInfoData read_buff;
 	StringInfoData buff;
@@ -193,6 +225,7 @@ extern AsyncStmtInfo *GetAsyncStmtInfoByIndex(int i);
 extern int GetAsyncStmtInfoUsed(void);
 extern AsyncStmtInfo *GetAsyncStmtInfo(Oid shardid);
 extern AsyncStmtInfo *GetAsyncStmtInfoNode(Oid shardid, Oid shardNodeId, bool req_chk_onfail);
+extern AsyncStmtInfo *GetAsyncStmtInfoForRead(Oid shardid);
 
 /**
  * @brief Stmthandle with epoch information  
@@ -229,6 +262,31 @@ extern int set_stmt_ignored_error(int mysql_errno);
 extern StmtSafeHandle send_stmt_async(AsyncStmtInfo *asi, char *stmt, size_t stmt_len,
 				      CmdType cmd, bool ownsit, enum enum_sql_command sqlcom, bool materialize) __attribute__((warn_unused_result));
 
+/**
+ * @brief Same as send_stmt_async(), but the SELECT 'stmt' is executed through the
+ *  MySQL binary (prepared statement) protocol, so that fixed-width columns are
+ *  returned in their native binary form instead of text.
+ *
+ *  Rows are read with get_stmt_next_row() as usual, field i of a row points to
+ *  a value of type get_stmt_bind_types(handle)[i].
+ *
+ *  If mysql_cursor_fetch_rows > 0 the rows are fetched through a server side
+ *  cursor, and between two fetches other stmts can use the connection without
+ *  materializing the rest of the rows.
+ */
+extern StmtSafeHandle send_stmt_async_binary(AsyncStmtInfo *asi, char *stmt, size_t stmt_len,
+				      bool ownsit, bool materialize) __attribute__((warn_unused_result));
+
+/**
+ * @brief Same as send_stmt_async_binary(), but 'stmt' is a template whose '?'
+ *  placeholders are bound to 'params', a list of RemoteParamValue. The template
+ *  is prepared once per storage node connection and cached if
+ *  mysql_prepared_stmt_cache_size > 0, later executions of the same template
+ *  only send the param values.
+ */
+extern StmtSafeHandle send_stmt_async_prepared(AsyncStmtInfo *asi, char *stmt, size_t stmt_len,
+				      bool ownsit, bool materialize, List *params) __attribute__((warn_unused_result));
+
 /**
  * @brief Wait until the result of some stmts can be read
  */
@@ -252,6 +310,12 @@ extern MYSQL_ROW try_get_stmt_next_row(StmtSafeHandle handle);
  */
 enum enum_field_types *get_stmt_field_types(StmtSafeHandle handle);
 
+/**
+ * @brief Get the buffer types the result fields of a binary protocol stmt are
+ *  bound to, NULL if the stmt is executed through the text protocol.
+ */
+enum enum_field_types *get_stmt_bind_types(StmtSafeHandle handle);
+
 /**
  * @brief Get the row lengths array of the current row
  * 
@@ -334,6 +398,12 @@ extern void send_stmt_to_all_shards_sync(char *stmt, size_t len, CmdType cmdtype
  */
 extern void flush_all_stmts(void);
 
+/**
+ * @brief Make progress of asi's statements without waiting unless more than
+ *  'max_pending' of them are queued or running
+ */
+extern int progress_stmts(AsyncStmtInfo *asi, int max_pending);
+
 /**
  * @brief Cancel all of the statements in queue, and wait for the completion of the running statements
  * 
@@ -346,12 +416,15 @@ extern void cancel_all_stmts(void);
 
 extern uint64_t GetRemoteAffectedRows(void);
 extern bool MySQLQueryExecuted(void);
+extern bool MySQLWriteExecuted(void);
 
 extern uint64_t GetTxnRemoteAffectedRows(void);
 extern Oid GetCurrentNodeOfShard(Oid shard);
 
 extern bool IsConnReset(AsyncStmtInfo *asi);
 extern void disconnect_storage_shards(void);
+extern bool HasShardConns(void);
+extern void ReleaseIdleShardConns(void);
 extern void request_topo_checks_used_shards(void);
 
 #endif // !SHARDING_CONN_H
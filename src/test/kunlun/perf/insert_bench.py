@@ -0,0 +1,40 @@
+#! /usr/bin/python
+# Measure rows/sec of bulk inserts into a remote table, which is bound by
+# serializing rows into remote INSERT stmts(cache_remotetup() in remotetup.c).
+# Run it against a computing node before and after a change to compare.
+#
+# usage: insert_bench.py host port user password [nrows] [nloops]
+import sys
+import time
+import psycopg2
+
+def bench(host, port, user, pwd, nrows, nloops):
+	conn = psycopg2.connect(host=host, port=port, user=user, password=pwd, database='postgres')
+	conn.autocommit = True
+	cur = conn.cursor()
+	cur.execute("drop table if exists insert_bench")
+	cur.execute("create table insert_bench(id bigint primary key, a int, b smallint, "
+		"c float8, d numeric(20,4), e timestamp, f timestamptz, g date, h text)")
+	sql = ("insert into insert_bench select i, i, i % 32768, i * 1.5, i / 7.0, "
+		"timestamp '2021-01-01' + i * interval '1 second', "
+		"timestamptz '2021-01-01 00:00:00+08' + i * interval '1 second', "
+		"date '2021-01-01' + i % 3650, 'row ' || i "
+		"from generate_series(1, %d) i" % nrows)
+	best = None
+	for loop in range(nloops):
+		cur.execute("delete from insert_bench")
+		start = time.time()
+		cur.execute(sql)
+		secs = time.time() - start
+		best = secs if best is None or secs < best else best
+		print "loop %d: %d rows in %.3f secs, %.0f rows/sec" % (loop, nrows, secs, nrows / secs)
+	print "best: %.0f rows/sec" % (nrows / best)
+	cur.execute("drop table insert_bench")
+
+if __name__ == '__main__':
+	if len(sys.argv) < 5:
+		print "usage: %s host port user password [nrows] [nloops]" % sys.argv[0]
+		sys.exit(1)
+	nrows = int(sys.argv[5]) if len(sys.argv) > 5 else 1000000
+	nloops = int(sys.argv[6]) if len(sys.argv) > 6 else 5
+	bench(sys.argv[1], int(sys.argv[2]), sys.argv[3], sys.argv[4], nrows, nloops)
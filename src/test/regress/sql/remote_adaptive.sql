@@ -0,0 +1,69 @@
+--DDL_STATEMENT_BEGIN--
+drop table if exists rar_i;
+--DDL_STATEMENT_END--
+--DDL_STATEMENT_BEGIN--
+drop table if exists rar_j;
+--DDL_STATEMENT_END--
+
+--DDL_STATEMENT_BEGIN--
+create table rar_i(a int primary key, b int);
+--DDL_STATEMENT_END--
+--DDL_STATEMENT_BEGIN--
+create table rar_j(a int primary key, b int);
+--DDL_STATEMENT_END--
+insert into rar_i select i, i * 2 from generate_series(1, 1000) i;
+insert into rar_j select i, i % 10 from generate_series(1, 5000) i;
+-- rar_i has stats, rar_j is left unanalyzed
+analyze rar_i;
+
+-- The mode an adaptive remote scan ended in, with the numbers masked.
+create or replace function rar_fetch(q text) returns setof text as $$
+declare ln text;
+begin
+    for ln in execute 'explain (analyze, costs off, timing off, summary off) ' || q loop
+        if ln ~ 'Remote Fetch' then
+            return next regexp_replace(trim(ln), '[0-9]+', 'N', 'g');
+        end if;
+    end loop;
+end
+$$ language plpgsql;
+create or replace function rar_plan_has(q text, pat text) returns bool as $$
+declare ln text;
+begin
+    for ln in execute 'explain (analyze, costs off, timing off, summary off) ' || q loop
+        if ln ~ pat then
+            return true;
+        end if;
+    end loop;
+    return false;
+end
+$$ language plpgsql;
+
+-- An analyzed table is queried per param value at first, then fetched at
+-- once as the rescans pile up.
+set remote_scan_adaptive = on;
+explain analyze select sum((select b from rar_i where rar_i.a = g)) from generate_series(1, 100) g;
+select rar_fetch($q$select sum((select b from rar_i where rar_i.a = g)) from generate_series(1, 100) g$q$);
+select sum((select b from rar_i where rar_i.a = g)) from generate_series(1, 100) g;
+-- Fetching a big table on each rescan switches to queries per param value,
+-- which get the LIMIT back.
+explain analyze select sum((select b from rar_j where rar_j.a = g limit 1)) from generate_series(1, 100) g;
+select rar_fetch($q$select sum((select b from rar_j where rar_j.a = g limit 1)) from generate_series(1, 100) g$q$);
+select rar_plan_has($q$select sum((select b from rar_j where rar_j.a = g limit 1)) from generate_series(1, 100) g$q$, 'Remote SQL: .* limit 1$');
+select sum((select b from rar_j where rar_j.a = g limit 1)) from generate_series(1, 100) g;
+
+-- Same results with a fixed mode
+set remote_scan_adaptive = off;
+select rar_fetch($q$select sum((select b from rar_i where rar_i.a = g)) from generate_series(1, 100) g$q$);
+select sum((select b from rar_i where rar_i.a = g)) from generate_series(1, 100) g;
+select sum((select b from rar_j where rar_j.a = g limit 1)) from generate_series(1, 100) g;
+reset remote_scan_adaptive;
+
+drop function rar_fetch(text);
+drop function rar_plan_has(text, text);
+--DDL_STATEMENT_BEGIN--
+drop table rar_i;
+--DDL_STATEMENT_END--
+--DDL_STATEMENT_BEGIN--
+drop table rar_j;
+--DDL_STATEMENT_END--
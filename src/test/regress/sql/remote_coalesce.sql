@@ -0,0 +1,55 @@
+--DDL_STATEMENT_BEGIN--
+drop table if exists rcs;
+--DDL_STATEMENT_END--
+
+-- All partitions on one shard, so that the stmts of a query to them are
+-- queued on one connection and sent in one packet.
+--DDL_STATEMENT_BEGIN--
+create table rcs(a int primary key, b text) partition by range(a);
+--DDL_STATEMENT_END--
+--DDL_STATEMENT_BEGIN--
+create table rcs_p0 partition of rcs for values from (0) to (10) with(shard=1);
+--DDL_STATEMENT_END--
+--DDL_STATEMENT_BEGIN--
+create table rcs_p1 partition of rcs for values from (10) to (20) with(shard=1);
+--DDL_STATEMENT_END--
+--DDL_STATEMENT_BEGIN--
+create table rcs_p2 partition of rcs for values from (20) to (30) with(shard=1);
+--DDL_STATEMENT_END--
+set mysql_coalesce_stmts = on;
+
+-- Quotes, comments and hints in the stmt text don't end or start stmts
+insert into rcs values (1, 'semi;colon'), (11, 'it''s; here'), (21, '-- not a comment;'),
+  (2, '/* not; a comment */'), (12, '/*! select 1; */'), (22, '"double;quoted"'),
+  (3, '#hash;'), (13, '`tick;`'), (23, ';');
+select * from rcs order by a;
+update rcs set b = b || ';--' where a in (2, 12, 22);
+select * from rcs where a in (2, 12, 22) order by a;
+update rcs set b = left(b, -3) where a in (2, 12, 22);
+
+-- The stmt to the middle partition fails, the storage node skips the stmts
+-- after it in the packet and nothing of the insert is kept.
+insert into rcs values (5, 'x'), (15, 'y'), (11, 'dup'), (25, 'z');
+select * from rcs order by a;
+begin;
+insert into rcs values (6, 'x');
+insert into rcs values (7, 'x'), (16, 'y'), (12, 'dup'), (26, 'z');
+rollback;
+select count(*) from rcs;
+
+-- Canceled while results of the packet are still to be read
+set statement_timeout = 500;
+select a, pg_sleep(0.2) from rcs;
+reset statement_timeout;
+select * from rcs order by a;
+
+-- Same results without coalescing
+set mysql_coalesce_stmts = off;
+update rcs set b = b || ';--' where a in (2, 12, 22);
+update rcs set b = left(b, -3) where a in (2, 12, 22);
+select * from rcs order by a;
+reset mysql_coalesce_stmts;
+
+--DDL_STATEMENT_BEGIN--
+drop table rcs;
+--DDL_STATEMENT_END--
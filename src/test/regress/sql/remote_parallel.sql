@@ -0,0 +1,60 @@
+drop table if exists rpar cascade;
+--DDL_STATEMENT_BEGIN--
+create table rpar(a int primary key, b int) partition by hash(a);
+--DDL_STATEMENT_END--
+--DDL_STATEMENT_BEGIN--
+create table rpar0 partition of rpar for values with (modulus 4, remainder 0);
+--DDL_STATEMENT_END--
+--DDL_STATEMENT_BEGIN--
+create table rpar1 partition of rpar for values with (modulus 4, remainder 1);
+--DDL_STATEMENT_END--
+--DDL_STATEMENT_BEGIN--
+create table rpar2 partition of rpar for values with (modulus 4, remainder 2);
+--DDL_STATEMENT_END--
+--DDL_STATEMENT_BEGIN--
+create table rpar3 partition of rpar for values with (modulus 4, remainder 3);
+--DDL_STATEMENT_END--
+insert into rpar select i, i % 7 from generate_series(1, 1000) i;
+
+-- Return the plan lines of a query matching a pattern, with the numbers
+-- which vary from run to run masked.
+create or replace function rpar_plan(q text, pat text) returns setof text as $$
+declare ln text;
+begin
+    for ln in execute 'explain (analyze, costs off, timing off, summary off) ' || q loop
+        if ln ~ pat then
+            return next regexp_replace(trim(ln), '[0-9]+', 'N', 'g');
+        end if;
+    end loop;
+end
+$$ language plpgsql;
+
+set enable_parallel_remotescan = on;
+set parallel_setup_cost = 0;
+set parallel_tuple_cost = 0;
+set min_parallel_table_scan_size = 0;
+set max_parallel_workers_per_gather = 2;
+
+-- The RemoteScan nodes are serialized to the workers.
+select * from rpar_plan('select count(*), sum(b) from rpar', 'Gather|Workers Launched') as p;
+select count(*), sum(b) from rpar;
+select b, count(*) from rpar group by b order by b;
+select * from rpar where a between 10 and 14 order by a;
+
+-- Remote tables written by the transaction are read by the leader only.
+begin;
+insert into rpar values(1001, 100);
+select count(*), sum(b) from rpar;
+rollback;
+
+select count(*), sum(b) from rpar;
+
+reset max_parallel_workers_per_gather;
+reset min_parallel_table_scan_size;
+reset parallel_tuple_cost;
+reset parallel_setup_cost;
+reset enable_parallel_remotescan;
+drop function rpar_plan(text, text);
+--DDL_STATEMENT_BEGIN--
+drop table rpar;
+--DDL_STATEMENT_END--
@@ -0,0 +1,97 @@
+--DDL_STATEMENT_BEGIN--
+drop table if exists rpd_s1;
+--DDL_STATEMENT_END--
+--DDL_STATEMENT_BEGIN--
+drop table if exists rpd_s2;
+--DDL_STATEMENT_END--
+--DDL_STATEMENT_BEGIN--
+drop table if exists rpd_p;
+--DDL_STATEMENT_END--
+
+--DDL_STATEMENT_BEGIN--
+create table rpd_s1(a int primary key, b int not null, c int) with(shard=1);
+--DDL_STATEMENT_END--
+--DDL_STATEMENT_BEGIN--
+create table rpd_s2(a int primary key, d int) with(shard=1);
+--DDL_STATEMENT_END--
+--DDL_STATEMENT_BEGIN--
+create table rpd_p(a int primary key, b int) partition by hash(a);
+--DDL_STATEMENT_END--
+--DDL_STATEMENT_BEGIN--
+create table rpd_p0 partition of rpd_p for values with (modulus 2, remainder 0);
+--DDL_STATEMENT_END--
+--DDL_STATEMENT_BEGIN--
+create table rpd_p1 partition of rpd_p for values with (modulus 2, remainder 1);
+--DDL_STATEMENT_END--
+insert into rpd_s1 values(1, 10, NULL), (2, 20, 5), (3, 30, NULL), (4, 40, 7), (5, 50, 3);
+insert into rpd_s2 values(1, 100), (3, 300), (5, 500), (7, 700);
+insert into rpd_p select i, i % 3 from generate_series(1, 20) i;
+
+-- Whether a plan line of the query, e.g. its Remote SQL, matches a pattern.
+-- The bound of a LIMIT is only known at execution time, so the query is
+-- run by EXPLAIN ANALYZE.
+create or replace function rpd_plan_has(q text, pat text) returns bool as $$
+declare ln text;
+begin
+    for ln in execute 'explain (analyze, costs off, timing off, summary off) ' || q loop
+        if ln ~ pat then
+            return true;
+        end if;
+    end loop;
+    return false;
+end
+$$ language plpgsql;
+
+-- ORDER BY is sent to the storage node
+set enable_sort = off;
+explain select a, b from rpd_s1 order by b;
+select rpd_plan_has($q$select a, b from rpd_s1 order by b$q$, ' order by ');
+select a, b from rpd_s1 order by b;
+-- MySQL sorts NULLs first, c is nullable
+select rpd_plan_has($q$select c, a from rpd_s1 order by c, a$q$, ' order by .*c IS NULL, ');
+select c, a from rpd_s1 order by c, a;
+select rpd_plan_has($q$select c, a from rpd_s1 order by c desc, a$q$, ' order by .*c IS NULL DESC, ');
+select c, a from rpd_s1 order by c desc, a;
+
+-- LIMIT bounds reach the partitions under a Merge Append
+explain select * from rpd_p order by a limit 3;
+select rpd_plan_has($q$select * from rpd_p order by a limit 3$q$, 'Merge Append');
+select rpd_plan_has($q$select * from rpd_p order by a limit 3$q$, ' order by .* limit 3$');
+select * from rpd_p order by a limit 3;
+select rpd_plan_has($q$select * from rpd_p order by a limit 3 offset 2$q$, ' limit 5$');
+select * from rpd_p order by a limit 3 offset 2;
+-- no bound if rows may be filtered locally
+select rpd_plan_has($q$select * from rpd_p where a + b > random() order by a limit 3$q$, ' limit 3$');
+reset enable_sort;
+
+-- Partial aggregation is done by the storage nodes
+explain select b, count(*), sum(a), min(a), max(a) from rpd_p group by b;
+select rpd_plan_has($q$select b, count(*), sum(a), min(a), max(a) from rpd_p group by b$q$, 'Remote SQL: .* group by ');
+select b, count(*), sum(a), min(a), max(a) from rpd_p group by b order by b;
+select count(*), sum(a), avg(a) from rpd_p;
+set enable_remote_agg_pushdown = off;
+select rpd_plan_has($q$select b, count(*), sum(a), min(a), max(a) from rpd_p group by b$q$, 'Remote SQL: .* group by ');
+select b, count(*), sum(a), min(a), max(a) from rpd_p group by b order by b;
+reset enable_remote_agg_pushdown;
+
+-- Joins of tables on the same shard are done by the shard
+explain select s1.a, b, d from rpd_s1 s1 join rpd_s2 s2 on s1.a = s2.a;
+select rpd_plan_has($q$select s1.a, b, d from rpd_s1 s1 join rpd_s2 s2 on s1.a = s2.a$q$, ' inner join ');
+select s1.a, b, d from rpd_s1 s1 join rpd_s2 s2 on s1.a = s2.a order by s1.a;
+select rpd_plan_has($q$select s1.a, d from rpd_s1 s1 left join rpd_s2 s2 on s1.a = s2.a$q$, ' left join ');
+select d, s1.a from rpd_s1 s1 left join rpd_s2 s2 on s1.a = s2.a order by s1.a;
+set enable_remote_join_pushdown = off;
+select rpd_plan_has($q$select s1.a, b, d from rpd_s1 s1 join rpd_s2 s2 on s1.a = s2.a$q$, ' inner join ');
+select s1.a, b, d from rpd_s1 s1 join rpd_s2 s2 on s1.a = s2.a order by s1.a;
+reset enable_remote_join_pushdown;
+
+drop function rpd_plan_has(text, text);
+--DDL_STATEMENT_BEGIN--
+drop table rpd_s1;
+--DDL_STATEMENT_END--
+--DDL_STATEMENT_BEGIN--
+drop table rpd_s2;
+--DDL_STATEMENT_END--
+--DDL_STATEMENT_BEGIN--
+drop table rpd_p;
+--DDL_STATEMENT_END--